@@ -0,0 +1,134 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   queue for handing items from one thread to another
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_BOUNDED_QUEUE_H
+#define MTX_COMMON_BOUNDED_QUEUE_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/* First-in, first-out queue between producer and consumer threads.
+   Pushing blocks while the queue holds max_items items or the sizes
+   of its items add up to max_bytes or more. An item is always accepted
+   by an empty queue regardless of its size. Popping blocks while the
+   queue is empty.
+
+   close() signals that no more items will be pushed; items already
+   queued can still be popped. abort() makes all waiting and future
+   calls return false immediately, e.g. after an error in one of the
+   threads. */
+template<typename T>
+class bounded_queue_c {
+protected:
+  std::deque<std::pair<T, std::size_t>> m_items;
+  std::size_t m_max_items, m_max_bytes, m_num_bytes{};
+  bool m_closed{}, m_aborted{};
+  uint64_t m_num_pushes{}, m_num_push_waits{}, m_num_pop_waits{};
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv_not_empty, m_cv_not_full;
+
+public:
+  bounded_queue_c(std::size_t max_items, std::size_t max_bytes = std::numeric_limits<std::size_t>::max())
+    : m_max_items{max_items}
+    , m_max_bytes{max_bytes}
+  {
+  }
+
+  // Returns false if the queue has been aborted.
+  bool
+  push(T item,
+       std::size_t size = 0) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+
+    if (is_full())
+      ++m_num_push_waits;
+
+    m_cv_not_full.wait(lock, [this]() { return m_aborted || !is_full(); });
+
+    if (m_aborted)
+      return false;
+
+    m_items.emplace_back(std::move(item), size);
+    m_num_bytes += size;
+    ++m_num_pushes;
+
+    m_cv_not_empty.notify_one();
+
+    return true;
+  }
+
+  // Returns false if the queue has been closed and is empty or if it
+  // has been aborted.
+  bool
+  pop(T &item) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+
+    if (m_items.empty() && !m_closed)
+      ++m_num_pop_waits;
+
+    m_cv_not_empty.wait(lock, [this]() { return m_aborted || m_closed || !m_items.empty(); });
+
+    if (m_aborted || m_items.empty())
+      return false;
+
+    item         = std::move(m_items.front().first);
+    m_num_bytes -= m_items.front().second;
+    m_items.pop_front();
+
+    m_cv_not_full.notify_one();
+
+    return true;
+  }
+
+  void
+  close() {
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_closed = true;
+    m_cv_not_empty.notify_all();
+  }
+
+  void
+  abort() {
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_aborted = true;
+    m_items.clear();
+    m_num_bytes = 0;
+
+    m_cv_not_empty.notify_all();
+    m_cv_not_full.notify_all();
+  }
+
+  std::string
+  get_statistics() {
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    return (boost::format("%1% items pushed, %2% waits for space, %3% waits for items") % m_num_pushes % m_num_push_waits % m_num_pop_waits).str();
+  }
+
+protected:
+  bool
+  is_full()
+    const {
+    return !m_items.empty()
+        && (   (m_items.size() >= m_max_items)
+            || (m_num_bytes     >= m_max_bytes));
+  }
+};
+
+#endif  // MTX_COMMON_BOUNDED_QUEUE_H
@@ -16,12 +16,118 @@
 
 #include "common/common_pch.h"
 
+#include "common/cpu_features.h"
+
+#if defined(MTX_HAVE_X86_SIMD)
+# include <immintrin.h>
+#endif
+
 #include "common/bswap.h"
 #include "common/checksums/crc.h"
 #include "common/endian.h"
 
 namespace mtx { namespace checksum {
 
+namespace {
+
+inline uint32_t
+load_uint32_le(unsigned char const *buffer) {
+  uint32_t value;
+  std::memcpy(&value, buffer, 4);
+
+#if defined(ARCH_BIGENDIAN)
+  value = mtx::bswap_32(value);
+#endif
+
+  return value;
+}
+
+#if defined(MTX_HAVE_X86_SIMD)
+MTX_TARGET("sse2") inline __m128i
+load_m128i(unsigned char const *buffer) {
+  return _mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer));
+}
+
+MTX_TARGET("sse2,pclmul") inline __m128i
+fold_m128i(__m128i value,
+           __m128i constants,
+           __m128i next) {
+  auto low = _mm_clmulepi64_si128(value, constants, 0x00);
+  value    = _mm_clmulepi64_si128(value, constants, 0x11);
+
+  return _mm_xor_si128(_mm_xor_si128(value, low), next);
+}
+
+/* Folds 16 byte blocks with carry-less multiplications and reduces the
+   remainder to 32 bits with Barrett's method as described in Intel's
+   white paper "Fast CRC Computation for Generic Polynomials Using
+   PCLMULQDQ Instruction". The constants are the ones for the
+   bit-reflected polynomial 0xEDB88320. 'size' must be a multiple of 16
+   and at least 64. */
+MTX_TARGET("sse2,pclmul") uint32_t
+crc32_ieee_le_pclmul(unsigned char const *buffer,
+                     std::size_t size,
+                     uint32_t crc) {
+  alignas(16) static uint64_t const s_k1k2[] = { 0x0154442bd4ull, 0x01c6e41596ull };
+  alignas(16) static uint64_t const s_k3k4[] = { 0x01751997d0ull, 0x00ccaa009eull };
+  alignas(16) static uint64_t const s_k5k0[] = { 0x0163cd6124ull, 0x0000000000ull };
+  alignas(16) static uint64_t const s_poly[] = { 0x01db710641ull, 0x01f7011641ull };
+
+  auto x1 = _mm_xor_si128(load_m128i(buffer), _mm_cvtsi32_si128(static_cast<int>(crc)));
+  auto x2 = load_m128i(buffer + 0x10);
+  auto x3 = load_m128i(buffer + 0x20);
+  auto x4 = load_m128i(buffer + 0x30);
+  auto k  = _mm_load_si128(reinterpret_cast<__m128i const *>(s_k1k2));
+
+  buffer += 64;
+  size   -= 64;
+
+  // Four independent lanes of 16 bytes each.
+  while (size >= 64) {
+    x1 = fold_m128i(x1, k, load_m128i(buffer));
+    x2 = fold_m128i(x2, k, load_m128i(buffer + 0x10));
+    x3 = fold_m128i(x3, k, load_m128i(buffer + 0x20));
+    x4 = fold_m128i(x4, k, load_m128i(buffer + 0x30));
+
+    buffer += 64;
+    size   -= 64;
+  }
+
+  // Fold the four lanes into one.
+  k  = _mm_load_si128(reinterpret_cast<__m128i const *>(s_k3k4));
+  x1 = fold_m128i(x1, k, x2);
+  x1 = fold_m128i(x1, k, x3);
+  x1 = fold_m128i(x1, k, x4);
+
+  while (size >= 16) {
+    x1 = fold_m128i(x1, k, load_m128i(buffer));
+
+    buffer += 16;
+    size   -= 16;
+  }
+
+  // Fold 128 bits to 64 bits.
+  auto mask = _mm_setr_epi32(~0, 0, ~0, 0);
+  x2        = _mm_clmulepi64_si128(x1, k, 0x10);
+  x1        = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+  k         = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(s_k5k0));
+  x2        = _mm_srli_si128(x1, 4);
+  x1        = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00);
+  x1        = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits.
+  k         = _mm_load_si128(reinterpret_cast<__m128i const *>(s_poly));
+  x2        = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x10);
+  x2        = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), k, 0x00);
+  x1        = _mm_xor_si128(x1, x2);
+
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(x1, 4)));
+}
+#endif  // MTX_HAVE_X86_SIMD
+
+}
+
 crc_base_c::table_parameters_t const crc_base_c::ms_table_parameters[5] = {
   { 0,  8,       0x07 },
   { 0, 16,     0x8005 },
@@ -57,7 +163,7 @@ crc_base_c::init_table() {
   if ((parameters.bits < 8) || (parameters.bits > 32) || (parameters.poly >= (1LL<<parameters.bits)))
     throw std::domain_error{"Invalid CRC parameters"};
 
-  m_table.resize(256);
+  m_table.resize(ms_num_slices * 256);
 
   for (auto i = 0u; i < 256u; i++) {
     if (parameters.le) {
@@ -74,6 +180,13 @@ crc_base_c::init_table() {
     }
   }
 
+  // Table n contains the CRC of a byte followed by n zero bytes.
+  for (auto slice = 1u; slice < ms_num_slices; ++slice)
+    for (auto i = 0u; i < 256u; i++) {
+      auto previous            = m_table[(slice - 1) * 256 + i];
+      m_table[slice * 256 + i] = (previous >> 8) ^ m_table[previous & 0xff];
+    }
+
   // for (auto row = 0u; row < (256u / 4); ++row)
   //   mxinfo(boost::format("0x%|1$08x| 0x%|2$08x| 0x%|3$08x| 0x%|4$08x|\n")
   //          % m_table[row * 4 + 0] % m_table[row * 4 + 1] % m_table[row * 4 + 2] % m_table[row * 4 + 3]);
@@ -128,6 +241,24 @@ void
 crc_base_c::add_impl(unsigned char const *buffer,
                      size_t size) {
   auto end = buffer + size;
+  auto t   = m_table.data();
+
+  // Slice-by-8: as all tables are stored in the bit-reflected form, the
+  // same loop works for all CRC widths.
+  while ((end - buffer) >= 8) {
+    auto one = load_uint32_le(buffer) ^ m_crc;
+    auto two = load_uint32_le(buffer + 4);
+
+    m_crc    = t[7 * 256 + ( one        & 0xff)]
+             ^ t[6 * 256 + ((one >>  8) & 0xff)]
+             ^ t[5 * 256 + ((one >> 16) & 0xff)]
+             ^ t[4 * 256 + ( one >> 24        )]
+             ^ t[3 * 256 + ( two        & 0xff)]
+             ^ t[2 * 256 + ((two >>  8) & 0xff)]
+             ^ t[1 * 256 + ((two >> 16) & 0xff)]
+             ^ t[0 * 256 + ( two >> 24        )];
+    buffer  += 8;
+  }
 
   while (buffer < end) {
     m_crc = m_table[(m_crc & 0xff) ^ *buffer] ^ (m_crc >> 8);
@@ -195,4 +326,21 @@ crc32_ieee_le_c::crc32_ieee_le_c(uint32_t initial_value)
 crc32_ieee_le_c::~crc32_ieee_le_c() {
 }
 
+void
+crc32_ieee_le_c::add_impl(unsigned char const *buffer,
+                          size_t size) {
+#if defined(MTX_HAVE_X86_SIMD)
+  static auto const s_use_pclmul = mtx::cpu::has(mtx::cpu::feature_e::sse2) && mtx::cpu::has(mtx::cpu::feature_e::pclmul);
+
+  if (s_use_pclmul && (size >= 64)) {
+    auto to_fold = size & ~static_cast<size_t>(15);
+    m_crc        = crc32_ieee_le_pclmul(buffer, to_fold, m_crc);
+    buffer      += to_fold;
+    size        -= to_fold;
+  }
+#endif
+
+  crc_base_c::add_impl(buffer, size);
+}
+
 }} // namespace mtx { namespace checksum {
@@ -40,6 +40,9 @@ protected:
 
   static table_parameters_t const ms_table_parameters[5];
 
+  // Number of 256 entry tables used for processing eight bytes at a time.
+  static unsigned int const ms_num_slices = 8;
+
 protected:
   type_e m_type;
   table_t &m_table;
@@ -111,6 +114,9 @@ protected:
 public:
   crc32_ieee_le_c(uint32_t initial_value = 0);
   virtual ~crc32_ieee_le_c();
+
+protected:
+  virtual void add_impl(unsigned char const *buffer, size_t size);
 };
 
 }} // namespace mtx { namespace checksum {
@@ -107,6 +107,13 @@ mxrun_before_exit(std::function<void()> function) {
 
 void
 mxexit(int code) {
+  auto capture = mtx::output::json_capture_c::current();
+  if (capture) {
+    if (!capture->m_exit_code)
+      capture->m_exit_code = code;
+    throw mtx::output::exit_x{code};
+  }
+
   for (auto const &function : s_to_run_before_exit)
     function();
 
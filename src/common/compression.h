@@ -81,6 +81,10 @@ public:
 
   virtual void set_track_headers(KaxContentEncoding &c_encoding);
 
+  // Only used by compressors that support different levels.
+  virtual void set_compression_level(int) {
+  }
+
   static compressor_ptr create(compression_method_e method);
   static compressor_ptr create(const char *method);
   static compressor_ptr create_from_file_name(std::string const &file_name);
@@ -14,46 +14,94 @@
 #include "common/common_pch.h"
 
 #include "common/compression/zlib.h"
+#include "common/endian.h"
 
-zlib_compressor_c::zlib_compressor_c()
+zlib_compressor_c::zlib_compressor_c(int level)
   : compressor_c(COMPRESSION_ZLIB)
+  , m_c_initialized{}
+  , m_d_initialized{}
+  , m_level{level}
 {
 }
 
 zlib_compressor_c::~zlib_compressor_c() {
+  if (m_c_initialized)
+    deflateEnd(&m_c_stream);
+
+  if (m_d_initialized)
+    inflateEnd(&m_d_stream);
+}
+
+void
+zlib_compressor_c::set_compression_level(int level) {
+  if (level == m_level)
+    return;
+
+  m_level = level;
+
+  // The level is set when the stream is initialized.
+  if (m_c_initialized) {
+    deflateEnd(&m_c_stream);
+    m_c_initialized = false;
+  }
 }
 
 memory_cptr
 zlib_compressor_c::do_decompress(memory_cptr const &buffer) {
-  z_stream d_stream;
+  int result;
+
+  if (!m_d_initialized) {
+    m_d_stream.zalloc   = (alloc_func)0;
+    m_d_stream.zfree    = (free_func)0;
+    m_d_stream.opaque   = (voidpf)0;
+    m_d_stream.next_in  = Z_NULL;
+    m_d_stream.avail_in = 0;
+    result              = inflateInit2(&m_d_stream, 15 + 32); // 15: window size; 32: look for zlib/gzip headers automatically
+
+    if (Z_OK != result)
+      mxerror(boost::format(Y("inflateInit() failed. Result: %1%\n")) % result);
 
-  d_stream.zalloc = (alloc_func)0;
-  d_stream.zfree  = (free_func)0;
-  d_stream.opaque = (voidpf)0;
-  int result      = inflateInit2(&d_stream, 15 + 32); // 15: window size; 32: look for zlib/gzip headers automatically
+    m_d_initialized = true;
 
-  if (Z_OK != result)
-    mxerror(boost::format(Y("inflateInit() failed. Result: %1%\n")) % result);
+  } else
+    inflateReset(&m_d_stream);
 
-  d_stream.next_in   = reinterpret_cast<Bytef *>(buffer->get_buffer());
-  d_stream.avail_in  = buffer->get_size();
-  int n              = 0;
-  memory_cptr dst    = memory_c::alloc(0);
+  auto src      = buffer->get_buffer();
+  auto src_size = buffer->get_size();
+  auto dst_size = src_size * 4;
 
-  do {
-    n++;
-    dst->resize(n * 4000);
-    d_stream.next_out  = reinterpret_cast<Bytef *>(dst->get_buffer() + (n - 1) * 4000);
-    d_stream.avail_out = 4000;
-    result             = inflate(&d_stream, Z_NO_FLUSH);
+  // gzip streams end with the uncompressed size modulo 2^32. It is only
+  // used as a hint limited by deflate's maximum compression ratio.
+  if ((18 <= src_size) && (0x1f == src[0]) && (0x8b == src[1]))
+    dst_size = std::min<std::size_t>(get_uint32_le(&src[src_size - 4]), src_size * 1032);
 
-    if ((Z_OK != result) && (Z_STREAM_END != result))
+  auto dst = memory_c::alloc(std::max<std::size_t>(dst_size, 4096));
+
+  m_d_stream.next_in   = reinterpret_cast<Bytef *>(src);
+  m_d_stream.avail_in  = src_size;
+  m_d_stream.next_out  = reinterpret_cast<Bytef *>(dst->get_buffer());
+  m_d_stream.avail_out = dst->get_size();
+
+  while (true) {
+    result = inflate(&m_d_stream, Z_NO_FLUSH);
+
+    if ((Z_OK != result) && (Z_STREAM_END != result) && (Z_BUF_ERROR != result))
       throw mtx::compression_x(boost::format(Y("Zlib decompression failed. Result: %1%\n")) % result);
 
-  } while ((0 == d_stream.avail_out) && (0 != d_stream.avail_in) && (Z_STREAM_END != result));
+    // Output space left over means that all of the input has been
+    // consumed. Z_BUF_ERROR signals that no progress was possible.
+    if ((Z_OK != result) || m_d_stream.avail_out)
+      break;
 
-  dst->resize(d_stream.total_out);
-  inflateEnd(&d_stream);
+    // Grow the output geometrically instead of by a fixed amount.
+    auto filled = dst->get_size();
+    dst->resize(filled * 2);
+
+    m_d_stream.next_out  = reinterpret_cast<Bytef *>(dst->get_buffer() + filled);
+    m_d_stream.avail_out = filled;
+  }
+
+  dst->resize(m_d_stream.total_out);
 
   mxverb(3, boost::format("zlib_compressor_c: Decompression from %1% to %2%, %3%%%\n") % buffer->get_size() % dst->get_size() % (dst->get_size() * 100 / buffer->get_size()));
 
@@ -62,35 +110,36 @@ zlib_compressor_c::do_decompress(memory_cptr const &buffer) {
 
 memory_cptr
 zlib_compressor_c::do_compress(memory_cptr const &buffer) {
-  z_stream c_stream;
+  int result;
+
+  if (!m_c_initialized) {
+    m_c_stream.zalloc = (alloc_func)0;
+    m_c_stream.zfree  = (free_func)0;
+    m_c_stream.opaque = (voidpf)0;
+    result            = deflateInit(&m_c_stream, m_level);
 
-  c_stream.zalloc = (alloc_func)0;
-  c_stream.zfree  = (free_func)0;
-  c_stream.opaque = (voidpf)0;
-  int result      = deflateInit(&c_stream, 9);
+    if (Z_OK != result)
+      mxerror(boost::format(Y("deflateInit() failed. Result: %1%\n")) % result);
 
-  if (Z_OK != result)
-    mxerror(boost::format(Y("deflateInit() failed. Result: %1%\n")) % result);
+    m_c_initialized = true;
 
-  c_stream.next_in   = (Bytef *)buffer->get_buffer();
-  c_stream.avail_in  = buffer->get_size();
-  int n              = 0;
-  memory_cptr dst    = memory_c::alloc(0);
+  } else
+    deflateReset(&m_c_stream);
 
-  do {
-    n++;
-    dst->resize(n * 4000);
-    c_stream.next_out  = reinterpret_cast<Bytef *>(dst->get_buffer() + (n - 1) * 4000);
-    c_stream.avail_out = 4000;
-    result             = deflate(&c_stream, Z_FINISH);
+  // deflateBound() is an upper limit for the compressed size, so the
+  // whole buffer can be compressed in a single call.
+  auto dst = memory_c::alloc(deflateBound(&m_c_stream, buffer->get_size()));
 
-    if ((Z_OK != result) && (Z_STREAM_END != result))
-      mxerror(boost::format(Y("Zlib decompression failed. Result: %1%\n")) % result);
+  m_c_stream.next_in   = reinterpret_cast<Bytef *>(buffer->get_buffer());
+  m_c_stream.avail_in  = buffer->get_size();
+  m_c_stream.next_out  = reinterpret_cast<Bytef *>(dst->get_buffer());
+  m_c_stream.avail_out = dst->get_size();
+  result               = deflate(&m_c_stream, Z_FINISH);
 
-  } while ((c_stream.avail_out == 0) && (result != Z_STREAM_END));
+  if (Z_STREAM_END != result)
+    mxerror(boost::format(Y("Zlib compression failed. Result: %1%\n")) % result);
 
-  dst->resize(c_stream.total_out);
-  deflateEnd(&c_stream);
+  dst->resize(m_c_stream.total_out);
 
   mxverb(3, boost::format("zlib_compressor_c: Compression from %1% to %2%, %3%%%\n") % buffer->get_size() % dst->get_size() % (dst->get_size() * 100 / buffer->get_size()));
 
@@ -20,11 +20,22 @@
 
 #include "common/compression.h"
 
+/* The compression and decompression streams are initialized on first
+   use and only reset for each following buffer. As one instance is
+   used per track this avoids setting up zlib's internal state (which
+   is several hundred KB for deflate) for each packet. */
 class zlib_compressor_c: public compressor_c {
+protected:
+  z_stream m_c_stream, m_d_stream;
+  bool m_c_initialized, m_d_initialized;
+  int m_level;
+
 public:
-  zlib_compressor_c();
+  zlib_compressor_c(int level = Z_BEST_COMPRESSION);
   virtual ~zlib_compressor_c();
 
+  virtual void set_compression_level(int level);
+
 protected:
   virtual memory_cptr do_decompress(memory_cptr const &buffer);
   virtual memory_cptr do_compress(memory_cptr const &buffer);
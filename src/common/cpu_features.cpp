@@ -0,0 +1,70 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   run-time detection of CPU features used by optimized code paths
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(COMP_MSC) && (defined(__x86_64__) || defined(__i386__))
+# include <cpuid.h>
+#endif
+
+#include "common/cpu_features.h"
+#include "common/debugging.h"
+
+namespace mtx { namespace cpu {
+
+namespace {
+
+#if defined(MTX_HAVE_X86_SIMD)
+bool
+detect(feature_e feature) {
+  __builtin_cpu_init();
+
+  switch (feature) {
+    case feature_e::sse2:   return __builtin_cpu_supports("sse2");
+    case feature_e::ssse3:  return __builtin_cpu_supports("ssse3");
+    case feature_e::sse4_1: return __builtin_cpu_supports("sse4.1");
+    case feature_e::sse4_2: return __builtin_cpu_supports("sse4.2");
+    case feature_e::avx2:   return __builtin_cpu_supports("avx2");
+    case feature_e::pclmul: {
+      // Not all compiler versions know "pclmul" for
+      // __builtin_cpu_supports(), therefore query CPUID directly.
+      unsigned int eax, ebx, ecx, edx;
+      return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL);
+    }
+  }
+
+  return false;
+}
+
+#else  // MTX_HAVE_X86_SIMD
+
+bool
+detect(feature_e) {
+  return false;
+}
+
+#endif  // MTX_HAVE_X86_SIMD
+
+}
+
+bool
+has(feature_e feature) {
+  static debugging_option_c s_no_simd{"no_simd"};
+
+  if (s_no_simd)
+    return false;
+
+  return detect(feature);
+}
+
+}}
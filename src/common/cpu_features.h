@@ -0,0 +1,41 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   run-time detection of CPU features used by optimized code paths
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_CPU_FEATURES_H
+#define MTX_COMMON_CPU_FEATURES_H
+
+#include "common/common_pch.h"
+
+#if !defined(COMP_MSC) && (defined(__x86_64__) || defined(__i386__))
+# define MTX_HAVE_X86_SIMD 1
+# define MTX_TARGET(features) __attribute__((target(features)))
+#else
+# define MTX_TARGET(features)
+#endif
+
+namespace mtx { namespace cpu {
+
+enum class feature_e {
+  sse2,
+  ssse3,
+  sse4_1,
+  sse4_2,
+  pclmul,
+  avx2,
+};
+
+bool has(feature_e feature);
+
+}}
+
+#endif  // MTX_COMMON_CPU_FEATURES_H
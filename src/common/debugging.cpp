@@ -13,6 +13,7 @@
 
 #include "common/common_pch.h"
 
+#include <mutex>
 #include <sstream>
 
 #include <ebml/EbmlDate.h>
@@ -155,17 +156,25 @@ debugging_c::hexdump(memory_c const &buffer_to_dump,
 
 // ------------------------------------------------------------
 
-std::vector<debugging_option_c::option_c> debugging_option_c::ms_registered_options;
+std::deque<debugging_option_c::option_c> debugging_option_c::ms_registered_options;
+static std::mutex s_registered_options_mutex;
 
-size_t
+debugging_option_c::option_c *
 debugging_option_c::register_option(std::string const &option) {
+  std::lock_guard<std::mutex> lock{s_registered_options_mutex};
+
   auto itr = brng::find_if(ms_registered_options, [&option](option_c const &opt) { return opt.m_option == option; });
   if (itr != ms_registered_options.end())
-    return std::distance(ms_registered_options.begin(), itr);
+    return &*itr;
 
   ms_registered_options.emplace_back(option);
 
-  return ms_registered_options.size() - 1;
+  // Evaluate the option while holding the lock so that threads sharing
+  // it only ever read the cached value.
+  auto &registered = ms_registered_options.back();
+  registered.get();
+
+  return &registered;
 }
 
 void
@@ -16,6 +16,7 @@
 
 #include "common/common_pch.h"
 
+#include <deque>
 #include <sstream>
 #include <unordered_map>
 
@@ -65,28 +66,30 @@ class debugging_option_c {
   };
 
 protected:
-  mutable size_t m_registered_idx;
+  mutable option_c *m_registered_option;
   std::string m_option;
 
 private:
-  static std::vector<option_c> ms_registered_options;
+  // A deque so that pointers to registered options stay valid when
+  // other threads register further options.
+  static std::deque<option_c> ms_registered_options;
 
 public:
   debugging_option_c(std::string const &option)
-    : m_registered_idx{std::numeric_limits<size_t>::max()}
+    : m_registered_option{}
     , m_option{option}
   {
   }
 
   operator bool() const {
-    if (m_registered_idx == std::numeric_limits<size_t>::max())
-      m_registered_idx = register_option(m_option);
+    if (!m_registered_option)
+      m_registered_option = register_option(m_option);
 
-    return ms_registered_options.at(m_registered_idx).get();
+    return m_registered_option->get();
   }
 
 public:
-  static size_t register_option(std::string const &option);
+  static option_c *register_option(std::string const &option);
   static void invalidate_cache();
 };
 
@@ -15,8 +15,124 @@
 
 #include <algorithm>
 
+#include "common/cpu_features.h"
+
+#if defined(MTX_HAVE_X86_SIMD)
+# include <immintrin.h>
+#endif
+
 #include "common/endian.h"
 
+namespace {
+
+using uint32_array_converter_t = void (*)(uint32_t *, unsigned char const *, size_t);
+using uint64_array_converter_t = void (*)(uint64_t *, unsigned char const *, size_t);
+
+void
+get_uint32_be_array_scalar(uint32_t *dest,
+                           unsigned char const *src,
+                           size_t count) {
+  for (auto idx = size_t{}; idx < count; ++idx, src += 4)
+    dest[idx] = (static_cast<uint32_t>(src[0]) << 24) | (static_cast<uint32_t>(src[1]) << 16) | (static_cast<uint32_t>(src[2]) << 8) | src[3];
+}
+
+void
+get_uint64_be_array_scalar(uint64_t *dest,
+                           unsigned char const *src,
+                           size_t count) {
+  for (auto idx = size_t{}; idx < count; ++idx, src += 8)
+    dest[idx] = (static_cast<uint64_t>(src[0]) << 56) | (static_cast<uint64_t>(src[1]) << 48) | (static_cast<uint64_t>(src[2]) << 40) | (static_cast<uint64_t>(src[3]) << 32)
+              | (static_cast<uint64_t>(src[4]) << 24) | (static_cast<uint64_t>(src[5]) << 16) | (static_cast<uint64_t>(src[6]) <<  8) |                        src[7];
+}
+
+#if defined(MTX_HAVE_X86_SIMD)
+// Byte shuffle masks reversing the bytes within each 32-bit or 64-bit
+// lane. The AVX2 variants use the same mask for both 128-bit halves.
+#define MTX_BSWAP32_MASK 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3
+#define MTX_BSWAP64_MASK  8,  9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7
+
+MTX_TARGET("ssse3") void
+get_uint32_be_array_ssse3(uint32_t *dest,
+                          unsigned char const *src,
+                          size_t count) {
+  auto mask = _mm_set_epi8(MTX_BSWAP32_MASK);
+  auto idx  = size_t{};
+
+  for (; (idx + 4) <= count; idx += 4)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + idx), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src + idx * 4)), mask));
+
+  get_uint32_be_array_scalar(dest + idx, src + idx * 4, count - idx);
+}
+
+MTX_TARGET("ssse3") void
+get_uint64_be_array_ssse3(uint64_t *dest,
+                          unsigned char const *src,
+                          size_t count) {
+  auto mask = _mm_set_epi8(MTX_BSWAP64_MASK);
+  auto idx  = size_t{};
+
+  for (; (idx + 2) <= count; idx += 2)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + idx), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src + idx * 8)), mask));
+
+  get_uint64_be_array_scalar(dest + idx, src + idx * 8, count - idx);
+}
+
+MTX_TARGET("avx2") void
+get_uint32_be_array_avx2(uint32_t *dest,
+                         unsigned char const *src,
+                         size_t count) {
+  auto mask = _mm256_set_epi8(MTX_BSWAP32_MASK, MTX_BSWAP32_MASK);
+  auto idx  = size_t{};
+
+  for (; (idx + 8) <= count; idx += 8)
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + idx), _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + idx * 4)), mask));
+
+  get_uint32_be_array_ssse3(dest + idx, src + idx * 4, count - idx);
+}
+
+MTX_TARGET("avx2") void
+get_uint64_be_array_avx2(uint64_t *dest,
+                         unsigned char const *src,
+                         size_t count) {
+  auto mask = _mm256_set_epi8(MTX_BSWAP64_MASK, MTX_BSWAP64_MASK);
+  auto idx  = size_t{};
+
+  for (; (idx + 4) <= count; idx += 4)
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + idx), _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + idx * 8)), mask));
+
+  get_uint64_be_array_ssse3(dest + idx, src + idx * 8, count - idx);
+}
+
+#undef MTX_BSWAP32_MASK
+#undef MTX_BSWAP64_MASK
+#endif  // MTX_HAVE_X86_SIMD
+
+uint32_array_converter_t
+select_uint32_array_converter() {
+#if defined(MTX_HAVE_X86_SIMD)
+  if (mtx::cpu::has(mtx::cpu::feature_e::avx2))
+    return get_uint32_be_array_avx2;
+  if (mtx::cpu::has(mtx::cpu::feature_e::ssse3))
+    return get_uint32_be_array_ssse3;
+#endif
+
+  return get_uint32_be_array_scalar;
+}
+
+uint64_array_converter_t
+select_uint64_array_converter() {
+#if defined(MTX_HAVE_X86_SIMD)
+  if (mtx::cpu::has(mtx::cpu::feature_e::avx2))
+    return get_uint64_be_array_avx2;
+  if (mtx::cpu::has(mtx::cpu::feature_e::ssse3))
+    return get_uint64_be_array_ssse3;
+#endif
+
+  return get_uint64_be_array_scalar;
+}
+
+}
+
 uint16_t
 get_uint16_le(const void *buf) {
   return get_uint_le(buf, 2);
@@ -156,3 +272,21 @@ put_uint64_be(void *buf,
               uint64_t value) {
   put_uint_be(buf, value, 8);
 }
+
+void
+get_uint32_be_array(uint32_t *dest,
+                    const void *src,
+                    size_t count) {
+  static auto s_converter = select_uint32_array_converter();
+
+  s_converter(dest, static_cast<unsigned char const *>(src), count);
+}
+
+void
+get_uint64_be_array(uint64_t *dest,
+                    const void *src,
+                    size_t count) {
+  static auto s_converter = select_uint64_array_converter();
+
+  s_converter(dest, static_cast<unsigned char const *>(src), count);
+}
@@ -38,4 +38,10 @@ void put_uint24_be(void *buf, uint32_t value);
 void put_uint32_be(void *buf, uint32_t value);
 void put_uint64_be(void *buf, uint64_t value);
 
+// Convert 'count' consecutive big endian values at 'src' to host byte
+// order. 'src' doesn't have to be aligned, and it may be the same
+// buffer as 'dest' for converting in place.
+void get_uint32_be_array(uint32_t *dest, const void *src, size_t count);
+void get_uint64_be_array(uint64_t *dest, const void *src, size_t count);
+
 #endif  // MTX_COMMON_ENDIAN_H
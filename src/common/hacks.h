@@ -40,7 +40,10 @@
 #define ENGAGE_KEEP_LAST_CHAPTER_IN_MPLS    19
 #define ENGAGE_KEEP_TRACK_STATISTICS_TAGS   20
 #define ENGAGE_ALL_I_SLICES_ARE_KEY_FRAMES  21
-#define ENGAGE_MAX_IDX                      21
+#define ENGAGE_NO_DIRECT_CLUSTER_WRITER     22
+#define ENGAGE_NO_EXTRACTION_THREADS        23
+#define ENGAGE_NO_COMPRESSION_THREADS       24
+#define ENGAGE_MAX_IDX                      24
 
 void engage_hacks(const std::string &hacks);
 void engage_hack(unsigned int id);
@@ -1405,9 +1405,12 @@ es_parser_c::es_parser_c()
 
 es_parser_c::~es_parser_c() {
   mxdebug_if(debugging_c::requested("hevc_statistics"),
-             boost::format("HEVC statistics: #frames: out %1% discarded %2% #timecodes: in %3% generated %4% discarded %5% num_fields: %6% num_frames: %7%\n")
+             boost::format("HEVC statistics: #frames: out %1% discarded %2% #timecodes: in %3% generated %4% discarded %5% num_fields: %6% num_frames: %7% "
+                           "#NALUs: copied %8% referenced %9% (%10% copies per frame)\n")
              % m_stats.num_frames_out % m_stats.num_frames_discarded % m_stats.num_timecodes_in % m_stats.num_timecodes_generated % m_stats.num_timecodes_discarded
-             % m_stats.num_field_slices % m_stats.num_frame_slices);
+             % m_stats.num_field_slices % m_stats.num_frame_slices
+             % m_stats.num_nalus_copied % m_stats.num_nalus_referenced
+             % (m_stats.num_frames_out ? static_cast<double>(m_stats.num_nalus_copied) / m_stats.num_frames_out : 0.0));
 
   mxdebug_if(m_debug_timecodes, boost::format("stream_position %1% parsed_position %2%\n") % m_stream_position % m_parsed_position);
 
@@ -1442,64 +1445,47 @@ es_parser_c::discard_actual_frames(bool discard) {
 void
 es_parser_c::add_bytes(unsigned char *buffer,
                        size_t size) {
+  add_bytes(std::make_shared<memory_c>(buffer, size, false));
+}
+
+void
+es_parser_c::add_bytes(memory_cptr const &buffer) {
   memory_slice_cursor_c cursor;
-  int marker_size              = 0;
   int previous_marker_size     = 0;
   int previous_pos             = -1;
   uint64_t previous_parsed_pos = m_parsed_position;
 
   if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
     cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
-
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker =                               1 << 24
-                    | (unsigned int)cursor.get_char() << 16
-                    | (unsigned int)cursor.get_char() <<  8
-                    | (unsigned int)cursor.get_char();
-
-    while (1) {
-      if (NALU_START_CODE == marker)
-        marker_size = 4;
-      else if (NALU_START_CODE == (marker & 0x00ffffff))
-        marker_size = 3;
-
-      if (0 != marker_size) {
-        if (-1 != previous_pos) {
-          auto new_size = cursor.get_position() - marker_size - previous_pos - previous_marker_size;
-          auto nalu     = memory_c::alloc(new_size);
-          cursor.copy(nalu->get_buffer(), previous_pos + previous_marker_size, new_size);
-          m_parsed_position = previous_parsed_pos + previous_pos;
-
-          mtx::mpeg::remove_trailing_zero_bytes(*nalu);
-          if (nalu->get_size())
-            handle_nalu(nalu, m_parsed_position);
-        }
-        previous_pos         = cursor.get_position() - marker_size;
-        previous_marker_size = marker_size;
-        marker_size          = 0;
-      }
+  cursor.add_slice(buffer);
 
-      if (!cursor.char_available())
-        break;
+  mtx::mpeg::find_start_codes(cursor, [&](std::size_t marker_pos, std::size_t marker_size) {
+    if (-1 != previous_pos) {
+      auto nalu = cursor.get_view_or_copy(previous_pos + previous_marker_size, marker_pos - previous_pos - previous_marker_size);
+      ++(nalu->is_view() ? m_stats.num_nalus_referenced : m_stats.num_nalus_copied);
+
+      m_parsed_position = previous_parsed_pos + previous_pos;
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
+      mtx::mpeg::remove_trailing_zero_bytes(*nalu);
+      if (nalu->get_size())
+        handle_nalu(nalu, m_parsed_position);
     }
-  }
+
+    previous_pos         = marker_pos;
+    previous_marker_size = marker_size;
+  });
 
   if (-1 == previous_pos)
     previous_pos = 0;
 
-  m_stream_position += size;
+  m_stream_position += buffer->get_size();
   m_parsed_position  = previous_parsed_pos + previous_pos;
 
   int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    m_unparsed_buffer = memory_c::alloc(new_size);
-    cursor.copy(m_unparsed_buffer->get_buffer(), previous_pos, new_size);
+  if (0 != new_size)
+    m_unparsed_buffer = cursor.get_view_or_copy(previous_pos, new_size);
 
-  } else
+  else
     m_unparsed_buffer.reset();
 }
 
@@ -1509,7 +1495,7 @@ es_parser_c::flush() {
     m_parsed_position += m_unparsed_buffer->get_size();
     auto marker_size   = get_uint32_be(m_unparsed_buffer->get_buffer()) == NALU_START_CODE ? 4 : 3;
     auto nalu_size     = m_unparsed_buffer->get_size() - marker_size;
-    handle_nalu(memory_c::clone(m_unparsed_buffer->get_buffer() + marker_size, nalu_size), m_parsed_position - nalu_size);
+    handle_nalu(memory_c::view(*m_unparsed_buffer, marker_size, nalu_size), m_parsed_position - nalu_size);
   }
 
   m_unparsed_buffer.reset();
@@ -1609,8 +1595,10 @@ es_parser_c::handle_vps_nalu(memory_cptr const &nalu) {
     if (m_vps_info_list[i].id == vps_info.id)
       break;
 
+  // Store copies as the NALU may only be a view into a much larger
+  // buffer.
   if (m_vps_info_list.size() == i) {
-    m_vps_list.push_back(nalu);
+    m_vps_list.push_back(nalu->clone());
     m_vps_info_list.push_back(vps_info);
     m_hevcc_changed = true;
 
@@ -1618,7 +1606,7 @@ es_parser_c::handle_vps_nalu(memory_cptr const &nalu) {
     mxverb(2, boost::format("hevc: VPS ID %|1$04x| changed; checksum old %|2$04x| new %|3$04x|\n") % vps_info.id % m_vps_info_list[i].checksum % vps_info.checksum);
 
     m_vps_info_list[i] = vps_info;
-    m_vps_list[i]      = nalu;
+    m_vps_list[i]      = nalu->clone();
     m_hevcc_changed    = true;
 
     // Update codec private if needed
@@ -1739,7 +1727,7 @@ es_parser_c::handle_pps_nalu(memory_cptr const &nalu) {
       break;
 
   if (m_pps_info_list.size() == i) {
-    m_pps_list.push_back(nalu);
+    m_pps_list.push_back(nalu->clone());
     m_pps_info_list.push_back(pps_info);
     m_hevcc_changed = true;
 
@@ -1747,7 +1735,7 @@ es_parser_c::handle_pps_nalu(memory_cptr const &nalu) {
     mxverb(2, boost::format("hevc: PPS ID %|1$04x| changed; checksum old %|2$04x| new %|3$04x|\n") % pps_info.id % m_pps_info_list[i].checksum % pps_info.checksum);
 
     m_pps_info_list[i] = pps_info;
-    m_pps_list[i]      = nalu;
+    m_pps_list[i]      = nalu->clone();
     m_hevcc_changed     = true;
   }
 
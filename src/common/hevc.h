@@ -469,6 +469,7 @@ protected:
   struct stats_t {
     std::vector<int> num_slices_by_type;
     size_t num_frames_out, num_frames_discarded, num_timecodes_in, num_timecodes_generated, num_timecodes_discarded, num_field_slices, num_frame_slices;
+    size_t num_nalus_copied, num_nalus_referenced;
 
     stats_t()
       : num_slices_by_type(3, 0)
@@ -479,6 +480,8 @@ protected:
       , num_timecodes_discarded(0)
       , num_field_slices(0)
       , num_frame_slices(0)
+      , num_nalus_copied(0)
+      , num_nalus_referenced(0)
     {
     }
   } m_stats;
@@ -500,9 +503,7 @@ public:
   }
 
   void add_bytes(unsigned char *buf, size_t size);
-  void add_bytes(memory_cptr &buf) {
-    add_bytes(buf->get_buffer(), buf->get_size());
-  }
+  void add_bytes(memory_cptr const &buf);
 
   void flush();
 
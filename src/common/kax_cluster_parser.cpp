@@ -0,0 +1,401 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   flat parser for the blocks in a Matroska cluster
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxBlock.h>
+#include <matroska/KaxBlockData.h>
+#include <matroska/KaxCluster.h>
+#include <matroska/KaxClusterData.h>
+
+#include "common/endian.h"
+#include "common/kax_cluster_parser.h"
+
+using namespace libmatroska;
+
+namespace {
+
+struct element_t {
+  uint32_t m_id;
+  unsigned char *m_data;
+  std::size_t m_size;
+};
+
+// Reads an EBML variable-sized integer. Returns the number of bytes
+// used or 0 if it's invalid or exceeds the buffer. The length marker is
+// kept for IDs and removed for sizes.
+unsigned int
+read_vint(unsigned char const *data,
+          unsigned char const *end,
+          bool is_id,
+          uint64_t &value,
+          bool &unknown) {
+  if (data >= end)
+    return 0;
+
+  auto length = 1u;
+  auto mask   = 0x80u;
+
+  while (mask && !(data[0] & mask)) {
+    mask >>= 1;
+    ++length;
+  }
+
+  if (!mask || (length > static_cast<std::size_t>(end - data)) || (is_id && (4 < length)))
+    return 0;
+
+  value   = is_id ? data[0] : data[0] & (mask - 1);
+  unknown = value == (mask - 1);
+
+  for (auto idx = 1u; idx < length; ++idx) {
+    value   = (value << 8) | data[idx];
+    unknown = unknown && (0xff == data[idx]);
+  }
+
+  return length;
+}
+
+// Reads the element header at 'data'. Returns false if it's invalid,
+// if the element's size is unknown or if the element exceeds 'end'.
+bool
+read_element(unsigned char *data,
+             unsigned char *end,
+             element_t &element) {
+  auto id      = uint64_t{};
+  auto size    = uint64_t{};
+  auto unknown = false;
+
+  auto id_length = read_vint(data, end, true, id, unknown);
+  if (!id_length)
+    return false;
+
+  data += id_length;
+
+  auto size_length = read_vint(data, end, false, size, unknown);
+  if (!size_length || unknown)
+    return false;
+
+  data += size_length;
+
+  if (size > static_cast<uint64_t>(end - data))
+    return false;
+
+  element.m_id   = id;
+  element.m_data = data;
+  element.m_size = size;
+
+  return true;
+}
+
+uint64_t
+get_uint(element_t const &element) {
+  return element.m_size ? get_uint_be(element.m_data, std::min<std::size_t>(element.m_size, 8)) : 0;
+}
+
+int64_t
+get_sint(element_t const &element) {
+  if (!element.m_size)
+    return 0;
+
+  auto size  = std::min<std::size_t>(element.m_size, 8);
+  auto value = get_uint_be(element.m_data, size);
+
+  // Sign extension
+  if ((size < 8) && (element.m_data[0] & 0x80))
+    value |= ~uint64_t{} << (size * 8);
+
+  return static_cast<int64_t>(value);
+}
+
+bool
+is(element_t const &element,
+   EbmlId const &id) {
+  return EBML_ID_VALUE(id) == element.m_id;
+}
+
+}
+
+void
+kax_cluster_parser_c::set_timecode_scale(int64_t timecode_scale) {
+  m_timecode_scale = timecode_scale;
+}
+
+void
+kax_cluster_parser_c::set_track_wanted_callback(track_wanted_cb_t const &track_wanted) {
+  m_track_wanted = track_wanted;
+}
+
+bool
+kax_cluster_parser_c::verify_children(unsigned char *data,
+                                      std::size_t size,
+                                      unsigned int level) {
+  auto end     = data + size;
+  auto element = element_t{};
+
+  while (data < end) {
+    if (!read_element(data, end, element))
+      return false;
+
+    // Descend into BlockGroups and BlockAdditions/BlockMore.
+    if (   (   is(element, EBML_ID(KaxBlockGroup))
+            || is(element, EBML_ID(KaxBlockAdditions))
+            || is(element, EBML_ID(KaxBlockMore)))
+        && ((3 < level) || !verify_children(element.m_data, element.m_size, level + 1)))
+      return false;
+
+    data = element.m_data + element.m_size;
+  }
+
+  return true;
+}
+
+bool
+kax_cluster_parser_c::parse(unsigned char *content,
+                            std::size_t size) {
+  m_content          = content;
+  m_end              = content + size;
+  m_next             = content;
+  m_cluster_timecode = 0;
+
+  if (!verify_children(content, size, 0))
+    return false;
+
+  auto element = element_t{};
+
+  for (auto data = m_content; data < m_end; data = element.m_data + element.m_size) {
+    read_element(data, m_end, element);
+
+    if (is(element, EBML_ID(KaxClusterTimecode))) {
+      m_cluster_timecode = get_uint(element);
+      break;
+    }
+  }
+
+  return true;
+}
+
+uint64_t
+kax_cluster_parser_c::get_cluster_timecode()
+  const {
+  return m_cluster_timecode;
+}
+
+kax_cluster_parser_c::block_t const *
+kax_cluster_parser_c::next_block() {
+  auto element = element_t{};
+
+  while (m_next < m_end) {
+    read_element(m_next, m_end, element);
+    m_next = element.m_data + element.m_size;
+
+    m_block.m_num_frames = 0;
+    m_block.m_duration.reset();
+    m_block.m_references.clear();
+    m_block.m_codec_state.reset();
+    m_block.m_discard_padding.reset();
+    m_block.m_block_additions.clear();
+
+    // Blocks with an invalid header or lacing are skipped, the same way
+    // libmatroska treats them, and the following blocks are returned.
+    try {
+      if (is(element, EBML_ID(KaxSimpleBlock))) {
+        parse_block(element.m_data, element.m_size, true);
+        return &m_block;
+      }
+
+      if (is(element, EBML_ID(KaxBlockGroup))) {
+        parse_block_group(element.m_data, element.m_size);
+        if (m_block.m_num_frames)
+          return &m_block;
+      }
+
+    } catch (mtx::kax_cluster_parser_x &) {
+    }
+  }
+
+  return nullptr;
+}
+
+void
+kax_cluster_parser_c::parse_block_group(unsigned char *data,
+                                        std::size_t size) {
+  auto end     = data + size;
+  auto element = element_t{};
+  auto block   = boost::optional<element_t>{};
+
+  // Only the first occurrence of elements that may occur once counts,
+  // same as when using FindChild().
+  for (; data < end; data = element.m_data + element.m_size) {
+    read_element(data, end, element);
+
+    if (is(element, EBML_ID(KaxBlock)) && !block)
+      block = element;
+
+    else if (is(element, EBML_ID(KaxBlockDuration)) && !m_block.m_duration)
+      m_block.m_duration = get_uint(element);
+
+    else if (is(element, EBML_ID(KaxReferenceBlock)))
+      m_block.m_references.push_back(get_sint(element));
+
+    else if (is(element, EBML_ID(KaxCodecState)) && !m_block.m_codec_state)
+      m_block.m_codec_state = frame_t{ element.m_data, element.m_size };
+
+    else if (is(element, EBML_ID(KaxDiscardPadding)) && !m_block.m_discard_padding)
+      m_block.m_discard_padding = get_sint(element);
+
+    else if (is(element, EBML_ID(KaxBlockAdditions)) && m_block.m_block_additions.empty())
+      parse_block_additions(element.m_data, element.m_size);
+  }
+
+  if (block)
+    parse_block(block->m_data, block->m_size, false);
+}
+
+void
+kax_cluster_parser_c::parse_block_additions(unsigned char *data,
+                                            std::size_t size) {
+  auto end     = data + size;
+  auto element = element_t{};
+
+  for (; data < end; data = element.m_data + element.m_size) {
+    read_element(data, end, element);
+
+    if (!is(element, EBML_ID(KaxBlockMore)))
+      continue;
+
+    // A BlockMore without BlockAdditional results in an empty addition.
+    auto addition  = frame_t{ nullptr, 0 };
+    auto more_end  = element.m_data + element.m_size;
+    auto child     = element_t{};
+
+    for (auto more_data = element.m_data; more_data < more_end; more_data = child.m_data + child.m_size) {
+      read_element(more_data, more_end, child);
+
+      if (is(child, EBML_ID(KaxBlockAdditional))) {
+        addition = frame_t{ child.m_data, child.m_size };
+        break;
+      }
+    }
+
+    m_block.m_block_additions.push_back(addition);
+  }
+}
+
+void
+kax_cluster_parser_c::parse_block(unsigned char *data,
+                                  std::size_t size,
+                                  bool simple) {
+  auto end          = data + size;
+  auto track_num    = uint64_t{};
+  auto unknown      = false;
+  auto track_length = read_vint(data, end, false, track_num, unknown);
+
+  if (!track_length || (3 > static_cast<std::size_t>(end - data - track_length)))
+    throw mtx::kax_cluster_parser_x{"block header too short"};
+
+  data             += track_length;
+  auto flags        = data[2];
+  auto lacing       = (flags >> 1) & 0x03;
+
+  m_block.m_simple      = simple;
+  m_block.m_track_num   = track_num;
+  m_block.m_timecode    = (static_cast<int64_t>(m_cluster_timecode) + static_cast<int16_t>(get_uint16_be(data))) * m_timecode_scale;
+  m_block.m_key_frame   = simple && (flags & 0x80);
+  m_block.m_discardable = simple && (flags & 0x01);
+
+  data += 3;
+
+  if (lacing) {
+    if (data >= end)
+      throw mtx::kax_cluster_parser_x{"block lacing header too short"};
+    m_block.m_num_frames = *data + 1;
+
+  } else
+    m_block.m_num_frames = 1;
+
+  m_block.m_frames.clear();
+
+  if (m_track_wanted && !m_track_wanted(track_num))
+    return;
+
+  if (!lacing) {
+    m_block.m_frames.push_back({ data, static_cast<std::size_t>(end - data) });
+    return;
+  }
+
+  parse_lacing(data + 1, end - data - 1, lacing);
+}
+
+void
+kax_cluster_parser_c::parse_lacing(unsigned char *data,
+                                   std::size_t size,
+                                   unsigned int lacing) {
+  auto end        = data + size;
+  auto num_frames = m_block.m_num_frames;
+  auto &frames    = m_block.m_frames;
+
+  // Fixed-size lacing: all frames have the same size.
+  if (2 == lacing) {
+    auto frame_size = size / num_frames;
+    for (auto idx = 0u; idx < num_frames; ++idx)
+      frames.push_back({ data + idx * frame_size, frame_size });
+    return;
+  }
+
+  // Xiph (1) and EBML (3) lacing: the sizes of all but the last frame
+  // are coded; the last one takes up the rest.
+  auto total_size = uint64_t{};
+  auto frame_size = int64_t{};
+
+  for (auto idx = 0u; idx < (num_frames - 1); ++idx) {
+    if (1 == lacing) {
+      auto laced_size = uint64_t{};
+      do {
+        if (data >= end)
+          throw mtx::kax_cluster_parser_x{"Xiph lacing header too short"};
+        laced_size += *data;
+      } while (0xff == *data++);
+
+      frame_size = laced_size;
+
+    } else {
+      auto value   = uint64_t{};
+      auto unknown = false;
+      auto length  = read_vint(data, end, false, value, unknown);
+
+      if (!length)
+        throw mtx::kax_cluster_parser_x{"EBML lacing header too short"};
+
+      // The first size is unsigned, the following ones are signed
+      // differences to the previous size.
+      frame_size = !idx ? static_cast<int64_t>(value) : frame_size + static_cast<int64_t>(value) - ((int64_t{1} << (7 * length - 1)) - 1);
+      data      += length;
+    }
+
+    if (0 > frame_size)
+      throw mtx::kax_cluster_parser_x{"invalid frame size in lacing header"};
+
+    frames.push_back({ nullptr, static_cast<std::size_t>(frame_size) });
+    total_size += frame_size;
+  }
+
+  if (total_size > static_cast<uint64_t>(end - data))
+    throw mtx::kax_cluster_parser_x{"laced frames exceed the block"};
+
+  frames.push_back({ nullptr, static_cast<std::size_t>(end - data - total_size) });
+
+  for (auto &frame : frames) {
+    frame.m_data  = data;
+    data         += frame.m_size;
+  }
+}
@@ -0,0 +1,103 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   flat parser for the blocks in a Matroska cluster
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_KAX_CLUSTER_PARSER_H
+#define MTX_COMMON_KAX_CLUSTER_PARSER_H
+
+#include "common/common_pch.h"
+
+namespace mtx {
+  class kax_cluster_parser_x: public exception {
+  protected:
+    std::string m_message;
+  public:
+    kax_cluster_parser_x(const std::string &message)  : m_message(message)       { }
+    kax_cluster_parser_x(const boost::format &message): m_message(message.str()) { }
+    virtual ~kax_cluster_parser_x() throw() { }
+
+    virtual const char *what() const throw() {
+      return m_message.c_str();
+    }
+  };
+}
+
+/* Iterates over the SimpleBlocks and BlockGroups of a cluster whose
+   content has been read into a single buffer. No libebml elements are
+   created. Frames, block additions and codec states are returned as
+   pointers into that buffer, and the lacing of blocks belonging to
+   tracks the caller isn't interested in isn't parsed at all.
+
+   The vectors in block_t are re-used for each block so that iterating
+   over a cluster doesn't allocate memory once they're big enough. */
+class kax_cluster_parser_c {
+public:
+  struct frame_t {
+    unsigned char *m_data;
+    std::size_t m_size;
+  };
+
+  struct block_t {
+    bool m_simple{}, m_key_frame{}, m_discardable{};
+    uint64_t m_track_num{};
+    int64_t m_timecode{};       // in ns
+    std::size_t m_num_frames{};
+    std::vector<frame_t> m_frames; // empty for tracks that aren't wanted
+
+    // BlockGroups only
+    boost::optional<uint64_t> m_duration; // in timecode scale units
+    std::vector<int64_t> m_references;    // in timecode scale units
+    boost::optional<frame_t> m_codec_state;
+    boost::optional<int64_t> m_discard_padding;
+    std::vector<frame_t> m_block_additions;
+  };
+
+  using track_wanted_cb_t = std::function<bool(uint64_t)>;
+
+protected:
+  unsigned char *m_content{}, *m_end{}, *m_next{};
+  uint64_t m_cluster_timecode{};
+  int64_t m_timecode_scale{1000000};
+  block_t m_block;
+  track_wanted_cb_t m_track_wanted;
+
+public:
+  void set_timecode_scale(int64_t timecode_scale);
+
+  // Only the frames of blocks for which 'track_wanted' returns true are
+  // determined. All tracks are wanted by default.
+  void set_track_wanted_callback(track_wanted_cb_t const &track_wanted);
+
+  // Starts parsing a cluster's content (everything after the cluster's
+  // ID and size). The element structure is verified, and the cluster
+  // timecode is determined. Returns false if the cluster cannot be
+  // handled, e.g. because of children of unknown size or sizes
+  // exceeding their parent's size.
+  bool parse(unsigned char *content, std::size_t size);
+
+  uint64_t get_cluster_timecode() const;
+
+  // Returns the next block or nullptr at the end of the cluster. The
+  // block is only valid until the next call. Blocks whose header or
+  // lacing is invalid are skipped.
+  block_t const *next_block();
+
+protected:
+  void parse_block(unsigned char *data, std::size_t size, bool simple);
+  void parse_block_group(unsigned char *data, std::size_t size);
+  void parse_block_additions(unsigned char *data, std::size_t size);
+  void parse_lacing(unsigned char *data, std::size_t size, unsigned int lacing);
+
+  static bool verify_children(unsigned char *data, std::size_t size, unsigned int level);
+};
+
+#endif  // MTX_COMMON_KAX_CLUSTER_PARSER_H
@@ -297,6 +297,58 @@ kax_file_c::read_next_cluster() {
   return static_cast<KaxCluster *>(read_next_level1_element(EBML_ID_VALUE(EBML_ID(KaxCluster))));
 }
 
+// Reads the content of the next level 1 element into 'buffer' if it is
+// a cluster with a known size that ends within the segment. Its size is
+// stored in 'size'. 'buffer' is re-allocated only if it is too small.
+// Returns false without changing the file position otherwise; the
+// caller must use read_next_cluster() in that case.
+bool
+kax_file_c::read_next_cluster_content(memory_cptr &buffer,
+                                      uint64_t &size) {
+  static auto const s_max_cluster_size = 256 * 1024 * 1024;
+
+  auto start_pos = m_in.getFilePointer();
+  auto end_pos   = m_segment_end ? m_segment_end : m_file_size;
+
+  if (start_pos >= end_pos)
+    return false;
+
+  try {
+    auto id     = vint_c::read_ebml_id(m_in);
+    auto length = vint_c::read(m_in);
+
+    if (   !id.is_valid()
+        || (EBML_ID_VALUE(EBML_ID(KaxCluster)) != id.m_value)
+        || length.is_unknown()
+        || (s_max_cluster_size < length.m_value)
+        || ((m_in.getFilePointer() + length.m_value) > end_pos)) {
+      m_in.setFilePointer(start_pos, seek_beginning);
+      return false;
+    }
+
+    size = length.m_value;
+
+    if (!buffer || (buffer->get_size() < size))
+      buffer = memory_c::alloc(size);
+
+    if (m_in.read(buffer->get_buffer(), size) != size) {
+      m_in.setFilePointer(start_pos, seek_beginning);
+      return false;
+    }
+
+  } catch (mtx::mm_io::exception &) {
+    m_in.setFilePointer(start_pos, seek_beginning);
+    return false;
+  }
+
+  m_resynced         = false;
+  m_resync_start_pos = 0;
+
+  mxdebug_if(m_debug_read_next, boost::format("kax_file::read_next_cluster_content(): cluster at %1% content size %2%\n") % start_pos % size);
+
+  return true;
+}
+
 bool
 kax_file_c::was_resynced() const {
   return m_resynced;
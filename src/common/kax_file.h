@@ -45,6 +45,7 @@ public:
 
   virtual EbmlElement *read_next_level1_element(uint32_t wanted_id = 0, bool report_cluster_timecode = false);
   virtual KaxCluster *read_next_cluster();
+  virtual bool read_next_cluster_content(memory_cptr &buffer, uint64_t &size);
 
   virtual EbmlElement *resync_to_level1_element(uint32_t wanted_id = 0);
   virtual KaxCluster *resync_to_cluster();
@@ -35,6 +35,7 @@
 charset_converter_cptr g_cc_local_utf8;
 
 std::map<std::string, charset_converter_cptr> charset_converter_c::s_converters;
+std::mutex charset_converter_c::s_converters_mutex;
 
 charset_converter_c::charset_converter_c()
   : m_detect_byte_order_marker(false)
@@ -71,6 +72,8 @@ charset_converter_c::init(const std::string &charset,
                           bool ignore_errors) {
   std::string actual_charset = charset.empty() ? get_local_charset() : charset;
 
+  std::lock_guard<std::mutex> lock{s_converters_mutex};
+
   std::map<std::string, charset_converter_cptr>::iterator converter = s_converters.find(actual_charset);
   if (converter != s_converters.end())
     return (*converter).second;
@@ -156,12 +159,20 @@ iconv_charset_converter_c::utf8(const std::string &source) {
   if (handle_string_with_bom(source, recoded))
     return recoded;
 
-  return m_is_utf8 ? source : iconv_charset_converter_c::convert(m_to_utf8_handle, source);
+  if (m_is_utf8)
+    return source;
+
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return iconv_charset_converter_c::convert(m_to_utf8_handle, source);
 }
 
 std::string
 iconv_charset_converter_c::native(const std::string &source) {
-  return m_is_utf8 ? source : iconv_charset_converter_c::convert(m_from_utf8_handle, source);
+  if (m_is_utf8)
+    return source;
+
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return iconv_charset_converter_c::convert(m_from_utf8_handle, source);
 }
 
 std::string
@@ -14,8 +14,60 @@
 #include "common/common_pch.h"
 
 #include "common/memory.h"
+#include "common/memory_pool.h"
 #include "common/error.h"
 
+void *
+memory_c::counter::operator new(size_t size) {
+  auto capacity = size_t{};
+  return mtx::mem::pool_c::get().allocate(size, capacity);
+}
+
+void
+memory_c::counter::operator delete(void *p,
+                                   size_t size) {
+  mtx::mem::pool_c::get().release(static_cast<unsigned char *>(p), mtx::mem::pool_c::get_class_size(size));
+}
+
+memory_c::counter *
+memory_c::create_pooled_counter(size_t size) {
+  auto capacity = size_t{};
+  auto buffer   = mtx::mem::pool_c::get().allocate(size, capacity);
+  auto c        = new counter(buffer, size, true);
+  c->capacity   = capacity;
+
+  return c;
+}
+
+void
+memory_c::free_buffer(counter *c) {
+  if (c->capacity)
+    mtx::mem::pool_c::get().release(c->ptr, c->capacity);
+  else
+    free(c->ptr);
+}
+
+memory_cptr
+memory_c::alloc(size_t size) {
+  auto mem         = std::allocate_shared<memory_c>(mtx::mem::pool_allocator_c<memory_c>{});
+  mem->its_counter = create_pooled_counter(size);
+
+  return mem;
+}
+
+memory_cptr
+memory_c::clone(const void *buffer,
+                size_t size) {
+  auto mem = std::allocate_shared<memory_c>(mtx::mem::pool_allocator_c<memory_c>{});
+  if (!buffer)
+    return mem;
+
+  mem->its_counter = create_pooled_counter(size);
+  memcpy(mem->its_counter->ptr, buffer, size);
+
+  return mem;
+}
+
 void
 memory_c::resize(size_t new_size)
   throw()
@@ -26,16 +78,36 @@ memory_c::resize(size_t new_size)
   if (new_size == its_counter->size)
     return;
 
-  if (its_counter->is_free) {
+  if (its_counter->is_free && its_counter->capacity) {
+    // Pooled buffers are only replaced if they're too small.
+    auto full_size = new_size + its_counter->offset;
+
+    if (full_size > its_counter->capacity) {
+      auto capacity = size_t{};
+      auto tmp      = mtx::mem::pool_c::get().allocate(full_size, capacity);
+      memcpy(tmp, its_counter->ptr, std::min(full_size, its_counter->size));
+      free_buffer(its_counter);
+
+      its_counter->ptr      = tmp;
+      its_counter->capacity = capacity;
+    }
+
+    its_counter->size = full_size;
+
+  } else if (its_counter->is_free) {
     its_counter->ptr  = (unsigned char *)saferealloc(its_counter->ptr, new_size + its_counter->offset);
     its_counter->size = new_size + its_counter->offset;
 
   } else {
     auto tmp = (unsigned char *)safemalloc(new_size);
     memcpy(tmp, its_counter->ptr + its_counter->offset, std::min(new_size, its_counter->size - its_counter->offset));
+    release_foreign_buffer();
+
     its_counter->ptr     = tmp;
     its_counter->is_free = true;
     its_counter->size    = new_size;
+
+    release_parent();
   }
 }
 
@@ -85,6 +85,8 @@ using memories_c  = std::vector<memory_cptr>;
 
 class memory_c {
 public:
+  using releaser_t = void (*)(unsigned char *buffer, size_t size);
+
   explicit memory_c(void *p = nullptr,
                     size_t s = 0,
                     bool f = false) // allocate a new counter
@@ -95,7 +97,7 @@ public:
   }
 
   explicit memory_c(size_t s)
-    : its_counter(new counter(static_cast<unsigned char *>(safemalloc(s)), s, true))
+    : its_counter(create_pooled_counter(s))
   {
   }
 
@@ -142,6 +144,10 @@ public:
     return its_counter && its_counter->ptr;
   }
 
+  bool is_view() const throw() {
+    return its_counter && its_counter->parent;
+  }
+
   memory_cptr clone() const {
     return memory_c::clone(get_buffer(), get_size());
   }
@@ -154,15 +160,23 @@ public:
     if (!its_counter || its_counter->is_free)
       return;
 
-    its_counter->ptr      = static_cast<unsigned char *>(safememdup(get_buffer(), get_size()));
-    its_counter->is_free  = true;
-    its_counter->size    -= its_counter->offset;
-    its_counter->offset   = 0;
+    auto copy = static_cast<unsigned char *>(safememdup(get_buffer(), get_size()));
+    release_foreign_buffer();
+
+    its_counter->ptr       = copy;
+    its_counter->is_free   = true;
+    its_counter->size     -= its_counter->offset;
+    its_counter->offset    = 0;
+    its_counter->capacity  = 0;
+
+    release_parent();
   }
 
   void lock() {
-    if (its_counter)
-      its_counter->is_free = false;
+    if (its_counter) {
+      its_counter->is_free  = false;
+      its_counter->capacity = 0;
+    }
   }
 
   void resize(size_t new_size) throw();
@@ -204,16 +218,10 @@ public:
   }
 
 public:
-  static memory_cptr
-  alloc(size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safemalloc(size)), size, true));
-  };
-
-  static inline memory_cptr
-  clone(const void *buffer,
-        size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safememdup(buffer, size)), size, true));
-  }
+  // Both take their buffers from the global memory pool which
+  // receives them back once they aren't referenced anymore.
+  static memory_cptr alloc(size_t size);
+  static memory_cptr clone(const void *buffer, size_t size);
 
   static inline memory_cptr
   clone(std::string const &buffer) {
@@ -225,6 +233,46 @@ public:
     return std::make_shared<memory_c>(reinterpret_cast<unsigned char *>(&buffer[0]), buffer.length(), false);
   }
 
+  // A view references a part of another buffer without copying
+  // it. The other buffer is kept alive as long as the view
+  // exists. Its content must not be modified or re-allocated
+  // afterwards.
+  static memory_cptr
+  view(memory_c const &parent,
+       size_t offset,
+       size_t size) {
+    if (!parent.its_counter || !parent.get_buffer())
+      return std::make_shared<memory_c>();
+
+    assert((offset + size) <= parent.get_size());
+
+    // Refer to the counter actually owning the buffer so that views
+    // of views don't form chains.
+    auto owner = parent.its_counter;
+    while (owner->parent)
+      owner = owner->parent;
+
+    auto mem                 = std::make_shared<memory_c>(parent.get_buffer() + offset, size, false);
+    mem->its_counter->parent = owner;
+    ++owner->count;
+
+    return mem;
+  }
+
+  // Takes ownership of a buffer that hasn't been allocated with
+  // malloc(), e.g. a memory mapping. 'releaser' is called instead of
+  // free() once neither the buffer nor any view of it is referenced
+  // anymore.
+  static memory_cptr
+  take_ownership(void *buffer,
+                 size_t size,
+                 releaser_t releaser) {
+    auto mem                   = std::make_shared<memory_c>(buffer, size, false);
+    mem->its_counter->releaser = releaser;
+
+    return mem;
+  }
+
 private:
   struct counter {
     unsigned char *ptr;
@@ -232,6 +280,9 @@ private:
     bool is_free;
     unsigned count;
     size_t offset;
+    counter *parent;
+    releaser_t releaser;
+    size_t capacity;            // != 0 if ptr belongs to the memory pool
 
     counter(unsigned char *p = nullptr,
             size_t s = 0,
@@ -242,9 +293,18 @@ private:
       , is_free(f)
       , count(c)
       , offset(0)
+      , parent(nullptr)
+      , releaser(nullptr)
+      , capacity(0)
     { }
+
+    static void *operator new(size_t size);
+    static void operator delete(void *p, size_t size);
   } *its_counter;
 
+  static counter *create_pooled_counter(size_t size);
+  static void free_buffer(counter *c);
+
   void acquire(counter *c) throw() { // increment the count
     its_counter = c;
     if (c)
@@ -252,13 +312,34 @@ private:
   }
 
   void release() { // decrement the count, delete if it is 0
-    if (its_counter) {
-      if (--its_counter->count == 0) {
-        if (its_counter->is_free)
-          free(its_counter->ptr);
-        delete its_counter;
-      }
-      its_counter = 0;
+    release_counter(its_counter);
+    its_counter = 0;
+  }
+
+  void release_foreign_buffer() {
+    if (!its_counter->releaser)
+      return;
+
+    its_counter->releaser(its_counter->ptr, its_counter->size);
+    its_counter->releaser = nullptr;
+  }
+
+  void release_parent() {
+    release_counter(its_counter->parent);
+    its_counter->parent = nullptr;
+  }
+
+  static void release_counter(counter *c) {
+    // Views keep their parents alive; release them, too.
+    while (c && (--c->count == 0)) {
+      if (c->is_free)
+        free_buffer(c);
+      else if (c->releaser)
+        c->releaser(c->ptr, c->size);
+
+      auto parent = c->parent;
+      delete c;
+      c = parent;
     }
   }
 };
@@ -339,6 +420,10 @@ class memory_slice_cursor_c {
     return m_pos;
   };
 
+  std::deque<memory_cptr> const &get_slices() const {
+    return m_slices;
+  }
+
   void reset(bool clear_slices = false) {
     if (clear_slices) {
       m_slices.clear();
@@ -349,6 +434,32 @@ class memory_slice_cursor_c {
     m_slice        = m_slices.begin();
   };
 
+  // Returns a view of the given range if it lies completely within a
+  // single slice whose buffer is owned or kept alive by the slice
+  // itself. Otherwise the range is copied.
+  memory_cptr get_view_or_copy(size_t start, size_t size) {
+    assert((start + size) <= m_size);
+
+    size_t offset = 0;
+
+    for (auto const &slice : m_slices) {
+      auto slice_size = slice->get_size();
+
+      if (start < (offset + slice_size)) {
+        if (((start + size) <= (offset + slice_size)) && (slice->is_free() || slice->is_view()))
+          return memory_c::view(*slice, start - offset, size);
+        break;
+      }
+
+      offset += slice_size;
+    }
+
+    auto mem = memory_c::alloc(size);
+    copy(mem->get_buffer(), start, size);
+
+    return mem;
+  }
+
   void copy(unsigned char *dest, size_t start, size_t size) {
     assert((start + size) <= m_size);
 
@@ -0,0 +1,173 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   size-classed pool for recycling memory buffers
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/memory.h"
+#include "common/memory_pool.h"
+
+namespace mtx { namespace mem {
+
+pool_c::~pool_c() {
+  trim();
+}
+
+std::size_t
+pool_c::get_class_idx(std::size_t size) {
+  if (size <= ms_min_size)
+    return 0;
+
+  // 2^bits < size <= 2^(bits + 1); that range is split into four
+  // classes.
+  auto bits = 0u;
+  for (auto value = size - 1; value > 1; value >>= 1)
+    ++bits;
+
+  auto step = std::size_t{1} << (bits - 2);
+  auto num  = (size + step - 1) / step;
+
+  return 1 + (bits - 6) * 4 + (num - 5);
+}
+
+std::size_t
+pool_c::get_size_of_class(std::size_t idx) {
+  if (!idx)
+    return ms_min_size;
+
+  --idx;
+
+  return (idx % 4 + 5) * (std::size_t{1} << (idx / 4 + 6 - 2));
+}
+
+std::size_t
+pool_c::get_class_size(std::size_t size) {
+  return size > ms_max_size ? 0 : get_size_of_class(get_class_idx(size));
+}
+
+unsigned char *
+pool_c::allocate(std::size_t size,
+                 std::size_t &capacity) {
+  ++m_num_allocations;
+
+  capacity = get_class_size(size);
+
+  if (!capacity) {
+    ++m_num_unpooled;
+    return safemalloc(size);
+  }
+
+  auto &size_class = m_classes[get_class_idx(size)];
+
+  {
+    std::lock_guard<std::mutex> lock{size_class.m_mutex};
+
+    if (!size_class.m_buffers.empty()) {
+      auto buffer = size_class.m_buffers.back();
+      size_class.m_buffers.pop_back();
+
+      m_cached_bytes -= capacity;
+      ++m_num_reused;
+
+      return buffer;
+    }
+  }
+
+  ++m_num_malloced;
+
+  return safemalloc(capacity);
+}
+
+void
+pool_c::release(unsigned char *buffer,
+                std::size_t capacity) {
+  if (!buffer)
+    return;
+
+  ++m_num_released;
+
+  if (!capacity || ((m_cached_bytes + capacity) > ms_cache_limit)) {
+    ++m_num_freed;
+    free(buffer);
+    return;
+  }
+
+  auto &size_class = m_classes[get_class_idx(capacity)];
+
+  {
+    std::lock_guard<std::mutex> lock{size_class.m_mutex};
+    size_class.m_buffers.push_back(buffer);
+  }
+
+  ++m_num_cached;
+
+  auto cached_bytes     = m_cached_bytes += capacity;
+  auto max_cached_bytes = m_max_cached_bytes.load();
+  while ((cached_bytes > max_cached_bytes) && !m_max_cached_bytes.compare_exchange_weak(max_cached_bytes, cached_bytes))
+    ;
+}
+
+void
+pool_c::trim() {
+  for (auto idx = 0u; idx < ms_num_classes; ++idx) {
+    auto &size_class = m_classes[idx];
+    std::lock_guard<std::mutex> lock{size_class.m_mutex};
+
+    for (auto buffer : size_class.m_buffers)
+      free(buffer);
+
+    m_cached_bytes -= size_class.m_buffers.size() * get_size_of_class(idx);
+    m_num_freed    += size_class.m_buffers.size();
+
+    size_class.m_buffers.clear();
+  }
+}
+
+pool_c::statistics_t
+pool_c::get_statistics()
+  const {
+  auto stats               = statistics_t{};
+
+  stats.m_num_allocations  = m_num_allocations;
+  stats.m_num_reused       = m_num_reused;
+  stats.m_num_malloced     = m_num_malloced;
+  stats.m_num_unpooled     = m_num_unpooled;
+  stats.m_num_released     = m_num_released;
+  stats.m_num_cached       = m_num_cached;
+  stats.m_num_freed        = m_num_freed;
+  stats.m_cached_bytes     = m_cached_bytes;
+  stats.m_max_cached_bytes = m_max_cached_bytes;
+
+  return stats;
+}
+
+std::string
+pool_c::format_statistics()
+  const {
+  auto stats = get_statistics();
+
+  return (boost::format("memory pool: %1% allocations (%2% re-used, %3% malloc()ed, %4% too big for the pool); %5% releases (%6% kept for re-use, %7% free()d); %8% bytes cached (maximum %9%)\n")
+          % stats.m_num_allocations % stats.m_num_reused % stats.m_num_malloced % stats.m_num_unpooled
+          % stats.m_num_released    % stats.m_num_cached % stats.m_num_freed
+          % stats.m_cached_bytes    % stats.m_max_cached_bytes).str();
+}
+
+pool_c &
+pool_c::get() {
+  // Never destroyed: buffers held by objects with static storage
+  // duration may still be released after other static objects have
+  // been destroyed.
+  static auto s_pool = new pool_c;
+  return *s_pool;
+}
+
+}}
@@ -0,0 +1,133 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   size-classed pool for recycling memory buffers
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MEMORY_POOL_H
+#define MTX_COMMON_MEMORY_POOL_H
+
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace mtx { namespace mem {
+
+/* Keeps buffers that have been released for re-use by later requests
+   of a similar size. This avoids most calls to malloc() and free() in
+   loops that keep on allocating and releasing buffers of similar
+   sizes, e.g. the packets passed through mkvmerge.
+
+   Requested sizes are rounded up to one of several size classes (four
+   per power of two). Each buffer handed out is a regular malloc()ed
+   block of its class's size. It can therefore be free()d or
+   realloc()ed instead of being released to the pool, e.g. when
+   ownership is transferred elsewhere.
+
+   Requests larger than the biggest size class are passed through to
+   malloc(). The total size of the buffers kept for re-use is
+   limited. The pool is thread-safe. */
+class pool_c {
+public:
+  struct statistics_t {
+    uint64_t m_num_allocations{}, m_num_reused{}, m_num_malloced{}, m_num_unpooled{};
+    uint64_t m_num_released{}, m_num_cached{}, m_num_freed{};
+    uint64_t m_cached_bytes{}, m_max_cached_bytes{};
+  };
+
+  static std::size_t const ms_min_size      = 64;
+  static std::size_t const ms_max_size      = 1024 * 1024;
+  static std::size_t const ms_cache_limit   = 32 * 1024 * 1024;
+
+protected:
+  struct size_class_t {
+    std::mutex m_mutex;
+    std::vector<unsigned char *> m_buffers;
+  };
+
+  static std::size_t const ms_num_classes   = 1 + (20 - 6) * 4;
+
+  size_class_t m_classes[ms_num_classes];
+  std::atomic<uint64_t> m_num_allocations{}, m_num_reused{}, m_num_malloced{}, m_num_unpooled{};
+  std::atomic<uint64_t> m_num_released{}, m_num_cached{}, m_num_freed{};
+  std::atomic<uint64_t> m_cached_bytes{}, m_max_cached_bytes{};
+
+public:
+  ~pool_c();
+
+  // Returns a buffer of at least 'size' bytes. Its usable size is
+  // stored in 'capacity'. It is 0 for buffers larger than the biggest
+  // size class; those are not managed by the pool.
+  unsigned char *allocate(std::size_t size, std::size_t &capacity);
+
+  // Releases a buffer obtained by allocate(). 'capacity' must be the
+  // value returned by allocate(). Buffers with a capacity of 0 are
+  // free()d.
+  void release(unsigned char *buffer, std::size_t capacity);
+
+  // Frees all buffers kept for re-use.
+  void trim();
+
+  statistics_t get_statistics() const;
+  std::string format_statistics() const;
+
+  // Returns the capacity of the buffers handed out for requests of
+  // 'size' bytes, or 0 if they're too big to be pooled.
+  static std::size_t get_class_size(std::size_t size);
+
+  static pool_c &get();
+
+protected:
+  static std::size_t get_class_idx(std::size_t size);
+  static std::size_t get_size_of_class(std::size_t idx);
+};
+
+// An allocator for std::allocate_shared() & co. that takes its memory
+// from the global pool.
+template<typename T>
+class pool_allocator_c {
+public:
+  using value_type = T;
+
+  pool_allocator_c() = default;
+
+  template<typename U>
+  pool_allocator_c(pool_allocator_c<U> const &) {
+  }
+
+  T *
+  allocate(std::size_t num) {
+    auto capacity = std::size_t{};
+    return reinterpret_cast<T *>(pool_c::get().allocate(num * sizeof(T), capacity));
+  }
+
+  void
+  deallocate(T *buffer,
+             std::size_t num) {
+    pool_c::get().release(reinterpret_cast<unsigned char *>(buffer), pool_c::get_class_size(num * sizeof(T)));
+  }
+
+  template<typename U>
+  bool
+  operator ==(pool_allocator_c<U> const &) const {
+    return true;
+  }
+
+  template<typename U>
+  bool
+  operator !=(pool_allocator_c<U> const &) const {
+    return false;
+  }
+};
+
+}}
+
+#endif  // MTX_COMMON_MEMORY_POOL_H
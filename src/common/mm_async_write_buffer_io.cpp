@@ -0,0 +1,293 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_async_write_buffer_io.h"
+#include "common/mm_io_x.h"
+
+mm_async_write_buffer_io_c::mm_async_write_buffer_io_c(mm_io_c *out,
+                                                       std::size_t buffer_size,
+                                                       std::size_t num_buffers,
+                                                       bool delete_out)
+  : mm_write_buffer_io_c(out, buffer_size, delete_out)
+  , m_buffer_position(out->getFilePointer())
+  , m_file_size(out->get_size())
+  , m_writing{}
+  , m_stop{}
+  , m_num_chunks{}
+  , m_num_bytes{}
+  , m_num_waits_for_free_buffer{}
+  , m_num_drains{}
+  , m_debug_async{"write_buffer_io|async_write_buffer_io"}
+{
+  // The current buffer is the one allocated by mm_write_buffer_io_c.
+  for (auto idx = 1u; idx < std::max<std::size_t>(num_buffers, 2); ++idx)
+    m_free_buffers.emplace_back(memory_c::alloc(buffer_size));
+
+  m_writer = std::thread{[this]() { run_writer(); }};
+}
+
+mm_async_write_buffer_io_c::~mm_async_write_buffer_io_c() {
+  // Errors are reported by explicit calls to flush() or close() but
+  // must not escape the destructor.
+  try {
+    close();
+  } catch (...) {
+    discard_buffer();
+    stop_writer();
+  }
+}
+
+mm_io_cptr
+mm_async_write_buffer_io_c::open(const std::string &file_name,
+                                 std::size_t buffer_size,
+                                 std::size_t num_buffers) {
+  return mm_io_cptr(new mm_async_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size, num_buffers));
+}
+
+uint64
+mm_async_write_buffer_io_c::getFilePointer() {
+  return m_buffer_position + m_fill;
+}
+
+void
+mm_async_write_buffer_io_c::setFilePointer(int64 offset,
+                                           seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_file_size      + offset // offsets from the end are negative already
+    :                          getFilePointer() + offset;
+
+  if (new_pos == static_cast<int64_t>(getFilePointer()))
+    return;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{};
+
+  flush_buffer();
+
+  mxdebug_if(m_debug_seek, boost::format("seek from %1% to %2% diff %3%\n") % m_buffer_position % new_pos % (new_pos - m_buffer_position));
+
+  m_buffer_position = new_pos;
+}
+
+int64_t
+mm_async_write_buffer_io_c::get_size() {
+  return m_file_size;
+}
+
+void
+mm_async_write_buffer_io_c::flush() {
+  flush_buffer();
+  drain();
+}
+
+bool
+mm_async_write_buffer_io_c::insert_range(uint64_t position,
+                                         uint64_t length) {
+  // All pending buffers must have been written at their old positions
+  // before the file's content is shifted.
+  flush_buffer();
+  drain();
+
+  if (!mm_proxy_io_c::insert_range(position, length))
+    return false;
+
+  m_file_size += length;
+
+  return true;
+}
+
+void
+mm_async_write_buffer_io_c::close() {
+  if (!m_proxy_io)
+    return;
+
+  flush_buffer();
+  drain();
+  stop_writer();
+
+  mxdebug_if(m_debug_async,
+             boost::format("close(): %1% chunks with %2% bytes written; waited %3% times for a free buffer; drained %4% times\n")
+             % m_num_chunks % m_num_bytes % m_num_waits_for_free_buffer % m_num_drains);
+
+  mm_proxy_io_c::close();
+}
+
+void
+mm_async_write_buffer_io_c::discard_buffer() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  m_fill = 0;
+
+  for (auto const &chunk : m_pending_chunks)
+    m_free_buffers.push_back(chunk.m_data);
+  m_pending_chunks.clear();
+
+  m_cv.wait(lock, [this]() { return !m_writing; });
+
+  // Errors that occurred while writing the discarded content are of no
+  // interest anymore.
+  m_exception = nullptr;
+}
+
+uint32
+mm_async_write_buffer_io_c::_read(void *buffer,
+                                  size_t size) {
+  flush_buffer();
+  drain();
+
+  m_proxy_io->setFilePointer(m_buffer_position);
+  auto num_read      = m_proxy_io->read(buffer, size);
+  m_buffer_position += num_read;
+
+  return num_read;
+}
+
+size_t
+mm_async_write_buffer_io_c::_write(const void *buffer,
+                                   size_t size) {
+  auto src       = static_cast<unsigned char const *>(buffer);
+  auto remaining = size;
+
+  while (remaining) {
+    auto to_copy = std::min(remaining, m_size - m_fill);
+
+    std::memcpy(m_buffer + m_fill, src, to_copy);
+
+    m_fill    += to_copy;
+    src       += to_copy;
+    remaining -= to_copy;
+
+    if (m_fill == m_size)
+      flush_buffer();
+  }
+
+  m_file_size   = std::max<int64_t>(m_file_size, m_buffer_position + m_fill);
+  m_cached_size = -1;
+
+  return size;
+}
+
+void
+mm_async_write_buffer_io_c::flush_buffer() {
+  if (!m_fill)
+    return;
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  rethrow_writer_exception(lock);
+
+  m_pending_chunks.push_back({ m_af_buffer, m_buffer_position, m_fill });
+  m_cv.notify_all();
+
+  ++m_num_chunks;
+  m_num_bytes       += m_fill;
+  m_buffer_position += m_fill;
+  m_fill             = 0;
+
+  if (m_free_buffers.empty()) {
+    ++m_num_waits_for_free_buffer;
+    m_cv.wait(lock, [this]() { return !m_free_buffers.empty() || m_exception; });
+    rethrow_writer_exception(lock);
+  }
+
+  m_af_buffer = m_free_buffers.back();
+  m_buffer    = m_af_buffer->get_buffer();
+  m_free_buffers.pop_back();
+}
+
+void
+mm_async_write_buffer_io_c::drain() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  ++m_num_drains;
+  m_cv.wait(lock, [this]() { return (m_pending_chunks.empty() && !m_writing) || m_exception; });
+
+  rethrow_writer_exception(lock);
+}
+
+void
+mm_async_write_buffer_io_c::stop_writer() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+
+  m_cv.notify_all();
+
+  if (m_writer.joinable())
+    m_writer.join();
+}
+
+void
+mm_async_write_buffer_io_c::rethrow_writer_exception(std::unique_lock<std::mutex> &lock) {
+  if (!m_exception)
+    return;
+
+  // Keep the exception around so that all further operations fail,
+  // too, instead of silently skipping data.
+  auto exception = m_exception;
+  lock.unlock();
+
+  std::rethrow_exception(exception);
+}
+
+void
+mm_async_write_buffer_io_c::run_writer() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  while (true) {
+    m_cv.wait(lock, [this]() { return m_stop || !m_pending_chunks.empty(); });
+
+    if (m_pending_chunks.empty())
+      return;
+
+    auto chunk  = m_pending_chunks.front();
+    auto failed = !!m_exception;
+    m_writing   = true;
+
+    m_pending_chunks.pop_front();
+    lock.unlock();
+
+    auto exception = std::exception_ptr{};
+
+    // Once writing has failed all remaining chunks are dropped.
+    if (!failed) {
+      try {
+        if (m_proxy_io->getFilePointer() != static_cast<uint64_t>(chunk.m_position))
+          m_proxy_io->setFilePointer(chunk.m_position);
+
+        auto written = m_proxy_io->write(chunk.m_data->get_buffer(), chunk.m_size);
+
+        mxdebug_if(m_debug_write, boost::format("run_writer() at %1% for %2% written %3%\n") % chunk.m_position % chunk.m_size % written);
+
+        if (written != chunk.m_size)
+          throw mtx::mm_io::insufficient_space_x();
+
+      } catch (...) {
+        exception = std::current_exception();
+      }
+    }
+
+    lock.lock();
+
+    if (exception)
+      m_exception = exception;
+
+    m_writing = false;
+    m_free_buffers.push_back(chunk.m_data);
+    m_cv.notify_all();
+  }
+}
@@ -0,0 +1,84 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_ASYNC_WRITE_BUFFER_IO_H
+#define MTX_COMMON_MM_ASYNC_WRITE_BUFFER_IO_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "common/mm_write_buffer_io.h"
+
+/* Write buffer whose full buffers are written to the underlying file by
+   a background thread. At most num_buffers buffers of buffer_size bytes
+   each are in use at any time; writing blocks if all of them are still
+   waiting to be written.
+
+   Positions and the file size are tracked here instead of being queried
+   from the underlying file. Seeking hands the current buffer over to the
+   background thread and starts a new one at the new position. As buffers
+   are written in the order they've been handed over, data written later
+   to the same position (e.g. updated headers) always wins. Reading waits
+   for all pending buffers to be written first. */
+class mm_async_write_buffer_io_c: public mm_write_buffer_io_c {
+protected:
+  struct chunk_t {
+    memory_cptr m_data;
+    int64_t m_position;
+    std::size_t m_size;
+  };
+
+  int64_t m_buffer_position, m_file_size;
+  std::vector<memory_cptr> m_free_buffers;
+  std::deque<chunk_t> m_pending_chunks;
+
+  std::thread m_writer;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_writing, m_stop;
+  std::exception_ptr m_exception;
+
+  uint64_t m_num_chunks, m_num_bytes, m_num_waits_for_free_buffer, m_num_drains;
+  debugging_option_c m_debug_async;
+
+public:
+  mm_async_write_buffer_io_c(mm_io_c *out, std::size_t buffer_size, std::size_t num_buffers, bool delete_out = true);
+  virtual ~mm_async_write_buffer_io_c();
+
+  virtual uint64 getFilePointer() override;
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning) override;
+  virtual int64_t get_size() override;
+  virtual void flush() override;
+  virtual void close() override;
+  virtual void discard_buffer() override;
+  virtual bool insert_range(uint64_t position, uint64_t length) override;
+
+  static mm_io_cptr open(const std::string &file_name, std::size_t buffer_size, std::size_t num_buffers);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size) override;
+  virtual size_t _write(const void *buffer, size_t size) override;
+  virtual void flush_buffer() override;
+
+  void drain();
+  void stop_writer();
+  void rethrow_writer_exception(std::unique_lock<std::mutex> &lock);
+  void run_writer();
+};
+
+#endif // MTX_COMMON_MM_ASYNC_WRITE_BUFFER_IO_H
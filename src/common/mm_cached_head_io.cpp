@@ -0,0 +1,142 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_cached_head_io.h"
+#include "common/mm_io_x.h"
+
+mm_cached_head_io_c::mm_cached_head_io_c(mm_io_c *in,
+                                         std::size_t max_head_size,
+                                         bool delete_in)
+  : mm_proxy_io_c(in, delete_in)
+  , m_head_fill{}
+  , m_max_head_size{max_head_size}
+  , m_size{in->get_size()}
+  , m_position{}
+  , m_eof{}
+{
+}
+
+mm_cached_head_io_c::~mm_cached_head_io_c() {
+  close();
+}
+
+uint64
+mm_cached_head_io_c::getFilePointer() {
+  return m_position;
+}
+
+void
+mm_cached_head_io_c::setFilePointer(int64 offset,
+                                    seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_size     + offset // offsets from the end are negative already
+    :                          m_position + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{};
+
+  m_eof      = false;
+  m_position = std::min(new_pos, m_size);
+}
+
+int64_t
+mm_cached_head_io_c::get_size() {
+  return m_size;
+}
+
+bool
+mm_cached_head_io_c::eof() {
+  return m_eof;
+}
+
+void
+mm_cached_head_io_c::clear_eof() {
+  m_eof = false;
+}
+
+memory_cptr
+mm_cached_head_io_c::get_head(std::size_t size) {
+  fill_head(size);
+
+  return memory_c::clone(m_head ? m_head->get_buffer() : nullptr, std::min(size, m_head_fill));
+}
+
+void
+mm_cached_head_io_c::fill_head(std::size_t end) {
+  // Read in larger steps than requested as most callers read the head
+  // in many small pieces.
+  static std::size_t const s_step = 64 * 1024;
+
+  end = std::min<uint64_t>({ ((end + s_step - 1) / s_step) * s_step, m_max_head_size, static_cast<uint64_t>(m_size) });
+  if (end <= m_head_fill)
+    return;
+
+  if (!m_head)
+    m_head = memory_c::alloc(end);
+  else if (m_head->get_size() < end)
+    m_head->resize(end);
+
+  m_proxy_io->setFilePointer(m_head_fill);
+  auto num_read = m_proxy_io->read(m_head->get_buffer() + m_head_fill, end - m_head_fill);
+
+  m_head_fill += num_read;
+
+  // Don't try again if the file is shorter than it claims.
+  if (m_head_fill < end)
+    m_max_head_size = m_head_fill;
+}
+
+uint32
+mm_cached_head_io_c::_read(void *buffer,
+                           size_t size) {
+  auto dst      = static_cast<unsigned char *>(buffer);
+  auto num_read = uint32_t{};
+
+  if (size && (m_position < static_cast<int64_t>(m_max_head_size))) {
+    fill_head(m_position + size);
+
+    if (m_position < static_cast<int64_t>(m_head_fill)) {
+      auto avail = std::min<std::size_t>(size, m_head_fill - m_position);
+      std::memcpy(dst, m_head->get_buffer() + m_position, avail);
+
+      dst        += avail;
+      num_read   += avail;
+      size       -= avail;
+      m_position += avail;
+    }
+  }
+
+  if (size && (m_position < m_size)) {
+    m_proxy_io->setFilePointer(m_position);
+    auto num_read_beyond_head = m_proxy_io->read(dst, size);
+
+    num_read   += num_read_beyond_head;
+    size       -= num_read_beyond_head;
+    m_position += num_read_beyond_head;
+  }
+
+  if (size)
+    m_eof = true;
+
+  return num_read;
+}
+
+size_t
+mm_cached_head_io_c::_write(const void *,
+                            size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
@@ -0,0 +1,53 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_CACHED_HEAD_IO_H
+#define MTX_COMMON_MM_CACHED_HEAD_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Keeps the first max_head_size bytes of a file in memory once they've
+   been read. Meant for code that reads the start of the same file over
+   and over again, e.g. file type detection. The head is read from the
+   underlying file on demand; reading beyond it is passed through. */
+class mm_cached_head_io_c: public mm_proxy_io_c {
+protected:
+  memory_cptr m_head;
+  std::size_t m_head_fill, m_max_head_size;
+  int64_t m_size, m_position;
+  bool m_eof;
+
+public:
+  mm_cached_head_io_c(mm_io_c *in, std::size_t max_head_size, bool delete_in = true);
+  virtual ~mm_cached_head_io_c();
+
+  virtual uint64 getFilePointer() override;
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning) override;
+  virtual int64_t get_size() override;
+  virtual bool eof() override;
+  virtual void clear_eof() override;
+
+  // Returns up to 'size' bytes from the start of the file. Less is
+  // returned only if the file is smaller.
+  memory_cptr get_head(std::size_t size);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size) override;
+  virtual size_t _write(const void *buffer, size_t size) override;
+
+  void fill_head(std::size_t end);
+};
+
+#endif // MTX_COMMON_MM_CACHED_HEAD_IO_H
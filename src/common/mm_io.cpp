@@ -15,6 +15,7 @@
 #include "common/common_pch.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #ifdef HAVE_UNISTD_H
@@ -135,6 +136,48 @@ mm_file_io_c::truncate(int64_t pos) {
   return ftruncate(fileno((FILE *)m_file), pos);
 }
 
+bool
+mm_file_io_c::insert_range(uint64_t position,
+                           uint64_t length) {
+#if defined(FALLOC_FL_INSERT_RANGE)
+  // Data buffered by the C library must reach the file before the
+  // kernel shifts its content.
+  if (fflush((FILE *)m_file) != 0)
+    return false;
+
+  if (fallocate(fileno((FILE *)m_file), FALLOC_FL_INSERT_RANGE, position, length) != 0)
+    return false;
+
+  m_cached_size = -1;
+
+  return true;
+
+#else
+  (void)position;
+  (void)length;
+
+  return false;
+#endif
+}
+
+uint64_t
+mm_file_io_c::get_fs_block_size() {
+  struct stat st;
+
+  if (fstat(fileno((FILE *)m_file), &st) != 0)
+    return 0;
+
+  return st.st_blksize;
+}
+
+void
+mm_file_io_c::advise_sequential_access() {
+#if defined(POSIX_FADV_SEQUENTIAL)
+  // Only a hint for the kernel's read-ahead; failure is irrelevant.
+  posix_fadvise(fileno((FILE *)m_file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
 /** \brief OS and kernel dependant setup
 */
 void
@@ -84,6 +84,17 @@ public:
     return 0;
   }
 
+  // Inserts 'length' bytes of unwritten space at 'position' by shifting
+  // everything behind it towards the end of the file without copying
+  // it. Both values must be multiples of get_fs_block_size(). Returns
+  // false if that isn't supported, leaving the file untouched.
+  virtual bool insert_range(uint64_t, uint64_t) {
+    return false;
+  }
+  virtual uint64_t get_fs_block_size() {
+    return 0;
+  }
+
   virtual std::string get_file_name() const = 0;
 
   virtual std::string getline(boost::optional<std::size_t> max_chars = boost::none);
@@ -114,6 +125,9 @@ public:
   virtual void enable_buffering(bool /* enable */) {
   }
 
+  virtual void advise_sequential_access() {
+  }
+
 protected:
   virtual uint32 _read(void *buffer, size_t size) = 0;
   virtual size_t _write(const void *buffer, size_t size) = 0;
@@ -150,6 +164,12 @@ public:
 
   virtual int truncate(int64_t pos);
 
+#if !defined(SYS_WINDOWS)
+  virtual bool insert_range(uint64_t position, uint64_t length);
+  virtual uint64_t get_fs_block_size();
+  virtual void advise_sequential_access();
+#endif
+
   static void setup();
   static void cleanup();
   static mm_io_cptr open(const std::string &path, const open_mode mode = MODE_READ);
@@ -192,6 +212,13 @@ public:
   virtual std::string get_file_name() const {
     return m_proxy_io->get_file_name();
   }
+  virtual bool insert_range(uint64_t position, uint64_t length) {
+    m_cached_size = -1;
+    return m_proxy_io->insert_range(position, length);
+  }
+  virtual uint64_t get_fs_block_size() {
+    return m_proxy_io->get_fs_block_size();
+  }
   virtual mm_io_c *get_proxied() const {
     return m_proxy_io;
   }
@@ -0,0 +1,242 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+#if defined(SYS_LINUX)
+# include <sys/vfs.h>
+#elif defined(SYS_APPLE) || defined(SYS_BSD)
+# include <sys/param.h>
+# include <sys/mount.h>
+#endif
+
+#include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
+
+namespace {
+
+std::size_t
+default_max_window_size() {
+  // Address space is scarce on 32-bit systems.
+  return sizeof(void *) >= 8 ? std::numeric_limits<std::size_t>::max() : 256 * 1024 * 1024;
+}
+
+#if !defined(SYS_WINDOWS)
+uint64_t
+page_size() {
+  static auto s_page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  return s_page_size;
+}
+
+void
+unmap(unsigned char *buffer,
+      size_t size) {
+  munmap(buffer, size);
+}
+
+/* Accessing a mapping whose pages cannot be read results in SIGBUS
+   instead of an error code. This is likely for network file systems
+   and FUSE, therefore only files on local file systems are mapped. If
+   that cannot be determined, the file isn't mapped either. */
+bool
+is_on_local_file_system(int fd) {
+#if defined(SYS_LINUX)
+  static std::vector<uint32_t> const s_remote_types{
+    0x00006969,                 // NFS
+    0x0000517b,                 // SMB
+    0xff534d42,                 // CIFS
+    0xfe534d42,                 // SMB2
+    0x0000564c,                 // NCP
+    0x73757245,                 // Coda
+    0x5346414f,                 // AFS
+    0x01021997,                 // 9P
+    0x00c36400,                 // Ceph
+    0x65735546,                 // FUSE
+  };
+
+  struct statfs st;
+  return (0 == fstatfs(fd, &st)) && (brng::find(s_remote_types, static_cast<uint32_t>(st.f_type)) == s_remote_types.end());
+
+#elif defined(SYS_APPLE) || defined(SYS_BSD)
+  struct statfs st;
+  return (0 == fstatfs(fd, &st)) && (st.f_flags & MNT_LOCAL);
+
+#else
+  (void)fd;
+  return false;
+#endif
+}
+#endif
+
+}
+
+mm_mmap_io_c::mm_mmap_io_c(std::string const &file_name,
+                           std::size_t max_window_size)
+  : m_file_name{file_name}
+  , m_fd{-1}
+  , m_size{}
+  , m_position{}
+  , m_window_position{}
+  , m_max_window_size{max_window_size ? max_window_size : default_max_window_size()}
+  , m_eof{}
+  , m_debug{"mmap_io"}
+{
+#if defined(SYS_WINDOWS)
+  throw mtx::mm_io::open_x{std::make_error_code(std::errc::not_supported)};
+
+#else
+  auto local_path = g_cc_local_utf8->native(file_name);
+
+  m_fd = ::open(local_path.c_str(), O_RDONLY);
+  if (-1 == m_fd)
+    throw mtx::mm_io::open_x{mtx::mm_io::make_error_code()};
+
+  // Only regular files on local file systems are mapped.
+  struct stat st;
+  if ((0 != fstat(m_fd, &st)) || !S_ISREG(st.st_mode) || !is_on_local_file_system(m_fd)) {
+    ::close(m_fd);
+    throw mtx::mm_io::open_x{std::make_error_code(std::errc::not_supported)};
+  }
+
+  m_size = st.st_size;
+#endif
+}
+
+mm_mmap_io_c::~mm_mmap_io_c() {
+  close();
+}
+
+mm_io_cptr
+mm_mmap_io_c::open(std::string const &file_name) {
+  try {
+    return mm_io_cptr{new mm_mmap_io_c{file_name}};
+  } catch (mtx::mm_io::exception &) {
+    return mm_file_io_c::open(file_name);
+  }
+}
+
+uint64
+mm_mmap_io_c::getFilePointer() {
+  return m_position;
+}
+
+void
+mm_mmap_io_c::setFilePointer(int64 offset,
+                             seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_size     + offset // offsets from the end are negative already
+    :                          m_position + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{};
+
+  m_position = new_pos;
+  m_eof      = false;
+}
+
+int64_t
+mm_mmap_io_c::get_size() {
+  return m_size;
+}
+
+bool
+mm_mmap_io_c::eof() {
+  return m_eof;
+}
+
+void
+mm_mmap_io_c::clear_eof() {
+  m_eof = false;
+}
+
+void
+mm_mmap_io_c::close() {
+  m_window.reset();
+
+#if !defined(SYS_WINDOWS)
+  if (-1 != m_fd) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+#endif
+}
+
+uint32
+mm_mmap_io_c::_read(void *buffer,
+                    size_t size) {
+  auto dst       = static_cast<unsigned char *>(buffer);
+  auto remaining = static_cast<std::size_t>(std::min<int64_t>(size, std::max<int64_t>(m_size - m_position, 0)));
+  auto num_read  = remaining;
+
+  if (remaining < size)
+    m_eof = true;
+
+  while (remaining) {
+    auto src   = map(m_position, 1);
+    auto avail = std::min<uint64_t>(remaining, m_window_position + m_window->get_size() - m_position);
+
+    std::memcpy(dst, src, avail);
+
+    dst        += avail;
+    remaining  -= avail;
+    m_position += avail;
+  }
+
+  return num_read;
+}
+
+size_t
+mm_mmap_io_c::_write(const void *,
+                     size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
+
+unsigned char *
+mm_mmap_io_c::map(int64_t position,
+                  std::size_t size) {
+  if (   m_window
+      && (m_window_position <= position)
+      && ((position + size) <= (m_window_position + m_window->get_size())))
+    return m_window->get_buffer() + (position - m_window_position);
+
+#if defined(SYS_WINDOWS)
+  throw mtx::mm_io::read_write_x{std::make_error_code(std::errc::not_supported)};
+
+#else
+  // Windows must start at page boundaries. They usually span more than
+  // requested so that the following reads are served by the same one.
+  uint64_t window_position = position - (position % page_size());
+  auto window_size         = std::min<uint64_t>(std::max<uint64_t>({ m_max_window_size, page_size(), position - window_position + size }), m_size - window_position);
+
+  m_window.reset();
+
+  auto buffer = mmap(nullptr, window_size, PROT_READ, MAP_PRIVATE, m_fd, window_position);
+  if (MAP_FAILED == buffer)
+    throw mtx::mm_io::read_write_x{mtx::mm_io::make_error_code()};
+
+  mxdebug_if(m_debug, boost::format("map(): window at %1% size %2% for %3% size %4%\n") % window_position % window_size % position % size);
+
+  m_window          = memory_c::take_ownership(buffer, window_size, unmap);
+  m_window_position = window_position;
+
+  return m_window->get_buffer() + (position - m_window_position);
+#endif
+}
@@ -0,0 +1,63 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_MMAP_IO_H
+#define MTX_COMMON_MM_MMAP_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Read-only input served from a memory mapping of the file instead of
+   read() system calls and stdio's buffer.
+
+   The file is mapped in windows of at most max_window_size bytes. A new
+   window is mapped whenever reading leaves the current one. On 64-bit
+   systems the whole file is mapped as a single window by default. */
+class mm_mmap_io_c: public mm_io_c {
+protected:
+  std::string m_file_name;
+  int m_fd;
+  int64_t m_size, m_position, m_window_position;
+  std::size_t m_max_window_size;
+  memory_cptr m_window;
+  bool m_eof;
+  debugging_option_c m_debug;
+
+public:
+  mm_mmap_io_c(std::string const &file_name, std::size_t max_window_size = 0);
+  virtual ~mm_mmap_io_c();
+
+  virtual uint64 getFilePointer() override;
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning) override;
+  virtual int64_t get_size() override;
+  virtual bool eof() override;
+  virtual void clear_eof() override;
+  virtual void close() override;
+
+  virtual std::string get_file_name() const override {
+    return m_file_name;
+  }
+
+  // Falls back to mm_file_io_c if the file cannot be mapped, e.g.
+  // because it isn't a regular file or isn't on a local file system.
+  static mm_io_cptr open(std::string const &file_name);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size) override;
+  virtual size_t _write(const void *buffer, size_t size) override;
+
+  unsigned char *map(int64_t position, std::size_t size);
+};
+
+#endif // MTX_COMMON_MM_MMAP_IO_H
@@ -175,6 +175,12 @@ mm_multi_file_io_c::enable_buffering(bool enable) {
     file.m_file->enable_buffering(enable);
 }
 
+void
+mm_multi_file_io_c::advise_sequential_access() {
+  for (auto &file : m_files)
+    file.m_file->advise_sequential_access();
+}
+
 struct path_sorter_t {
   bfs::path m_path;
   int m_number;
@@ -57,6 +57,7 @@ public:
   virtual void create_verbose_identification_info(mtx::id::info_c &info);
   virtual void display_other_file_info();
   virtual void enable_buffering(bool enable);
+  virtual void advise_sequential_access();
 
   static mm_io_cptr open_multi(const std::string &display_file_name, bool single_only = false);
 
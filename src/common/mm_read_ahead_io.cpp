@@ -0,0 +1,362 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_read_ahead_io.h"
+
+mm_read_ahead_io_c::mm_read_ahead_io_c(mm_io_c *in,
+                                       std::size_t block_size,
+                                       std::size_t num_blocks,
+                                       bool delete_in)
+  : mm_proxy_io_c(in, delete_in)
+  , m_block_size{block_size}
+  , m_size{in->get_size()}
+  , m_position{}
+  , m_eof{}
+  , m_read_ahead_position{}
+  , m_reading_position{-1}
+  , m_end_position{m_size}
+  , m_generation{}
+  , m_buffering{true}
+  , m_reading{}
+  , m_stop{}
+  , m_exception_position{}
+  , m_exception_on_seek{}
+  , m_exception_rethrown{}
+  , m_num_blocks_read{}
+  , m_num_waits{}
+  , m_num_restarts{}
+  , m_debug{"read_ahead_io"}
+{
+  for (auto idx = 0u; idx < std::max<std::size_t>(num_blocks, 2); ++idx)
+    m_free_blocks.emplace_back(memory_c::alloc(block_size));
+
+  in->advise_sequential_access();
+
+  m_reader = std::thread{[this]() { run_reader(); }};
+}
+
+mm_read_ahead_io_c::~mm_read_ahead_io_c() {
+  close();
+}
+
+uint64
+mm_read_ahead_io_c::getFilePointer() {
+  return m_buffering ? m_position : m_proxy_io->getFilePointer();
+}
+
+void
+mm_read_ahead_io_c::setFilePointer(int64 offset,
+                                   seek_mode mode) {
+  if (!m_buffering) {
+    m_proxy_io->setFilePointer(offset, mode);
+    return;
+  }
+
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_size     + offset // offsets from the end are negative already
+    :                          m_position + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{};
+
+  // Seeking to a position the background thread couldn't seek to fails
+  // the same way seeking in the underlying file directly would have.
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    if (m_exception && m_exception_on_seek && !m_exception_rethrown && (new_pos >= m_exception_position))
+      rethrow_exception(lock);
+  }
+
+  // Whether or not the new position has already been read ahead is
+  // only determined by the next read.
+  m_eof      = false;
+  m_position = std::min(new_pos, m_size);
+}
+
+int64_t
+mm_read_ahead_io_c::get_size() {
+  return m_size;
+}
+
+void
+mm_read_ahead_io_c::clear_eof() {
+  if (m_buffering)
+    m_eof = false;
+  else
+    m_proxy_io->clear_eof();
+}
+
+void
+mm_read_ahead_io_c::close() {
+  stop_reader();
+  mm_proxy_io_c::close();
+}
+
+void
+mm_read_ahead_io_c::enable_buffering(bool enable) {
+  if (enable == m_buffering)
+    return;
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  if (!enable) {
+    // Reading directly from the underlying file is only safe once the
+    // background thread has finished its current block.
+    m_buffering = false;
+    ++m_generation;
+
+    m_cv.wait(lock, [this]() { return !m_reading; });
+    release_blocks(lock);
+
+    lock.unlock();
+
+    m_proxy_io->setFilePointer(m_position);
+
+    return;
+  }
+
+  m_position  = m_proxy_io->getFilePointer();
+  m_eof       = false;
+  m_buffering = true;
+
+  restart_reading_ahead(lock);
+}
+
+uint32
+mm_read_ahead_io_c::_read(void *buffer,
+                          size_t size) {
+  if (!m_buffering)
+    return m_proxy_io->read(buffer, size);
+
+  auto dst      = static_cast<unsigned char *>(buffer);
+  auto num_read = uint32_t{};
+
+  while (0 < size) {
+    auto offset = m_position - m_current.m_position;
+
+    if (!m_current.m_data || (0 > offset) || (static_cast<int64_t>(m_current.m_fill) <= offset)) {
+      if (switch_to_next_block())
+        continue;
+
+      m_eof = true;
+      break;
+    }
+
+    auto avail = std::min<std::size_t>(size, m_current.m_fill - offset);
+    std::memcpy(dst, m_current.m_data->get_buffer() + offset, avail);
+
+    dst        += avail;
+    num_read   += avail;
+    size       -= avail;
+    m_position += avail;
+  }
+
+  return num_read;
+}
+
+size_t
+mm_read_ahead_io_c::_write(const void *,
+                           size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
+
+bool
+mm_read_ahead_io_c::switch_to_next_block() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  if (m_current.m_data) {
+    m_free_blocks.push_back(m_current.m_data);
+    m_current.m_data.reset();
+    m_cv.notify_all();
+  }
+
+  while (true) {
+    // Drop blocks that have been skipped.
+    while (!m_filled_blocks.empty() && ((m_filled_blocks.front().m_position + static_cast<int64_t>(m_filled_blocks.front().m_fill)) <= m_position)) {
+      m_free_blocks.push_back(m_filled_blocks.front().m_data);
+      m_filled_blocks.pop_front();
+      m_cv.notify_all();
+    }
+
+    if (!m_filled_blocks.empty() && (m_filled_blocks.front().m_position <= m_position)) {
+      m_current = m_filled_blocks.front();
+      m_filled_blocks.pop_front();
+
+      return true;
+    }
+
+    if (   m_exception
+        && (m_position >= m_exception_position)
+        && (m_position <  (m_exception_position + static_cast<int64_t>(m_block_size)))) {
+      if (!m_exception_rethrown)
+        rethrow_exception(lock);
+
+      restart_reading_ahead(lock);
+      continue;
+    }
+
+    // After an error the end position is that of the failing block, not
+    // the end of the file.
+    if ((m_position >= m_end_position) && !m_exception)
+      return false;
+
+    // The blocks read ahead and the one currently being read are
+    // contiguous. Anything outside of them requires starting over.
+    auto start = !m_filled_blocks.empty() ? m_filled_blocks.front().m_position
+               : -1 != m_reading_position ? m_reading_position
+               :                            m_read_ahead_position;
+
+    if ((m_position < start) || (m_position > m_read_ahead_position)) {
+      restart_reading_ahead(lock);
+      continue;
+    }
+
+    ++m_num_waits;
+    m_cv.wait(lock);
+  }
+}
+
+void
+mm_read_ahead_io_c::restart_reading_ahead(std::unique_lock<std::mutex> &lock) {
+  mxdebug_if(m_debug, boost::format("restart_reading_ahead() from %1% to %2%\n") % m_read_ahead_position % m_position);
+
+  // A block still being read for the old position is dropped by the
+  // background thread once it notices the generation change.
+  ++m_num_restarts;
+  ++m_generation;
+
+  release_blocks(lock);
+
+  // Errors are retried after seeking.
+  m_exception           = nullptr;
+  m_exception_rethrown  = false;
+  m_read_ahead_position = m_position;
+  m_end_position        = m_size;
+
+  m_cv.notify_all();
+}
+
+void
+mm_read_ahead_io_c::release_blocks(std::unique_lock<std::mutex> &) {
+  if (m_current.m_data) {
+    m_free_blocks.push_back(m_current.m_data);
+    m_current.m_data.reset();
+  }
+
+  for (auto const &block : m_filled_blocks)
+    m_free_blocks.push_back(block.m_data);
+
+  m_filled_blocks.clear();
+  m_reading_position = -1;
+}
+
+void
+mm_read_ahead_io_c::rethrow_exception(std::unique_lock<std::mutex> &) {
+  mxdebug_if(m_debug, boost::format("rethrow_exception() for position %1%\n") % m_exception_position);
+
+  m_exception_rethrown = true;
+  std::rethrow_exception(m_exception);
+}
+
+void
+mm_read_ahead_io_c::stop_reader() {
+  if (!m_reader.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+
+  m_cv.notify_all();
+  m_reader.join();
+
+  mxdebug_if(m_debug,
+             boost::format("stop_reader(): %1% blocks read; waited %2% times for a block; restarted %3% times\n")
+             % m_num_blocks_read % m_num_waits % m_num_restarts);
+}
+
+void
+mm_read_ahead_io_c::run_reader() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  while (true) {
+    m_cv.wait(lock, [this]() { return m_stop || (m_buffering && !m_free_blocks.empty() && (m_read_ahead_position < m_end_position)); });
+
+    if (m_stop)
+      return;
+
+    auto data       = m_free_blocks.back();
+    auto position   = m_read_ahead_position;
+    auto generation = m_generation;
+    auto to_read    = static_cast<std::size_t>(std::min<int64_t>(m_block_size, m_end_position - position));
+
+    m_free_blocks.pop_back();
+    m_reading_position     = position;
+    m_read_ahead_position += to_read;
+    m_reading              = true;
+
+    lock.unlock();
+
+    auto num_read  = std::size_t{};
+    auto exception = std::exception_ptr{};
+    auto on_seek   = false;
+
+    try {
+      if (m_proxy_io->getFilePointer() != static_cast<uint64_t>(position)) {
+        on_seek = true;
+        m_proxy_io->setFilePointer(position);
+        on_seek = false;
+      }
+
+      num_read = m_proxy_io->read(data->get_buffer(), to_read);
+
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    lock.lock();
+
+    ++m_num_blocks_read;
+    m_reading = false;
+
+    if ((generation == m_generation) && num_read)
+      m_filled_blocks.push_back({ data, position, num_read });
+    else
+      m_free_blocks.push_back(data);
+
+    if (generation == m_generation) {
+      m_reading_position = -1;
+
+      // Reading ahead stops at the failing position.
+      if (exception) {
+        m_exception          = exception;
+        m_exception_position = position;
+        m_exception_on_seek  = on_seek;
+        m_exception_rethrown = false;
+      }
+
+      if (num_read < to_read) {
+        m_end_position        = position + num_read;
+        m_read_ahead_position = m_end_position;
+      }
+    }
+
+    m_cv.notify_all();
+  }
+}
@@ -0,0 +1,97 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_READ_AHEAD_IO_H
+#define MTX_COMMON_MM_READ_AHEAD_IO_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "common/mm_io.h"
+
+/* Read buffer whose buffers are filled by a background thread. The
+   thread reads num_blocks blocks of block_size bytes each ahead of the
+   current position so that reading from the disk overlaps with parsing
+   the data read before.
+
+   Reading ahead is sequential. Seeking within the data that has
+   already been read ahead is cheap; seeking anywhere else discards it
+   and restarts reading ahead at the new position. */
+class mm_read_ahead_io_c: public mm_proxy_io_c {
+protected:
+  struct block_t {
+    memory_cptr m_data;
+    int64_t m_position{};
+    std::size_t m_fill{};
+  };
+
+  std::size_t const m_block_size;
+  int64_t m_size, m_position;
+  bool m_eof;
+
+  // Only accessed by the thread reading from this object.
+  block_t m_current;
+
+  // Shared with the background thread; protected by m_mutex.
+  std::deque<block_t> m_filled_blocks;
+  std::vector<memory_cptr> m_free_blocks;
+  int64_t m_read_ahead_position, m_reading_position, m_end_position;
+  unsigned int m_generation;
+  bool m_buffering, m_reading, m_stop;
+
+  // An error the background thread ran into while seeking to or reading
+  // from m_exception_position. It's rethrown once on the reading thread
+  // when that position is reached; the next access retries.
+  std::exception_ptr m_exception;
+  int64_t m_exception_position;
+  bool m_exception_on_seek, m_exception_rethrown;
+
+  std::thread m_reader;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+
+  uint64_t m_num_blocks_read, m_num_waits, m_num_restarts;
+  debugging_option_c m_debug;
+
+public:
+  mm_read_ahead_io_c(mm_io_c *in, std::size_t block_size, std::size_t num_blocks, bool delete_in = true);
+  virtual ~mm_read_ahead_io_c();
+
+  virtual uint64 getFilePointer() override;
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning) override;
+  virtual int64_t get_size() override;
+  virtual bool eof() override {
+    return m_buffering ? m_eof : m_proxy_io->eof();
+  }
+  virtual void clear_eof() override;
+  virtual void close() override;
+  virtual void enable_buffering(bool enable) override;
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size) override;
+  virtual size_t _write(const void *buffer, size_t size) override;
+
+  bool switch_to_next_block();
+  void restart_reading_ahead(std::unique_lock<std::mutex> &lock);
+  void release_blocks(std::unique_lock<std::mutex> &lock);
+  void rethrow_exception(std::unique_lock<std::mutex> &lock);
+  void stop_reader();
+  void run_reader();
+};
+
+#endif // MTX_COMMON_MM_READ_AHEAD_IO_H
@@ -161,10 +161,20 @@ mm_read_buffer_io_c::_write(const void *,
 
 void
 mm_read_buffer_io_c::enable_buffering(bool enable) {
-  m_buffering = enable;
-  if (!m_buffering) {
+  if (enable == m_buffering)
+    return;
+
+  // Keep the current position when switching: unbuffered reads must
+  // continue where the buffered ones left off and vice versa.
+  if (!enable) {
+    m_proxy_io->setFilePointer(m_offset + m_cursor, seek_beginning);
     m_offset = 0;
-    m_cursor = 0;
-    m_fill   = 0;
-  }
+
+  } else
+    m_offset = m_proxy_io->getFilePointer();
+
+  m_buffering = enable;
+  m_cursor    = 0;
+  m_fill      = 0;
+  m_eof       = false;
 }
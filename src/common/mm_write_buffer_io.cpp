@@ -78,6 +78,13 @@ mm_write_buffer_io_c::close() {
   mm_proxy_io_c::close();
 }
 
+bool
+mm_write_buffer_io_c::insert_range(uint64_t position,
+                                   uint64_t length) {
+  flush_buffer();
+  return mm_proxy_io_c::insert_range(position, length);
+}
+
 uint32
 mm_write_buffer_io_c::_read(void *buffer,
                             size_t size) {
@@ -36,6 +36,7 @@ public:
   virtual void flush();
   virtual void close();
   virtual void discard_buffer();
+  virtual bool insert_range(uint64_t position, uint64_t length);
 
   static mm_io_cptr open(const std::string &file_name, size_t buffer_size);
 
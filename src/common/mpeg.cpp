@@ -12,32 +12,316 @@
 
 #include "common/common_pch.h"
 
+#include "common/cpu_features.h"
+
+#if defined(MTX_HAVE_X86_SIMD)
+# include <immintrin.h>
+#endif
+
 #include "common/debugging.h"
 #include "common/endian.h"
 #include "common/mpeg.h"
 
 namespace mtx { namespace mpeg {
 
+namespace {
+
+using sequence_finder_t = std::size_t (*)(unsigned char const *, std::size_t, unsigned char);
+
+std::size_t
+find_three_byte_sequence_scalar(unsigned char const *buffer,
+                                std::size_t size,
+                                unsigned char third_byte) {
+  if (size < 3)
+    return size;
+
+  auto end = size - 2;
+  auto pos = std::size_t{};
+
+  // The third byte is never 0. If it doesn't match then neither this
+  // position nor the two following ones can start the sequence.
+  while (pos < end) {
+    auto byte = buffer[pos + 2];
+
+    if (byte == third_byte) {
+      if (!buffer[pos + 1] && !buffer[pos])
+        return pos;
+      pos += 3;
+
+    } else if (byte)
+      pos += 3;
+
+    else
+      ++pos;
+  }
+
+  return size;
+}
+
+#if defined(MTX_HAVE_X86_SIMD)
+MTX_TARGET("sse2") std::size_t
+find_three_byte_sequence_sse2(unsigned char const *buffer,
+                              std::size_t size,
+                              unsigned char third_byte) {
+  auto zero  = _mm_setzero_si128();
+  auto third = _mm_set1_epi8(static_cast<char>(third_byte));
+  auto pos   = std::size_t{};
+
+  while ((pos + 18) <= size) {
+    auto first  = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer + pos)),     zero);
+    auto second = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer + pos + 1)), zero);
+    auto last   = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer + pos + 2)), third);
+    auto mask   = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(first, second), last)));
+
+    if (mask)
+      return pos + __builtin_ctz(mask);
+
+    pos += 16;
+  }
+
+  return pos + find_three_byte_sequence_scalar(buffer + pos, size - pos, third_byte);
+}
+
+MTX_TARGET("avx2") std::size_t
+find_three_byte_sequence_avx2(unsigned char const *buffer,
+                              std::size_t size,
+                              unsigned char third_byte) {
+  auto zero  = _mm256_setzero_si256();
+  auto third = _mm256_set1_epi8(static_cast<char>(third_byte));
+  auto pos   = std::size_t{};
+
+  while ((pos + 34) <= size) {
+    auto first  = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(buffer + pos)),     zero);
+    auto second = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(buffer + pos + 1)), zero);
+    auto last   = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(buffer + pos + 2)), third);
+    auto mask   = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(first, second), last)));
+
+    if (mask)
+      return pos + __builtin_ctz(mask);
+
+    pos += 32;
+  }
+
+  return pos + find_three_byte_sequence_sse2(buffer + pos, size - pos, third_byte);
+}
+#endif  // MTX_HAVE_X86_SIMD
+
+sequence_finder_t
+select_sequence_finder() {
+#if defined(MTX_HAVE_X86_SIMD)
+  if (mtx::cpu::has(mtx::cpu::feature_e::avx2))
+    return find_three_byte_sequence_avx2;
+  if (mtx::cpu::has(mtx::cpu::feature_e::sse2))
+    return find_three_byte_sequence_sse2;
+#endif
+
+  return find_three_byte_sequence_scalar;
+}
+
+using ts_pid_extractor_t = std::size_t (*)(unsigned char const *, std::size_t, std::size_t, uint16_t *);
+
+std::size_t
+extract_ts_pids_scalar(unsigned char const *buffer,
+                       std::size_t num_packets,
+                       std::size_t packet_size,
+                       uint16_t *pids) {
+  for (auto idx = std::size_t{}; idx < num_packets; ++idx, buffer += packet_size) {
+    if (0x47 != buffer[0])
+      return idx;
+
+    pids[idx] = ((static_cast<uint16_t>(buffer[1]) & 0x1f) << 8) | buffer[2];
+  }
+
+  return num_packets;
+}
+
+#if defined(MTX_HAVE_X86_SIMD)
+// Gathers the first four bytes of eight packets at once. In each
+// little endian 32-bit value the sync byte is the lowest byte, followed
+// by the PID's most significant bits and its least significant byte.
+MTX_TARGET("avx2") std::size_t
+extract_ts_pids_avx2(unsigned char const *buffer,
+                     std::size_t num_packets,
+                     std::size_t packet_size,
+                     uint16_t *pids) {
+  auto offsets   = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(packet_size)));
+  auto sync_mask = _mm256_set1_epi32(0xff);
+  auto sync_byte = _mm256_set1_epi32(0x47);
+  auto msb_mask  = _mm256_set1_epi32(0x1f00);
+  auto lsb_mask  = _mm256_set1_epi32(0xff);
+  auto idx       = std::size_t{};
+
+  for (; (idx + 8) <= num_packets; idx += 8) {
+    auto headers = _mm256_i32gather_epi32(reinterpret_cast<int const *>(buffer + idx * packet_size), offsets, 1);
+    auto synced  = _mm256_cmpeq_epi32(_mm256_and_si256(headers, sync_mask), sync_byte);
+
+    if (0xff != _mm256_movemask_ps(_mm256_castsi256_ps(synced)))
+      break;
+
+    auto values = _mm256_or_si256(_mm256_and_si256(headers, msb_mask), _mm256_and_si256(_mm256_srli_epi32(headers, 16), lsb_mask));
+
+    // Packing works on each 128-bit lane; the permutation moves the
+    // eight 16-bit values into the lower half.
+    values = _mm256_permute4x64_epi64(_mm256_packus_epi32(values, values), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pids + idx), _mm256_castsi256_si128(values));
+  }
+
+  return idx + extract_ts_pids_scalar(buffer + idx * packet_size, num_packets - idx, packet_size, pids + idx);
+}
+#endif  // MTX_HAVE_X86_SIMD
+
+ts_pid_extractor_t
+select_ts_pid_extractor() {
+#if defined(MTX_HAVE_X86_SIMD)
+  if (mtx::cpu::has(mtx::cpu::feature_e::avx2))
+    return extract_ts_pids_avx2;
+#endif
+
+  return extract_ts_pids_scalar;
+}
+
+}
+
+/** \brief Finds the first occurrence of the sequence <tt>00 00 third_byte</tt>
+
+   \c third_byte must not be 0.
+
+   \return The offset of the sequence's first byte or \c size if the
+     sequence isn't present.
+*/
+std::size_t
+find_three_byte_sequence(unsigned char const *buffer,
+                         std::size_t size,
+                         unsigned char third_byte) {
+  static auto s_finder = select_sequence_finder();
+
+  return s_finder(buffer, size, third_byte);
+}
+
+/** \brief Extracts the PIDs of consecutive MPEG transport stream packets
+
+   \c buffer must start with a packet's sync byte. Packets are \c
+   packet_size bytes apart, e.g. 188 for plain transport streams and
+   192 for M2TS whose four-byte packet prefix precedes the next sync
+   byte. The PID of packet \c n is stored in <tt>pids[n]</tt>.
+
+   \return The number of packets before the first one that doesn't
+     start with a sync byte, or \c num_packets if all of them do.
+*/
+std::size_t
+extract_ts_pids(unsigned char const *buffer,
+                std::size_t num_packets,
+                std::size_t packet_size,
+                uint16_t *pids) {
+  static auto s_extractor = select_ts_pid_extractor();
+
+  return s_extractor(buffer, num_packets, packet_size, pids);
+}
+
+/** \brief Finds all NALU start codes in all of a cursor's slices
+
+   Each slice is searched on its own with the fast start code
+   finder. Only the few bytes around slice boundaries are examined
+   with a copy of the data.
+
+   \c handle_start_code is called for each start code in increasing
+   order with the start code's position relative to the start of the
+   first slice and its size (3 for <tt>00 00 01</tt> and 4 for <tt>00 00
+   00 01</tt>).
+*/
+void
+find_start_codes(memory_slice_cursor_c &cursor,
+                 std::function<void(std::size_t, std::size_t)> const &handle_start_code) {
+  auto total_size  = cursor.get_size();
+  auto slice_start = std::size_t{};
+  unsigned char around_boundary[5];
+
+  auto preceded_by_zero = [&cursor](std::size_t position) -> bool {
+    if (!position)
+      return false;
+
+    unsigned char previous_byte;
+    cursor.copy(&previous_byte, position - 1, 1);
+
+    return !previous_byte;
+  };
+
+  // Slices shorter than three bytes mean that the same position can
+  // be looked at for more than one boundary.
+  auto next_position = std::size_t{};
+
+  auto report = [&handle_start_code, &preceded_by_zero, &next_position](std::size_t position) {
+    if (position < next_position)
+      return;
+
+    auto marker_size = preceded_by_zero(position) ? 4 : 3;
+    handle_start_code(position + 3 - marker_size, marker_size);
+
+    next_position = position + 3;
+  };
+
+  for (auto const &slice : cursor.get_slices()) {
+    auto buffer = slice->get_buffer();
+    auto size   = slice->get_size();
+
+    if (slice_start) {
+      // Start codes spanning the boundary to the previous slice
+      auto copy_start = slice_start - std::min<std::size_t>(slice_start, 2);
+      auto copy_size  = std::min<std::size_t>(total_size, slice_start + 2) - copy_start;
+
+      cursor.copy(around_boundary, copy_start, copy_size);
+
+      for (auto idx = std::size_t{}; (idx + 2) < copy_size; ++idx)
+        if (!around_boundary[idx] && !around_boundary[idx + 1] && (0x01 == around_boundary[idx + 2]))
+          report(copy_start + idx);
+    }
+
+    auto offset = std::size_t{};
+
+    while (offset < size) {
+      offset += find_start_code(buffer + offset, size - offset);
+      if (offset >= size)
+        break;
+
+      if (offset) {
+        auto marker_size = buffer[offset - 1] ? 3 : 4;
+        handle_start_code(slice_start + offset + 3 - marker_size, marker_size);
+        next_position = slice_start + offset + 3;
+
+      } else
+        report(slice_start);
+
+      offset += 3;
+    }
+
+    slice_start += size;
+  }
+}
+
 memory_cptr
 nalu_to_rbsp(memory_cptr const &buffer) {
-  int pos, size = buffer->get_size();
-  mm_mem_io_c d(nullptr, size, 100);
-  unsigned char *b = buffer->get_buffer();
+  auto size     = buffer->get_size();
+  auto src      = buffer->get_buffer();
+  auto rbsp     = memory_c::alloc(size);
+  auto dst      = rbsp->get_buffer();
+  auto src_pos  = std::size_t{};
+  auto dst_pos  = std::size_t{};
 
-  for (pos = 0; pos < size; ++pos) {
-    if (   ((pos + 2) < size)
-        && (0 == b[pos])
-        && (0 == b[pos + 1])
-        && (3 == b[pos + 2])) {
-      d.write_uint8(0);
-      d.write_uint8(0);
-      pos += 2;
+  // Copy everything up to and including each 00 00 of a 00 00 03
+  // sequence in one go, dropping the emulation prevention byte.
+  while (src_pos < size) {
+    auto found    = src_pos + find_three_byte_sequence(src + src_pos, size - src_pos, 0x03);
+    auto copy_end = found < size ? found + 2 : size;
 
-    } else
-      d.write_uint8(b[pos]);
+    std::memcpy(dst + dst_pos, src + src_pos, copy_end - src_pos);
+
+    dst_pos += copy_end - src_pos;
+    src_pos  = found < size ? found + 3 : size;
   }
 
-  return std::make_shared<memory_c>(d.get_and_lock_buffer(), d.getFilePointer(), true);
+  rbsp->set_size(dst_pos);
+
+  return rbsp;
 }
 
 memory_cptr
@@ -41,6 +41,18 @@ public:
   }
 };
 
+std::size_t find_three_byte_sequence(unsigned char const *buffer, std::size_t size, unsigned char third_byte);
+
+inline std::size_t
+find_start_code(unsigned char const *buffer,
+                std::size_t size) {
+  return find_three_byte_sequence(buffer, size, 0x01);
+}
+
+void find_start_codes(memory_slice_cursor_c &cursor, std::function<void(std::size_t, std::size_t)> const &handle_start_code);
+
+std::size_t extract_ts_pids(unsigned char const *buffer, std::size_t num_packets, std::size_t packet_size, uint16_t *pids);
+
 memory_cptr nalu_to_rbsp(memory_cptr const &buffer);
 memory_cptr rbsp_to_nalu(memory_cptr const &buffer);
 
@@ -261,6 +261,7 @@ protected:
   struct stats_t {
     std::vector<int> num_slices_by_type;
     size_t num_frames_out{}, num_frames_discarded{}, num_timecodes_in{}, num_timecodes_generated{}, num_timecodes_discarded{}, num_field_slices{}, num_frame_slices{}, num_sei_nalus{}, num_idr_slices{};
+    size_t num_nalus_copied{}, num_nalus_referenced{};
 
     stats_t()
       : num_slices_by_type(11, 0)
@@ -302,9 +303,7 @@ public:
   }
 
   void add_bytes(unsigned char *buf, size_t size);
-  void add_bytes(memory_cptr &buf) {
-    add_bytes(buf->get_buffer(), buf->get_size());
-  }
+  void add_bytes(memory_cptr const &buf);
 
   void flush();
 
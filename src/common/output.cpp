@@ -14,6 +14,7 @@
 #include "common/common_pch.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <mutex>
 #include <sstream>
 
 #include "common/command_line.h"
@@ -39,6 +40,9 @@ std::shared_ptr<mm_io_c> g_mm_stdio   = std::shared_ptr<mm_io_c>(new mm_stdio_c)
 
 static mxmsg_handler_t s_mxmsg_info_handler, s_mxmsg_warning_handler, s_mxmsg_error_handler;
 static std::vector<std::string> s_warnings_emitted, s_errors_emitted;
+// mkvmerge's readers and mkvextract's extractors may run on threads of
+// their own.
+static std::recursive_mutex s_mxmsg_mutex;
 
 static nlohmann::json
 to_json_array(std::vector<std::string> const &messages) {
@@ -50,8 +54,45 @@ to_json_array(std::vector<std::string> const &messages) {
   return result;
 }
 
+static thread_local mtx::output::json_capture_c *s_json_capture = nullptr;
+static thread_local bool s_errors_as_exceptions = false;
+
+namespace mtx { namespace output {
+
+json_capture_c::json_capture_c() {
+  s_json_capture = this;
+}
+
+json_capture_c::~json_capture_c() {
+  s_json_capture = nullptr;
+}
+
+json_capture_c *
+json_capture_c::current() {
+  return s_json_capture;
+}
+
+errors_as_exceptions_c::errors_as_exceptions_c() {
+  s_errors_as_exceptions = true;
+}
+
+errors_as_exceptions_c::~errors_as_exceptions_c() {
+  s_errors_as_exceptions = false;
+}
+
+}}
+
 void
 display_json_output(nlohmann::json json) {
+  if (s_json_capture) {
+    if (s_json_capture->m_result.is_null()) {
+      json["warnings"]         = to_json_array(s_json_capture->m_warnings);
+      json["errors"]           = to_json_array(s_json_capture->m_errors);
+      s_json_capture->m_result = json;
+    }
+    return;
+  }
+
   json["warnings"] = to_json_array(s_warnings_emitted);
   json["errors"]   = to_json_array(s_errors_emitted);
 
@@ -61,11 +102,28 @@ display_json_output(nlohmann::json json) {
 static void
 json_warning_error_handler(unsigned int level,
                            std::string const &message) {
-  if (MXMSG_WARNING == level)
+  if (s_json_capture) {
+    if (MXMSG_WARNING == level)
+      s_json_capture->m_warnings.push_back(message);
+
+    else {
+      s_json_capture->m_errors.push_back(message);
+      display_json_output(nlohmann::json{});
+      mxexit(2);
+    }
+
+    return;
+  }
+
+  if (MXMSG_WARNING == level) {
+    std::lock_guard<std::recursive_mutex> lock{s_mxmsg_mutex};
     s_warnings_emitted.push_back(message);
 
-  else {
-    s_errors_emitted.push_back(message);
+  } else {
+    {
+      std::lock_guard<std::recursive_mutex> lock{s_mxmsg_mutex};
+      s_errors_emitted.push_back(message);
+    }
     display_json_output(nlohmann::json{});
     mxexit(2);
   }
@@ -112,6 +170,8 @@ mxmsg(unsigned int level,
   if (g_suppress_info && (MXMSG_INFO == level))
     return;
 
+  std::lock_guard<std::recursive_mutex> lock{s_mxmsg_mutex};
+
   if ('\n' == message[0]) {
     message.erase(0, 1);
     g_mm_stdio->puts("\n");
@@ -178,6 +238,8 @@ default_mxwarn(unsigned int,
   if (g_suppress_warnings)
     return;
 
+  std::lock_guard<std::recursive_mutex> lock{s_mxmsg_mutex};
+
   mxmsg(MXMSG_WARNING, warning);
 
   g_warning_issued = true;
@@ -198,6 +260,9 @@ default_mxerror(unsigned int,
 
 void
 mxerror(std::string const &error) {
+  if (s_errors_as_exceptions)
+    throw mtx::output::error_x{error};
+
   if (s_mxmsg_error_handler)
     s_mxmsg_error_handler(MXMSG_ERROR, error);
 }
@@ -18,8 +18,10 @@
 
 #include <functional>
 
+#include <boost/optional.hpp>
 #include <ebml/EbmlElement.h>
 
+#include "common/error.h"
 #include "common/json.h"
 #include "common/locale.h"
 #include "common/mm_io.h"
@@ -40,6 +42,69 @@ bool stdio_redirected();
 void redirect_warnings_and_errors_to_json();
 void display_json_output(nlohmann::json json);
 
+namespace mtx { namespace output {
+
+// While an object of this class exists, the JSON output as well as the
+// warnings and errors of the thread that created it are collected in it
+// instead of being output. Only the first JSON output and the exit code
+// of the first attempt to exit the program are kept.
+class json_capture_c {
+public:
+  nlohmann::json m_result;
+  std::vector<std::string> m_warnings, m_errors;
+  boost::optional<int> m_exit_code;
+
+public:
+  json_capture_c();
+  ~json_capture_c();
+
+  static json_capture_c *current();
+};
+
+// Thrown by mxexit() instead of terminating the program if the calling
+// thread's output is being captured.
+class exit_x: public mtx::exception {
+public:
+  int m_code;
+
+public:
+  explicit exit_x(int code)
+    : m_code{code}
+  {
+  }
+
+  virtual const char *what() const throw() {
+    return "program exit requested while output is being captured";
+  }
+};
+
+// While an object of this class exists, mxerror() throws error_x on the
+// thread that created it instead of outputting the error and exiting
+// the program. Worker threads use it so that their errors can be
+// reported by the main thread.
+class errors_as_exceptions_c {
+public:
+  errors_as_exceptions_c();
+  ~errors_as_exceptions_c();
+};
+
+class error_x: public mtx::exception {
+protected:
+  std::string m_message;
+
+public:
+  explicit error_x(std::string const &message)
+    : m_message{message}
+  {
+  }
+
+  virtual const char *what() const throw() {
+    return m_message.c_str();
+  }
+};
+
+}}
+
 void init_common_output(bool no_charset_detection);
 void set_cc_stdio(const std::string &charset);
 
@@ -0,0 +1,135 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   batching of reads at scattered file positions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/read_scheduler.h"
+
+read_scheduler_c::read_scheduler_c(mm_io_c &in,
+                                   std::size_t max_read_size,
+                                   std::size_t max_gap)
+  : m_in(in)
+  , m_max_read_size{max_read_size}
+  , m_max_gap{max_gap}
+{
+}
+
+void
+read_scheduler_c::add(std::size_t stream,
+                      std::size_t index,
+                      uint64_t position,
+                      std::size_t size) {
+  // A placeholder marks the block as queued until it has been read.
+  if (!m_blocks.emplace(std::make_pair(stream, index), memory_cptr{}).second)
+    return;
+
+  m_requests.push_back({ position, size, stream, index });
+}
+
+bool
+read_scheduler_c::execute() {
+  brng::sort(m_requests, [](request_t const &a, request_t const &b) { return a.m_position < b.m_position; });
+
+  auto ok    = true;
+  auto start = m_requests.begin();
+
+  while (start != m_requests.end()) {
+    auto group_start = start->m_position;
+    auto group_end   = start->m_position + start->m_size;
+    auto data_size   = uint64_t{start->m_size};
+    auto end         = start + 1;
+
+    // Blocks are added to the read as long as the gap to the previous
+    // one is small and the read doesn't get too big.
+    while (   (end != m_requests.end())
+           && (end->m_position <= (group_end + m_max_gap))
+           && ((std::max(group_end, end->m_position + end->m_size) - group_start) <= m_max_read_size)) {
+      group_end  = std::max(group_end, end->m_position + end->m_size);
+      data_size += end->m_size;
+      ++end;
+    }
+
+    auto group_size = static_cast<std::size_t>(group_end - group_start);
+    auto buffer     = memory_c::alloc(group_size);
+    auto num_read   = std::size_t{};
+
+    try {
+      m_in.setFilePointer(group_start);
+      num_read = m_in.read(buffer->get_buffer(), group_size);
+    } catch (mtx::mm_io::exception &) {
+    }
+
+    ++m_statistics.m_num_reads;
+    m_statistics.m_num_bytes_read += num_read;
+    m_statistics.m_num_gap_bytes  += group_size > data_size ? group_size - data_size : 0;
+
+    for (auto request = start; request != end; ++request) {
+      auto key    = std::make_pair(request->m_stream, request->m_index);
+      auto offset = static_cast<std::size_t>(request->m_position - group_start);
+
+      if ((offset + request->m_size) > num_read) {
+        m_blocks.erase(key);
+        ok = false;
+        continue;
+      }
+
+      m_blocks[key] = memory_c::view(*buffer, offset, request->m_size);
+      ++m_statistics.m_num_blocks;
+    }
+
+    start = end;
+  }
+
+  m_requests.clear();
+
+  return ok;
+}
+
+memory_cptr
+read_scheduler_c::take(std::size_t stream,
+                       std::size_t index) {
+  auto itr = m_blocks.find(std::make_pair(stream, index));
+  if ((itr == m_blocks.end()) || !itr->second)
+    return {};
+
+  auto block = itr->second;
+  m_blocks.erase(itr);
+
+  return block;
+}
+
+bool
+read_scheduler_c::is_scheduled(std::size_t stream,
+                               std::size_t index)
+  const {
+  return m_blocks.find(std::make_pair(stream, index)) != m_blocks.end();
+}
+
+std::size_t
+read_scheduler_c::get_num_blocks()
+  const {
+  return m_blocks.size();
+}
+
+read_scheduler_c::statistics_t const &
+read_scheduler_c::get_statistics()
+  const {
+  return m_statistics;
+}
+
+void
+read_scheduler_c::clear() {
+  m_requests.clear();
+  m_blocks.clear();
+}
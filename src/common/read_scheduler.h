@@ -0,0 +1,76 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   batching of reads at scattered file positions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_READ_SCHEDULER_H
+#define MTX_COMMON_READ_SCHEDULER_H
+
+#include "common/common_pch.h"
+
+#include <map>
+
+#include "common/mm_io.h"
+
+/* Collects reads of blocks at arbitrary file positions, e.g. the
+   samples of several tracks whose data isn't interleaved in the file,
+   and performs them in the order of their file positions. Blocks that
+   are adjacent or separated by small gaps are read with a single call,
+   and the blocks are handed out as views into the buffer read.
+
+   Each block is identified by the number of the stream it belongs to
+   and its index within that stream. Views keep the whole buffer they
+   refer to alive, so the amount of data read per batch should be
+   limited by the caller. */
+class read_scheduler_c {
+public:
+  struct statistics_t {
+    uint64_t m_num_blocks{}, m_num_reads{}, m_num_bytes_read{}, m_num_gap_bytes{};
+  };
+
+protected:
+  struct request_t {
+    uint64_t m_position;
+    std::size_t m_size, m_stream, m_index;
+  };
+
+  mm_io_c &m_in;
+  std::size_t m_max_read_size, m_max_gap;
+  std::vector<request_t> m_requests;
+  std::map<std::pair<std::size_t, std::size_t>, memory_cptr> m_blocks;
+  statistics_t m_statistics;
+
+public:
+  read_scheduler_c(mm_io_c &in, std::size_t max_read_size = 4 * 1024 * 1024, std::size_t max_gap = 64 * 1024);
+
+  // Queues the read of 'size' bytes at 'position'. Blocks that have
+  // already been read or queued are ignored.
+  void add(std::size_t stream, std::size_t index, uint64_t position, std::size_t size);
+
+  // Performs all queued reads. Returns false if a read came up short;
+  // the blocks that were read completely are available nevertheless.
+  bool execute();
+
+  // Returns the block and removes it from the scheduler, or nullptr if
+  // it hasn't been read.
+  memory_cptr take(std::size_t stream, std::size_t index);
+
+  // Returns whether or not the block has been queued or read.
+  bool is_scheduled(std::size_t stream, std::size_t index) const;
+
+  std::size_t get_num_blocks() const;
+  statistics_t const &get_statistics() const;
+
+  // Discards all queued reads and all blocks that haven't been taken.
+  void clear();
+};
+
+#endif  // MTX_COMMON_READ_SCHEDULER_H
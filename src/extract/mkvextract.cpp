@@ -38,13 +38,13 @@ enum operation_mode_e {
   MODE_TIMECODES_V2,
 };
 
-kax_analyzer_cptr
-open_and_analyze(std::string const &file_name,
-                 kax_analyzer_c::parse_mode_e parse_mode,
-                 bool exit_on_error) {
-  // open input file
+static kax_analyzer_cptr
+analyze(std::function<kax_analyzer_cptr()> const &create_analyzer,
+        std::string const &file_name,
+        kax_analyzer_c::parse_mode_e parse_mode,
+        bool exit_on_error) {
   try {
-    auto analyzer = std::make_shared<kax_analyzer_c>(file_name);
+    auto analyzer = create_analyzer();
     auto ok       = analyzer
       ->set_parse_mode(parse_mode)
       .set_open_mode(MODE_READ)
@@ -68,6 +68,23 @@ open_and_analyze(std::string const &file_name,
   }
 }
 
+kax_analyzer_cptr
+open_and_analyze(std::string const &file_name,
+                 kax_analyzer_c::parse_mode_e parse_mode,
+                 bool exit_on_error) {
+  // open input file
+  return analyze([&file_name]() { return std::make_shared<kax_analyzer_c>(file_name); }, file_name, parse_mode, exit_on_error);
+}
+
+kax_analyzer_cptr
+open_and_analyze(mm_io_c &in,
+                 kax_analyzer_c::parse_mode_e parse_mode,
+                 bool exit_on_error) {
+  // The analyzer doesn't take ownership of the file; it must be kept
+  // open as long as the analyzer is used.
+  return analyze([&in]() { return std::make_shared<kax_analyzer_c>(&in); }, in.get_file_name(), parse_mode, exit_on_error);
+}
+
 void
 show_element(EbmlElement *l,
              int level,
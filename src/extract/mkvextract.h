@@ -59,5 +59,6 @@ void extract_timecodes(const std::string &file_name, std::vector<track_spec_t> &
 void extract_cues(std::string const &file_name, std::vector<track_spec_t> const &tracks, kax_analyzer_c::parse_mode_e parse_mode);
 
 kax_analyzer_cptr open_and_analyze(std::string const &file_name, kax_analyzer_c::parse_mode_e parse_mode, bool exit_on_error = true);
+kax_analyzer_cptr open_and_analyze(mm_io_c &in, kax_analyzer_c::parse_mode_e parse_mode, bool exit_on_error = true);
 
 #endif // MTX_MKVEXTRACT_H
@@ -34,6 +34,7 @@
 #include "common/command_line.h"
 #include "common/ebml.h"
 #include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
 #include "common/mm_write_buffer_io.h"
 #include "common/strings/formatting.h"
 #include "extract/mkvextract.h"
@@ -187,9 +188,9 @@ extract_timecodes(const std::string &file_name,
     mxerror(Y("Nothing to do.\n"));
 
   // open input file
-  mm_io_c *in;
+  mm_io_cptr in;
   try {
-    in = new mm_file_io_c(file_name, MODE_READ);
+    in = mm_mmap_io_c::open(file_name);
   } catch (mtx::mm_io::exception &ex) {
     show_error(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % file_name % ex);
     return;
@@ -378,7 +379,7 @@ extract_timecodes(const std::string &file_name,
 
     delete l0;
     delete es;
-    delete in;
+    in.reset();
 
     close_timecode_files();
 
@@ -391,7 +392,7 @@ extract_timecodes(const std::string &file_name,
 
   } catch (...) {
     show_error(Y("Caught exception"));
-    delete in;
+    in.reset();
 
     close_timecode_files();
   }
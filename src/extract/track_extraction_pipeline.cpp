@@ -0,0 +1,212 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   decoding and writing extracted frames on threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "extract/track_extraction_pipeline.h"
+#include "extract/xtr_base.h"
+
+static debugging_option_c s_debug{"extraction_pipeline"};
+
+static std::size_t
+item_size(track_extraction_pipeline_c::item_t const &item) {
+  return item.m_frame       ? item.m_frame->get_size()
+       : item.m_codec_state ? item.m_codec_state->get_size()
+       :                      0;
+}
+
+track_extraction_pipeline_c::track_extraction_pipeline_c(std::vector<xtr_base_c *> const &extractors,
+                                                         bool threaded)
+  : m_threaded{threaded}
+{
+  if (!m_threaded)
+    return;
+
+  // Extractors writing to the same file as another one must be run on
+  // the same thread as their master.
+  auto queues_by_master = std::unordered_map<xtr_base_c *, queue_c *>{};
+
+  for (auto extractor : extractors) {
+    auto master = extractor;
+    while (master->m_master)
+      master = master->m_master;
+
+    auto &queue = queues_by_master[master];
+    if (!queue) {
+      m_outputs.emplace_back(std::make_unique<output_t>());
+      m_outputs.back()->m_queue = std::make_unique<queue_c>(ms_max_output_items, ms_max_output_bytes);
+      queue                     = m_outputs.back()->m_queue.get();
+    }
+
+    m_output_queues_by_extractor[extractor] = queue;
+  }
+
+  mxdebug_if(s_debug, boost::format("extraction_pipeline: %1% extractors, %2% output threads\n") % extractors.size() % m_outputs.size());
+
+  m_decoding_queue  = std::make_unique<queue_c>(ms_max_decoding_items, ms_max_decoding_bytes);
+  m_decoding_thread = std::thread{[this]() { run_decoder(); }};
+
+  for (auto &output : m_outputs) {
+    auto queue       = output->m_queue.get();
+    output->m_thread = std::thread{[this, queue]() { run_output(*queue); }};
+  }
+}
+
+track_extraction_pipeline_c::~track_extraction_pipeline_c() {
+  // Only reached without finish() if the main thread ran into an
+  // error. Don't bother handling the remaining items.
+  if (m_threaded && !m_finished) {
+    abort();
+    join();
+  }
+}
+
+void
+track_extraction_pipeline_c::add(item_t item) {
+  if (!m_threaded) {
+    decode(item);
+    handle(item);
+    return;
+  }
+
+  auto size = item_size(item);
+  if (!m_decoding_queue->push(std::move(item), size))
+    rethrow_exception();
+}
+
+void
+track_extraction_pipeline_c::finish() {
+  if (!m_threaded || m_finished)
+    return;
+
+  m_finished = true;
+
+  m_decoding_queue->close();
+  join();
+
+  if (s_debug) {
+    mxdebug(boost::format("extraction_pipeline: decoding queue: %1%\n") % m_decoding_queue->get_statistics());
+    for (auto idx = 0u; idx < m_outputs.size(); ++idx)
+      mxdebug(boost::format("extraction_pipeline: output queue %1%: %2%\n") % idx % m_outputs[idx]->m_queue->get_statistics());
+  }
+
+  rethrow_exception();
+}
+
+void
+track_extraction_pipeline_c::run_decoder() {
+  mtx::output::errors_as_exceptions_c errors_as_exceptions;
+
+  try {
+    item_t item;
+
+    while (m_decoding_queue->pop(item)) {
+      decode(item);
+
+      auto size = item_size(item);
+      if (!m_output_queues_by_extractor.at(item.m_extractor)->push(std::move(item), size))
+        return;
+    }
+
+    for (auto &output : m_outputs)
+      output->m_queue->close();
+
+  } catch (...) {
+    set_exception(std::current_exception());
+  }
+}
+
+void
+track_extraction_pipeline_c::run_output(queue_c &queue) {
+  mtx::output::errors_as_exceptions_c errors_as_exceptions;
+
+  try {
+    item_t item;
+
+    while (queue.pop(item)) {
+      handle(item);
+
+      // Release the cluster as early as possible.
+      item = item_t{};
+    }
+
+  } catch (...) {
+    set_exception(std::current_exception());
+  }
+}
+
+void
+track_extraction_pipeline_c::decode(item_t &item) {
+  if (item.m_frame)
+    item.m_extractor->decode_frame(item.m_frame);
+}
+
+void
+track_extraction_pipeline_c::handle(item_t &item) {
+  if (item.m_codec_state) {
+    item.m_extractor->handle_codec_state(item.m_codec_state);
+    return;
+  }
+
+  auto f = xtr_frame_t{item.m_frame, item.m_additions, item.m_timecode, item.m_duration, item.m_bref, item.m_fref, item.m_keyframe, item.m_discardable, item.m_references_valid, item.m_discard_duration};
+  item.m_extractor->handle_frame(f);
+}
+
+void
+track_extraction_pipeline_c::set_exception(std::exception_ptr const &exception) {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (!m_exception)
+      m_exception = exception;
+  }
+
+  abort();
+}
+
+void
+track_extraction_pipeline_c::rethrow_exception() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+  auto exception = m_exception;
+  lock.unlock();
+
+  if (!exception)
+    return;
+
+  // The other threads must have stopped before the error is reported
+  // as that may exit the program.
+  abort();
+  join();
+
+  try {
+    std::rethrow_exception(exception);
+
+  } catch (mtx::output::error_x &ex) {
+    mxerror(ex.what());
+  }
+}
+
+void
+track_extraction_pipeline_c::abort() {
+  m_decoding_queue->abort();
+  for (auto &output : m_outputs)
+    output->m_queue->abort();
+}
+
+void
+track_extraction_pipeline_c::join() {
+  if (m_decoding_thread.joinable())
+    m_decoding_thread.join();
+
+  for (auto &output : m_outputs)
+    if (output->m_thread.joinable())
+      output->m_thread.join();
+}
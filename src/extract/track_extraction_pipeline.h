@@ -0,0 +1,104 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for decoding and writing extracted frames on threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_EXTRACT_TRACK_EXTRACTION_PIPELINE_H
+#define MTX_EXTRACT_TRACK_EXTRACTION_PIPELINE_H
+
+#include "common/common_pch.h"
+
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include <matroska/KaxBlock.h>
+#include <matroska/KaxCluster.h>
+
+#include "common/bounded_queue.h"
+#include "common/timestamp.h"
+
+using namespace libmatroska;
+
+class xtr_base_c;
+
+/* The main thread reads the clusters and hands each frame and codec
+   state over to the pipeline. A decoding thread reverses the tracks'
+   content encodings (e.g. header removal or zlib compression). Each
+   output file is written by a thread of its own; extractors sharing a
+   file with a master extractor are written by the master's thread. All
+   items for a single output file are handled in the order in which
+   they were added.
+
+   The items keep the cluster they were taken from alive as the frame
+   data and block additions are owned by it.
+
+   Errors on the decoding and output threads, including those the
+   extractors report with mxerror(), stop the pipeline. They're passed
+   on to the main thread and reported there by the next call to add()
+   or finish().
+
+   If the pipeline isn't threaded, all items are decoded and handled
+   right away on the calling thread. */
+class track_extraction_pipeline_c {
+public:
+  struct item_t {
+    std::shared_ptr<KaxCluster> m_cluster;
+    xtr_base_c *m_extractor{};
+    memory_cptr m_frame, m_codec_state;
+    KaxBlockAdditions *m_additions{};
+    int64_t m_timecode{}, m_duration{}, m_bref{}, m_fref{};
+    bool m_keyframe{}, m_discardable{}, m_references_valid{};
+    timestamp_c m_discard_duration;
+  };
+
+protected:
+  using queue_c = bounded_queue_c<item_t>;
+
+  struct output_t {
+    std::unique_ptr<queue_c> m_queue;
+    std::thread m_thread;
+  };
+
+  static std::size_t const ms_max_decoding_items = 1024;
+  static std::size_t const ms_max_decoding_bytes = 64 * 1024 * 1024;
+  static std::size_t const ms_max_output_items   = 256;
+  static std::size_t const ms_max_output_bytes   = 32 * 1024 * 1024;
+
+  bool m_threaded;
+  std::unique_ptr<queue_c> m_decoding_queue;
+  std::thread m_decoding_thread;
+  std::vector<std::unique_ptr<output_t>> m_outputs;
+  std::unordered_map<xtr_base_c *, queue_c *> m_output_queues_by_extractor;
+
+  std::mutex m_mutex;
+  std::exception_ptr m_exception;
+  bool m_finished{};
+
+public:
+  track_extraction_pipeline_c(std::vector<xtr_base_c *> const &extractors, bool threaded);
+  ~track_extraction_pipeline_c();
+
+  void add(item_t item);
+  void finish();
+
+protected:
+  void run_decoder();
+  void run_output(queue_c &queue);
+  void decode(item_t &item);
+  void handle(item_t &item);
+
+  void set_exception(std::exception_ptr const &exception);
+  void rethrow_exception();
+  void abort();
+  void join();
+};
+
+#endif  // MTX_EXTRACT_TRACK_EXTRACTION_PIPELINE_H
@@ -34,10 +34,13 @@
 
 #include "common/command_line.h"
 #include "common/ebml.h"
+#include "common/hacks.h"
 #include "common/kax_file.h"
 #include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
 #include "common/mm_write_buffer_io.h"
 #include "extract/mkvextract.h"
+#include "extract/track_extraction_pipeline.h"
 #include "extract/xtr_base.h"
 
 using namespace libmatroska;
@@ -123,14 +126,15 @@ create_extractors(KaxTracks &kax_tracks,
 
 static int64_t
 handle_blockgroup(KaxBlockGroup &blockgroup,
-                  KaxCluster &cluster,
-                  int64_t tc_scale) {
+                  std::shared_ptr<KaxCluster> const &cluster,
+                  int64_t tc_scale,
+                  track_extraction_pipeline_c &pipeline) {
   // Only continue if this block group actually contains a block.
   KaxBlock *block = FindChild<KaxBlock>(&blockgroup);
   if (!block || (0 == block->NumberFrames()))
     return -1;
 
-  block->SetParent(cluster);
+  block->SetParent(*cluster);
 
   // Do we need this block group?
   xtr_base_c *extractor = nullptr;
@@ -168,8 +172,11 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
 
   KaxCodecState *kcstate = FindChild<KaxCodecState>(&blockgroup);
   if (kcstate) {
-    memory_cptr codec_state(new memory_c(kcstate->GetBuffer(), kcstate->GetSize(), false));
-    extractor->handle_codec_state(codec_state);
+    auto item          = track_extraction_pipeline_c::item_t{};
+    item.m_cluster     = cluster;
+    item.m_extractor   = extractor;
+    item.m_codec_state = std::make_shared<memory_c>(kcstate->GetBuffer(), kcstate->GetSize(), false);
+    pipeline.add(std::move(item));
   }
 
   for (i = 0; i < block->NumberFrames(); i++) {
@@ -189,10 +196,19 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
     if (kdiscard_padding)
       discard_padding = timestamp_c::ns(kdiscard_padding->GetValue());
 
-    auto &data = block->GetBuffer(i);
-    auto frame = std::make_shared<memory_c>(data.Buffer(), data.Size(), false);
-    auto f     = xtr_frame_t{frame, kadditions, this_timecode, this_duration, bref, fref, false, false, true, discard_padding};
-    extractor->decode_and_handle_frame(f);
+    auto &data              = block->GetBuffer(i);
+    auto item               = track_extraction_pipeline_c::item_t{};
+    item.m_cluster          = cluster;
+    item.m_extractor        = extractor;
+    item.m_frame            = std::make_shared<memory_c>(data.Buffer(), data.Size(), false);
+    item.m_additions        = kadditions;
+    item.m_timecode         = this_timecode;
+    item.m_duration         = this_duration;
+    item.m_bref             = bref;
+    item.m_fref             = fref;
+    item.m_references_valid = true;
+    item.m_discard_duration = discard_padding;
+    pipeline.add(std::move(item));
 
     max_timecode = std::max(max_timecode, this_timecode);
   }
@@ -202,11 +218,12 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
 
 static int64_t
 handle_simpleblock(KaxSimpleBlock &simpleblock,
-                   KaxCluster &cluster) {
+                   std::shared_ptr<KaxCluster> const &cluster,
+                   track_extraction_pipeline_c &pipeline) {
   if (0 == simpleblock.NumberFrames())
     return - 1;
 
-  simpleblock.SetParent(cluster);
+  simpleblock.SetParent(*cluster);
 
   // Do we need this block group?
   xtr_base_c *extractor = nullptr;
@@ -234,10 +251,19 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
       this_duration = duration / simpleblock.NumberFrames();
     }
 
-    auto &data = simpleblock.GetBuffer(i);
-    auto frame = std::make_shared<memory_c>(data.Buffer(), data.Size(), false);
-    auto f     = xtr_frame_t{frame, nullptr, this_timecode, this_duration, -1, -1, simpleblock.IsKeyframe(), simpleblock.IsDiscardable(), false, timestamp_c::ns(0)};
-    extractor->decode_and_handle_frame(f);
+    auto &data              = simpleblock.GetBuffer(i);
+    auto item               = track_extraction_pipeline_c::item_t{};
+    item.m_cluster          = cluster;
+    item.m_extractor        = extractor;
+    item.m_frame            = std::make_shared<memory_c>(data.Buffer(), data.Size(), false);
+    item.m_timecode         = this_timecode;
+    item.m_duration         = this_duration;
+    item.m_bref             = -1;
+    item.m_fref             = -1;
+    item.m_keyframe         = simpleblock.IsKeyframe();
+    item.m_discardable      = simpleblock.IsDiscardable();
+    item.m_discard_duration = timestamp_c::ns(0);
+    pipeline.add(std::move(item));
 
     max_timecode = std::max(max_timecode, this_timecode);
   }
@@ -353,7 +379,7 @@ extract_tracks(const std::string &file_name,
   mm_io_cptr in;
   kax_file_cptr file;
   try {
-    in   = mm_file_io_c::open(file_name);
+    in   = mm_mmap_io_c::open(file_name);
     file = std::make_shared<kax_file_c>(*in);
   } catch (mtx::mm_io::exception &ex) {
     show_error(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % file_name % ex);
@@ -364,8 +390,8 @@ extract_tracks(const std::string &file_name,
   uint64_t tc_scale = TIMECODE_SCALE;
   bool segment_info_found = false, tracks_found = false;
 
-  // open input file
-  auto analyzer = open_and_analyze(file_name, parse_mode, false);
+  // Re-use the already opened file for analyzing it.
+  auto analyzer = open_and_analyze(*in, parse_mode, false);
   if (analyzer) {
     auto af_master    = ebml_master_cptr{ analyzer->read_all(EBML_INFO(KaxInfo)) };
     auto segment_info = dynamic_cast<KaxInfo *>(af_master.get());
@@ -423,6 +449,10 @@ extract_tracks(const std::string &file_name,
     KaxChapters all_chapters;
     KaxTags all_tags;
 
+    // Created once the first cluster is found as the extractors might
+    // only be created from the track headers found in the segment.
+    std::unique_ptr<track_extraction_pipeline_c> pipeline;
+
     while ((l1 = file->read_next_level1_element())) {
       if (Is<KaxInfo>(l1) && !segment_info_found) {
         segment_info_found = true;
@@ -430,12 +460,26 @@ extract_tracks(const std::string &file_name,
 
       } else if (Is<KaxTracks>(l1) && !tracks_found) {
         tracks_found = true;
+
+        // Extractors created after the first cluster must be known to
+        // the pipeline, too.
+        if (pipeline)
+          pipeline->finish();
+        pipeline.reset();
+
         find_and_verify_track_uids(*dynamic_cast<KaxTracks *>(l1), tspecs);
         create_extractors(*dynamic_cast<KaxTracks *>(l1), tspecs);
 
       } else if (Is<KaxCluster>(l1)) {
         show_element(l1, 1, Y("Cluster"));
-        KaxCluster *cluster = static_cast<KaxCluster *>(l1);
+
+        // The cluster owns the frame data and must be kept alive until
+        // all of its frames have been handled by the pipeline.
+        auto cluster = std::shared_ptr<KaxCluster>{static_cast<KaxCluster *>(l1)};
+        l1           = nullptr;
+
+        if (!pipeline)
+          pipeline = std::make_unique<track_extraction_pipeline_c>(extractors, !hack_engaged(ENGAGE_NO_EXTRACTION_THREADS));
 
         if (0 == verbose) {
           auto current_percentage = in->getFilePointer() * 100 / file_size;
@@ -446,7 +490,7 @@ extract_tracks(const std::string &file_name,
             mxinfo(boost::format(Y("Progress: %1%%%%2%")) % current_percentage % "\r");
         }
 
-        KaxClusterTimecode *ctc = FindChild<KaxClusterTimecode>(l1);
+        KaxClusterTimecode *ctc = FindChild<KaxClusterTimecode>(*cluster);
         if (ctc) {
           uint64_t cluster_tc = ctc->GetValue();
           show_element(ctc, 2, boost::format(Y("Cluster timecode: %|1$.3f|s")) % ((float)cluster_tc * (float)tc_scale / 1000000000.0));
@@ -463,11 +507,11 @@ extract_tracks(const std::string &file_name,
 
           if (Is<KaxBlockGroup>(el)) {
             show_element(el, 2, Y("Block group"));
-            max_bg_timecode = handle_blockgroup(*static_cast<KaxBlockGroup *>(el), *cluster, tc_scale);
+            max_bg_timecode = handle_blockgroup(*static_cast<KaxBlockGroup *>(el), cluster, tc_scale, *pipeline);
 
           } else if (Is<KaxSimpleBlock>(el)) {
             show_element(el, 2, Y("SimpleBlock"));
-            max_bg_timecode = handle_simpleblock(*static_cast<KaxSimpleBlock *>(el), *cluster);
+            max_bg_timecode = handle_simpleblock(*static_cast<KaxSimpleBlock *>(el), cluster, *pipeline);
           }
 
           max_timecode = std::max(max_timecode, max_bg_timecode);
@@ -508,6 +552,9 @@ extract_tracks(const std::string &file_name,
     delete l0;
     delete es;
 
+    if (pipeline)
+      pipeline->finish();
+
     write_all_cuesheets(all_chapters, all_tags, tspecs);
 
     // Now just close the files and go to sleep. Mummy will sing you a
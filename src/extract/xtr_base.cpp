@@ -83,9 +83,14 @@ xtr_base_c::create_file(xtr_base_c *master,
   m_default_duration = kt_get_default_duration(track);
 }
 
+void
+xtr_base_c::decode_frame(memory_cptr &frame) {
+  m_content_decoder.reverse(frame, CONTENT_ENCODING_SCOPE_BLOCK);
+}
+
 void
 xtr_base_c::decode_and_handle_frame(xtr_frame_t &f) {
-  m_content_decoder.reverse(f.frame, CONTENT_ENCODING_SCOPE_BLOCK);
+  decode_frame(f.frame);
   handle_frame(f);
 }
 
@@ -121,9 +121,14 @@ hevc_es_reader_c::read(generic_packetizer_c *,
   if (m_in->getFilePointer() >= m_size)
     return FILE_STATUS_DONE;
 
-  int num_read = m_in->read(m_buffer->get_buffer(), READ_SIZE);
-  if (0 < num_read)
-    PTZR0->process(new packet_t(new memory_c(m_buffer->get_buffer(), num_read)));
+  // Use a new buffer for each chunk so that the parser can reference
+  // the NALUs instead of having to copy them.
+  auto buffer  = memory_c::alloc(READ_SIZE);
+  int num_read = m_in->read(buffer->get_buffer(), READ_SIZE);
+  if (0 < num_read) {
+    buffer->set_size(num_read);
+    PTZR0->process(new packet_t(buffer));
+  }
 
   return (0 != num_read) && (m_in->getFilePointer() < m_size) ? FILE_STATUS_MOREDATA : flush_packetizers();
 }
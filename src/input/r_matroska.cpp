@@ -313,6 +313,12 @@ kax_reader_c::kax_reader_c(const track_info_c &ti,
 {
   init_l1_position_storage(m_deferred_l1_positions);
   init_l1_position_storage(m_handled_l1_positions);
+
+  // Frames of tracks that aren't output aren't needed.
+  m_cluster_parser.set_track_wanted_callback([this](uint64_t track_num) -> bool {
+    auto track = find_track_by_num(track_num);
+    return track && (-1 != track->ptzr);
+  });
 }
 
 kax_reader_c::~kax_reader_c() {
@@ -1013,6 +1019,7 @@ kax_reader_c::read_headers_info(mm_io_c *io,
   m_muxing_date_epoch = GetChild<KaxDateUTC>(info).GetEpochDate();
 
   m_in_file->set_timecode_scale(m_tc_scale);
+  m_cluster_parser.set_timecode_scale(m_tc_scale);
 
   // Let's try to parse the "writing application" string. This usually
   // contains the name and version number of the application used for
@@ -2179,38 +2186,34 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
   }
 
   try {
-    KaxCluster *cluster = m_in_file->read_next_cluster();
-    if (!cluster) {
-      flush_packetizers();
+    // Clusters are usually parsed in place without creating libebml
+    // elements. Damaged clusters or those with an unknown size are
+    // handled by libebml and kax_file_c's resyncing.
+    auto cluster_pos          = m_in->getFilePointer();
+    auto cluster_content_size = uint64_t{};
 
-      m_file_status = FILE_STATUS_DONE;
-      return FILE_STATUS_DONE;
-    }
+    if (m_in_file->read_next_cluster_content(m_cluster_content, cluster_content_size)) {
+      if (m_cluster_parser.parse(m_cluster_content->get_buffer(), cluster_content_size)) {
+        process_cluster_timecode(m_cluster_parser.get_cluster_timecode());
 
-    auto cluster_tc = FindChildValue<KaxClusterTimecode>(cluster);
-    cluster->InitTimecode(cluster_tc, m_tc_scale);
+        while (auto block = m_cluster_parser.next_block())
+          process_block(*block);
 
-    if (-1 == m_first_timecode) {
-      m_first_timecode = cluster_tc * m_tc_scale;
+        return FILE_STATUS_MOREDATA;
+      }
 
-      // If we're appending this file to another one then the core
-      // needs the timecodes shifted to zero.
-      if (m_appending && m_chapters && (0 < m_first_timecode))
-        adjust_chapter_timecodes(*m_chapters, -m_first_timecode);
+      m_in->setFilePointer(cluster_pos);
     }
 
-    size_t bgidx;
-    for (bgidx = 0; bgidx < cluster->ListSize(); bgidx++) {
-      EbmlElement *element = (*cluster)[bgidx];
-
-      if (Is<KaxSimpleBlock>(element))
-        process_simple_block(cluster, static_cast<KaxSimpleBlock *>(element));
+    auto cluster = std::unique_ptr<KaxCluster>{m_in_file->read_next_cluster()};
+    if (!cluster) {
+      flush_packetizers();
 
-      else if (Is<KaxBlockGroup>(element))
-        process_block_group(cluster, static_cast<KaxBlockGroup *>(element));
+      m_file_status = FILE_STATUS_DONE;
+      return FILE_STATUS_DONE;
     }
 
-    delete cluster;
+    process_cluster(*cluster);
 
   } catch (...) {
     mxwarn(boost::format("%1% %2% %3%\n")
@@ -2224,20 +2227,124 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
 }
 
 void
-kax_reader_c::process_simple_block(KaxCluster *cluster,
-                                   KaxSimpleBlock *block_simple) {
+kax_reader_c::process_cluster_timecode(uint64_t cluster_tc) {
+  if (-1 != m_first_timecode)
+    return;
+
+  m_first_timecode = cluster_tc * m_tc_scale;
+
+  // If we're appending this file to another one then the core
+  // needs the timecodes shifted to zero.
+  if (m_appending && m_chapters && (0 < m_first_timecode))
+    adjust_chapter_timecodes(*m_chapters, -m_first_timecode);
+}
+
+void
+kax_reader_c::process_cluster(KaxCluster &cluster) {
+  auto cluster_tc = FindChildValue<KaxClusterTimecode>(cluster);
+  cluster.InitTimecode(cluster_tc, m_tc_scale);
+
+  process_cluster_timecode(cluster_tc);
+
+  // Convert the libebml elements into the same structure the flat
+  // cluster parser produces.
+  auto block       = kax_cluster_parser_c::block_t{};
+  auto fill_frames = [&block](KaxInternalBlock &internal_block) {
+    block.m_track_num  = internal_block.TrackNum();
+    block.m_timecode   = mtx::math::to_signed(internal_block.GlobalTimecode());
+    block.m_num_frames = internal_block.NumberFrames();
+
+    block.m_frames.clear();
+    for (auto idx = 0u; idx < block.m_num_frames; ++idx) {
+      auto &data_buffer = internal_block.GetBuffer(idx);
+      block.m_frames.push_back({ data_buffer.Buffer(), static_cast<std::size_t>(data_buffer.Size()) });
+    }
+  };
+
+  for (auto element : cluster) {
+    if (Is<KaxSimpleBlock>(element)) {
+      auto &simple_block = *static_cast<KaxSimpleBlock *>(element);
+      simple_block.SetParent(cluster);
+
+      fill_frames(simple_block);
+      block.m_simple      = true;
+      block.m_key_frame   = simple_block.IsKeyframe();
+      block.m_discardable = simple_block.IsDiscardable();
+
+      process_block(block);
+      continue;
+    }
+
+    if (!Is<KaxBlockGroup>(element))
+      continue;
+
+    auto &block_group   = *static_cast<KaxBlockGroup *>(element);
+    auto internal_block = FindChild<KaxBlock>(block_group);
+    if (!internal_block)
+      continue;
+
+    internal_block->SetParent(cluster);
+
+    fill_frames(*internal_block);
+    block.m_simple      = false;
+    block.m_key_frame   = false;
+    block.m_discardable = false;
+
+    auto duration        = FindChild<KaxBlockDuration>(block_group);
+    auto codec_state     = FindChild<KaxCodecState>(block_group);
+    auto discard_padding = FindChild<KaxDiscardPadding>(block_group);
+    auto block_additions = FindChild<KaxBlockAdditions>(block_group);
+
+    block.m_duration.reset();
+    block.m_codec_state.reset();
+    block.m_discard_padding.reset();
+
+    if (duration)
+      block.m_duration = duration->GetValue();
+    if (codec_state)
+      block.m_codec_state = kax_cluster_parser_c::frame_t{ codec_state->GetBuffer(), static_cast<std::size_t>(codec_state->GetSize()) };
+    if (discard_padding)
+      block.m_discard_padding = discard_padding->GetValue();
+
+    block.m_references.clear();
+    for (auto ref_block = FindChild<KaxReferenceBlock>(block_group); ref_block; ref_block = FindNextChild<KaxReferenceBlock>(&block_group, ref_block))
+      block.m_references.push_back(ref_block->GetValue());
+
+    block.m_block_additions.clear();
+    if (block_additions)
+      for (auto &child : *block_additions) {
+        if (!Is<KaxBlockMore>(child))
+          continue;
+
+        auto &block_additional = GetChild<KaxBlockAdditional>(*static_cast<KaxBlockMore *>(child));
+        block.m_block_additions.push_back({ block_additional.GetBuffer(), static_cast<std::size_t>(block_additional.GetSize()) });
+      }
+
+    process_block(block);
+  }
+}
+
+void
+kax_reader_c::process_block(kax_cluster_parser_c::block_t const &block) {
+  if (block.m_simple)
+    process_simple_block(block);
+  else
+    process_block_group(block);
+}
+
+void
+kax_reader_c::process_simple_block(kax_cluster_parser_c::block_t const &block) {
   int64_t block_duration = -1;
   int64_t block_bref     = VFT_IFRAME;
   int64_t block_fref     = VFT_NOBFRAME;
 
-  block_simple->SetParent(*cluster);
-  auto block_track     = find_track_by_num(block_simple->TrackNum());
-  auto block_timestamp = mtx::math::to_signed(block_simple->GlobalTimecode()) + m_global_timestamp_offset;
+  auto block_track     = find_track_by_num(block.m_track_num);
+  auto block_timestamp = block.m_timecode + m_global_timestamp_offset;
 
   if (!block_track) {
     mxwarn_fn(m_ti.m_fname,
               boost::format(Y("A block was found at timestamp %1% for track number %2%. However, no headers where found for that track number. "
-                              "The block will be skipped.\n")) % format_timestamp(block_timestamp) % block_simple->TrackNum());
+                              "The block will be skipped.\n")) % format_timestamp(block_timestamp) % block.m_track_num);
     return;
   }
 
@@ -2254,16 +2361,16 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
       block_duration = 0;
   }
 
-  if (!block_simple->IsKeyframe()) {
-    if (block_simple->IsDiscardable())
+  if (!block.m_key_frame) {
+    if (block.m_discardable)
       block_fref = block_track->previous_timecode;
     else
       block_bref = block_track->previous_timecode;
   }
 
   m_last_timecode = block_timestamp;
-  if (0 < block_simple->NumberFrames())
-    m_in_file->set_last_timecode(m_last_timecode + (block_simple->NumberFrames() - 1) * frame_duration);
+  if (0 < block.m_num_frames)
+    m_in_file->set_last_timecode(m_last_timecode + (block.m_num_frames - 1) * frame_duration);
 
   // If we're appending this file to another one then the core
   // needs the timecodes shifted to zero.
@@ -2275,9 +2382,8 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
     // any special cases, e.g. 0 terminating a string for the subs
     // and stuff. Just pass everything through as it is.
     size_t i;
-    for (i = 0; block_simple->NumberFrames() > i; ++i) {
-      DataBuffer &data_buffer = block_simple->GetBuffer(i);
-      memory_cptr data(new memory_c(data_buffer.Buffer(), data_buffer.Size(), false));
+    for (i = 0; block.m_frames.size() > i; ++i) {
+      memory_cptr data(new memory_c(block.m_frames[i].m_data, block.m_frames[i].m_size, false));
       block_track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
       packet_cptr packet(new packet_t(data, m_last_timecode + i * frame_duration, block_duration, block_bref, block_fref));
 
@@ -2286,9 +2392,8 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
 
   } else if (-1 != block_track->ptzr) {
     size_t i;
-    for (i = 0; i < block_simple->NumberFrames(); i++) {
-      DataBuffer &data_buffer = block_simple->GetBuffer(i);
-      memory_cptr data(new memory_c(data_buffer.Buffer(), data_buffer.Size(), false));
+    for (i = 0; i < block.m_frames.size(); i++) {
+      memory_cptr data(new memory_c(block.m_frames[i].m_data, block.m_frames[i].m_size, false));
       block_track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
 
       if (('s' == block_track->type) && ('t' == block_track->sub_type)) {
@@ -2304,33 +2409,21 @@ kax_reader_c::process_simple_block(KaxCluster *cluster,
   }
 
   block_track->previous_timecode  = m_last_timecode;
-  block_track->units_processed   += block_simple->NumberFrames();
+  block_track->units_processed   += block.m_num_frames;
 }
 
 void
-kax_reader_c::process_block_group_common(KaxBlockGroup *block_group,
+kax_reader_c::process_block_group_common(kax_cluster_parser_c::block_t const &block,
                                          packet_t *packet,
                                          kax_track_t &block_track) {
-  auto codec_state     = FindChild<KaxCodecState>(block_group);
-  auto discard_padding = FindChild<KaxDiscardPadding>(block_group);
-  auto blockadd        = FindChild<KaxBlockAdditions>(block_group);
-
-  if (codec_state)
-    packet->codec_state = memory_c::clone(codec_state->GetBuffer(), codec_state->GetSize());
+  if (block.m_codec_state)
+    packet->codec_state = memory_c::clone(block.m_codec_state->m_data, block.m_codec_state->m_size);
 
-  if (discard_padding)
-    packet->discard_padding = timestamp_c::ns(discard_padding->GetValue());
+  if (block.m_discard_padding)
+    packet->discard_padding = timestamp_c::ns(*block.m_discard_padding);
 
-  if (!blockadd)
-    return;
-
-  for (auto &child : *blockadd) {
-    if (!(Is<KaxBlockMore>(child)))
-      continue;
-
-    auto blockmore     = static_cast<KaxBlockMore *>(child);
-    auto blockadd_data = &GetChild<KaxBlockAdditional>(*blockmore);
-    auto blockadded    = std::make_shared<memory_c>(blockadd_data->GetBuffer(), blockadd_data->GetSize(), false);
+  for (auto const &addition : block.m_block_additions) {
+    auto blockadded = std::make_shared<memory_c>(addition.m_data, addition.m_size, false);
     block_track.content_decoder.reverse(blockadded, CONTENT_ENCODING_SCOPE_BLOCK);
 
     packet->data_adds.push_back(blockadded);
@@ -2338,32 +2431,26 @@ kax_reader_c::process_block_group_common(KaxBlockGroup *block_group,
 }
 
 void
-kax_reader_c::process_block_group(KaxCluster *cluster,
-                                  KaxBlockGroup *block_group) {
-  auto block = FindChild<KaxBlock>(block_group);
-  if (!block)
-    return;
-
-  block->SetParent(*cluster);
-  auto block_track     = find_track_by_num(block->TrackNum());
-  auto block_timestamp = mtx::math::to_signed(block->GlobalTimecode()) + m_global_timestamp_offset;
+kax_reader_c::process_block_group(kax_cluster_parser_c::block_t const &block) {
+  auto block_track     = find_track_by_num(block.m_track_num);
+  auto block_timestamp = block.m_timecode + m_global_timestamp_offset;
 
   if (!block_track) {
     mxwarn_fn(m_ti.m_fname,
               boost::format(Y("A block was found at timestamp %1% for track number %2%. However, no headers where found for that track number. "
-                              "The block will be skipped.\n")) % format_timestamp(block_timestamp) % block->TrackNum());
+                              "The block will be skipped.\n")) % format_timestamp(block_timestamp) % block.m_track_num);
     return;
   }
 
-  auto duration       = FindChild<KaxBlockDuration>(block_group);
-  auto block_duration = duration             ? static_cast<int64_t>(duration->GetValue() * m_tc_scale / block->NumberFrames())
+  auto &duration      = block.m_duration;
+  auto block_duration = duration             ? static_cast<int64_t>(*duration * m_tc_scale / block.m_num_frames)
                       : block_track->v_frate ? static_cast<int64_t>(1000000000.0 / block_track->v_frate)
                       :                        int64_t{-1};
   auto frame_duration = -1 == block_duration ? int64_t{0} : block_duration;
   m_last_timecode     = block_timestamp;
 
-  if (0 < block->NumberFrames())
-    m_in_file->set_last_timecode(m_last_timecode + (block->NumberFrames() - 1) * frame_duration);
+  if (0 < block.m_num_frames)
+    m_in_file->set_last_timecode(m_last_timecode + (block.m_num_frames - 1) * frame_duration);
 
   // If we're appending this file to another one then the core
   // needs the timecodes shifted to zero.
@@ -2377,18 +2464,15 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
   auto block_fref = int64_t{VFT_NOBFRAME};
   bool bref_found = false;
   bool fref_found = false;
-  auto ref_block  = FindChild<KaxReferenceBlock>(block_group);
 
-  while (ref_block) {
-    if (0 >= ref_block->GetValue()) {
-      block_bref = ref_block->GetValue() * m_tc_scale;
+  for (auto reference : block.m_references) {
+    if (0 >= reference) {
+      block_bref = reference * m_tc_scale;
       bref_found = true;
     } else {
-      block_fref = ref_block->GetValue() * m_tc_scale;
+      block_fref = reference * m_tc_scale;
       fref_found = true;
     }
-
-    ref_block = FindNextChild<KaxReferenceBlock>(block_group, ref_block);
   }
 
   if (('s' == block_track->type) && (-1 == block_duration))
@@ -2410,15 +2494,14 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
       block_fref += m_last_timecode;
 
     size_t i;
-    for (i = 0; i < block->NumberFrames(); i++) {
-      auto &data_buffer = block->GetBuffer(i);
-      auto data         = std::make_shared<memory_c>(data_buffer.Buffer(), data_buffer.Size(), false);
+    for (i = 0; i < block.m_frames.size(); i++) {
+      auto data = std::make_shared<memory_c>(block.m_frames[i].m_data, block.m_frames[i].m_size, false);
       block_track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
 
       auto packet                = std::make_shared<packet_t>(data, m_last_timecode + i * frame_duration, block_duration, block_bref, block_fref);
-      packet->duration_mandatory = duration;
+      packet->duration_mandatory = !!duration;
 
-      process_block_group_common(block_group, packet.get(), *block_track);
+      process_block_group_common(block, packet.get(), *block_track);
 
       static_cast<passthrough_packetizer_c *>(PTZR(block_track->ptzr))->process(packet);
     }
@@ -2431,16 +2514,15 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
   if (fref_found)
     block_fref += m_last_timecode;
 
-  for (auto block_idx = 0u, num_frames = block->NumberFrames(); block_idx < num_frames; ++block_idx) {
-    auto &data_buffer = block->GetBuffer(block_idx);
-    auto data         = std::make_shared<memory_c>(data_buffer.Buffer(), data_buffer.Size(), false);
+  for (auto block_idx = 0u, num_frames = static_cast<unsigned int>(block.m_frames.size()); block_idx < num_frames; ++block_idx) {
+    auto data = std::make_shared<memory_c>(block.m_frames[block_idx].m_data, block.m_frames[block_idx].m_size, false);
     block_track->content_decoder.reverse(data, CONTENT_ENCODING_SCOPE_BLOCK);
 
     if (('s' == block_track->type) && ('t' == block_track->sub_type)) {
       if ((2 < data->get_size()) || ((0 < data->get_size()) && (' ' != *data->get_buffer()) && (0 != *data->get_buffer()) && !iscr(*data->get_buffer()))) {
         auto packet = std::make_shared<packet_t>(data, m_last_timecode, block_duration, block_bref, block_fref);
 
-        process_block_group_common(block_group, packet.get(), *block_track);
+        process_block_group_common(block, packet.get(), *block_track);
 
         PTZR(block_track->ptzr)->process(packet);
       }
@@ -2448,17 +2530,17 @@ kax_reader_c::process_block_group(KaxCluster *cluster,
     } else {
       auto packet = std::make_shared<packet_t>(data, m_last_timecode + block_idx * frame_duration, block_duration, block_bref, block_fref);
 
-      if ((duration) && !duration->GetValue())
+      if (duration && !*duration)
         packet->duration_mandatory = true;
 
-      process_block_group_common(block_group, packet.get(), *block_track);
+      process_block_group_common(block, packet.get(), *block_track);
 
       PTZR(block_track->ptzr)->process(packet);
     }
   }
 
   block_track->previous_timecode  = m_last_timecode;
-  block_track->units_processed   += block->NumberFrames();
+  block_track->units_processed   += block.m_num_frames;
 }
 
 int
@@ -23,6 +23,7 @@
 #include "common/content_decoder.h"
 #include "common/dts.h"
 #include "common/error.h"
+#include "common/kax_cluster_parser.h"
 #include "common/kax_file.h"
 #include "common/mm_io.h"
 #include "common/mpeg4_p10.h"
@@ -212,6 +213,8 @@ private:
   int64_t m_tc_scale;
 
   kax_file_cptr m_in_file;
+  kax_cluster_parser_c m_cluster_parser;
+  memory_cptr m_cluster_content;
 
   std::shared_ptr<EbmlStream> m_es;
 
@@ -327,9 +330,12 @@ protected:
   virtual void read_deferred_level1_elements(KaxSegment &segment);
   virtual void find_level1_elements_via_analyzer();
 
-  virtual void process_simple_block(KaxCluster *cluster, KaxSimpleBlock *block_simple);
-  virtual void process_block_group(KaxCluster *cluster, KaxBlockGroup *block_group);
-  virtual void process_block_group_common(KaxBlockGroup *block_group, packet_t *packet, kax_track_t &track);
+  virtual void process_cluster_timecode(uint64_t cluster_tc);
+  virtual void process_cluster(KaxCluster &cluster);
+  virtual void process_block(kax_cluster_parser_c::block_t const &block);
+  virtual void process_simple_block(kax_cluster_parser_c::block_t const &block);
+  virtual void process_block_group(kax_cluster_parser_c::block_t const &block);
+  virtual void process_block_group_common(kax_cluster_parser_c::block_t const &block, packet_t *packet, kax_track_t &track);
 
   void init_l1_position_storage(deferred_positions_t &storage);
   virtual bool has_deferred_element_been_processed(deferred_l1_type_e type, int64_t position);
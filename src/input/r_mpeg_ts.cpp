@@ -27,6 +27,7 @@
 #include "common/math.h"
 #include "common/mp3.h"
 #include "common/mm_mpls_multi_file_io.h"
+#include "common/mpeg.h"
 #include "common/ac3.h"
 #include "common/id_info.h"
 #include "common/iso639.h"
@@ -59,6 +60,7 @@
 
 #define TS_PACKET_SIZE     188
 #define TS_MAX_PACKET_SIZE 204
+#define TS_PACKETS_PER_CHUNK 2048
 
 #define TS_PAT_PID         0x0000
 #define TS_SDT_PID         0x0011
@@ -948,6 +950,12 @@ file_t::file_t(mm_io_cptr const &in)
   , m_validate_pat_crc{true}
   , m_validate_pmt_crc{true}
   , m_has_audio_or_video_track{}
+  , m_pid_filter_active{}
+  , m_chunk_position{}
+  , m_packet_position{}
+  , m_chunk_num_packets{}
+  , m_chunk_num_synced{}
+  , m_chunk_next_packet{}
 {
 }
 
@@ -975,6 +983,20 @@ file_t::all_pmts_found()
   return (0 != m_num_pmts_to_find) && (m_num_pmts_found >= m_num_pmts_to_find);
 }
 
+void
+file_t::rewind() {
+  m_in->setFilePointer(0);
+  m_in->clear_eof();
+  discard_chunk();
+}
+
+void
+file_t::discard_chunk() {
+  m_chunk_num_packets = 0;
+  m_chunk_num_synced  = 0;
+  m_chunk_next_packet = 0;
+}
+
 // ------------------------------------------------------------
 
 bool
@@ -1089,31 +1111,26 @@ reader_c::read_headers_for_file(std::size_t file_num) {
     auto min_size_to_probe   = std::min<uint64_t>(size_to_probe, 5 * 1024 * 1024);
     f.m_detected_packet_size = detect_packet_size(f.m_in.get(), size_to_probe);
 
-    f.m_in->setFilePointer(0);
+    f.rewind();
 
     mxdebug_if(m_debug_headers, boost::format("read_headers: Starting to build PID list. (packet size: %1%)\n") % f.m_detected_packet_size);
 
-    unsigned char buf[TS_MAX_PACKET_SIZE]; // maximum TS packet size + 1
-
     while (true) {
-      if (f.m_in->read(buf, f.m_detected_packet_size) != static_cast<unsigned int>(f.m_detected_packet_size))
+      auto packet = next_packet();
+      if (!packet)
         break;
 
-      if (buf[0] != 0x47) {
-        if (resync(f.m_in->getFilePointer() - f.m_detected_packet_size))
-          continue;
-        break;
-      }
+      parse_packet(packet);
 
-      parse_packet(buf);
+      auto position = f.m_packet_position + f.m_detected_packet_size;
 
       if (   f.m_pat_found
           && f.all_pmts_found()
           && (0 == f.m_es_to_process)
-          && (f.m_in->getFilePointer() >= min_size_to_probe))
+          && (position >= min_size_to_probe))
         break;
 
-      auto eof = f.m_in->eof() || (f.m_in->getFilePointer() >= size_to_probe);
+      auto eof = position >= size_to_probe;
       if (!eof)
         continue;
 
@@ -1135,8 +1152,7 @@ reader_c::read_headers_for_file(std::size_t file_num) {
       } else
         break;
 
-      f.m_in->setFilePointer(0);
-      f.m_in->clear_eof();
+      f.rewind();
 
       setup_initial_tracks();
     }
@@ -1144,9 +1160,9 @@ reader_c::read_headers_for_file(std::size_t file_num) {
     mxdebug_if(m_debug_headers, boost::format("read_headers: caught exception\n"));
   }
 
-  mxdebug_if(m_debug_headers, boost::format("read_headers: Detection done on %1% bytes\n") % f.m_in->getFilePointer());
+  mxdebug_if(m_debug_headers, boost::format("read_headers: Detection done on %1% bytes\n") % (f.m_packet_position + f.m_detected_packet_size));
 
-  f.m_in->setFilePointer(0, seek_beginning); // rewind file for later remux
+  f.rewind();                   // rewind file for later remux
 
   // Run probe_packet_complete() for track-type detection once for
   // each track. This way tracks that don't actually need their
@@ -1219,25 +1235,17 @@ reader_c::determine_global_timestamp_offset() {
 
   auto &f = file();
 
-  f.m_in->setFilePointer(0);
-  f.m_in->clear_eof();
+  f.rewind();
 
   mxdebug_if(m_debug_headers, boost::format("determine_global_timestamp_offset: determining global timestamp offset from the first %1% bytes\n") % f.m_probe_range);
 
   try {
-    unsigned char buf[TS_MAX_PACKET_SIZE]; // maximum TS packet size + 1
-
-    while (f.m_in->getFilePointer() < f.m_probe_range) {
-      if (f.m_in->read(buf, f.m_detected_packet_size) != static_cast<unsigned int>(f.m_detected_packet_size))
-        break;
-
-      if (buf[0] != 0x47) {
-        if (resync(f.m_in->getFilePointer() - f.m_detected_packet_size))
-          continue;
+    while (true) {
+      auto packet = next_packet();
+      if (!packet || (f.m_packet_position >= f.m_probe_range))
         break;
-      }
 
-      parse_packet(buf);
+      parse_packet(packet);
     }
   } catch (...) {
     mxdebug_if(m_debug_headers, boost::format("determine_global_timestamp_offset: caught exception\n"));
@@ -1245,8 +1253,7 @@ reader_c::determine_global_timestamp_offset() {
 
   mxdebug_if(m_debug_headers, boost::format("determine_global_timestamp_offset: detection done; global timestamp offset is %1%\n") % f.m_global_timestamp_offset);
 
-  f.m_in->setFilePointer(0);
-  f.m_in->clear_eof();
+  f.rewind();
 
   reset_processing_state(processing_state_e::muxing);
 }
@@ -1853,7 +1860,7 @@ reader_c::parse_pes(track_c &track) {
   }
 
   if (m_debug_packet) {
-    mxdebug(boost::format("parse_pes: PES info at file position %1% (file num %2%):\n") % (f.m_in->getFilePointer() - f.m_detected_packet_size) % track.m_file_num);
+    mxdebug(boost::format("parse_pes: PES info at file position %1% (file num %2%):\n") % f.m_packet_position % track.m_file_num);
     mxdebug(boost::format("parse_pes:    stream_id = %1% PID = %2%\n") % static_cast<unsigned int>(pes_header->stream_id) % track.pid);
     mxdebug(boost::format("parse_pes:    PES_packet_length = %1%, PES_header_data_length = %2%, data starts at %3%\n") % pes_size % static_cast<unsigned int>(pes_header->pes_header_data_length) % to_skip);
     mxdebug(boost::format("parse_pes:    PTS? %1% (%5% processed %6%) DTS? (%7% processed %8%) %2% ESCR = %3% ES_rate = %4%\n")
@@ -1869,7 +1876,7 @@ reader_c::parse_pes(track_c &track) {
     if (   mtx::included_in(track.type, pid_type_e::audio, pid_type_e::video)
         && (   !f.m_global_timestamp_offset.valid()
             || (dts < f.m_global_timestamp_offset))) {
-      mxdebug_if(m_debug_headers, boost::format("new global timestamp offset %1% prior %2% file position afterwards %3%\n") % dts % f.m_global_timestamp_offset % f.m_in->getFilePointer());
+      mxdebug_if(m_debug_headers, boost::format("new global timestamp offset %1% prior %2% file position afterwards %3%\n") % dts % f.m_global_timestamp_offset % (f.m_packet_position + f.m_detected_packet_size));
       f.m_global_timestamp_offset = dts;
     }
 
@@ -1917,7 +1924,14 @@ reader_c::handle_packet_for_pid_not_listed_in_pmt(uint16_t pid) {
 
 void
 reader_c::parse_packet(unsigned char *buf) {
-  auto hdr   = reinterpret_cast<packet_header_t *>(buf);
+  auto hdr = reinterpret_cast<packet_header_t *>(buf);
+  auto &f  = file();
+
+  if (   f.m_pid_filter_active
+      && (processing_state_e::muxing == f.m_state)
+      && !f.m_wanted_pids[hdr->get_pid()])
+    return;
+
   auto track = find_track_for_pid(hdr->get_pid());
 
   if (!track)
@@ -2298,6 +2312,58 @@ reader_c::create_packetizers() {
   mxdebug_if(m_debug_headers, boost::format("create_packetizers: create packetizers...\n"));
   for (std::size_t i = 0u, end = m_tracks.size(); i < end; ++i)
     create_packetizer(i);
+
+  setup_pid_filters();
+}
+
+void
+reader_c::setup_pid_filters() {
+  auto current_file = m_current_file;
+
+  for (auto file_num = 0u; file_num < m_files.size(); ++file_num) {
+    auto &f        = *m_files[file_num];
+    m_current_file = file_num;
+
+    f.m_wanted_pids.reset();
+
+    // Restricting timestamps to the ranges given by a playlist needs
+    // the stream timestamp of all tracks.
+    if (   (processing_state_e::muxing != f.m_state)
+        || f.m_timestamp_restriction_min.valid()
+        || f.m_timestamp_restriction_max.valid()) {
+      f.m_pid_filter_active = false;
+      continue;
+    }
+
+    auto subtitles_wanted = false;
+
+    for (auto const &track : m_tracks) {
+      if (track->m_file_num != file_num)
+        continue;
+
+      auto track_for_pid = find_track_for_pid(track->pid);
+      if (!track_for_pid || !track_for_pid->has_packetizer())
+        continue;
+
+      f.m_wanted_pids.set(track->pid);
+      if (pid_type_e::subtitles == track_for_pid->type)
+        subtitles_wanted = true;
+    }
+
+    // Bogus subtitle timestamps are replaced by those of the audio and
+    // video tracks.
+    if (subtitles_wanted)
+      for (auto const &track : m_tracks)
+        if (   (track->m_file_num == file_num)
+            && mtx::included_in(track->type, pid_type_e::audio, pid_type_e::video))
+          f.m_wanted_pids.set(track->pid);
+
+    f.m_pid_filter_active = true;
+
+    mxdebug_if(m_debug_headers, boost::format("setup_pid_filters: file %1%: %2% PIDs wanted\n") % file_num % f.m_wanted_pids.count());
+  }
+
+  m_current_file = current_file;
 }
 
 void
@@ -2362,19 +2428,12 @@ reader_c::read(generic_packetizer_c *requested_ptzr,
 
   f.m_packet_sent_to_packetizer = false;
 
-  unsigned char buf[TS_MAX_PACKET_SIZE + 1];
-
   while (!f.m_packet_sent_to_packetizer) {
-    if (f.m_in->read(buf, f.m_detected_packet_size) != static_cast<unsigned int>(f.m_detected_packet_size))
+    auto packet = next_packet();
+    if (!packet)
       return finish();
 
-    if (buf[0] != 0x47) {
-      if (resync(f.m_in->getFilePointer() - f.m_detected_packet_size))
-        continue;
-      return finish();
-    }
-
-    parse_packet(buf);
+    parse_packet(packet);
   }
 
   return FILE_STATUS_MOREDATA;
@@ -2491,6 +2550,59 @@ reader_c::resync(int64_t start_at) {
   return false;
 }
 
+bool
+reader_c::read_chunk() {
+  auto &f          = file();
+  auto packet_size = f.m_detected_packet_size;
+
+  if (!f.m_chunk) {
+    f.m_chunk = memory_c::alloc(TS_PACKETS_PER_CHUNK * packet_size);
+    f.m_chunk_pids.resize(TS_PACKETS_PER_CHUNK);
+  }
+
+  f.discard_chunk();
+
+  f.m_chunk_position    = f.m_in->getFilePointer();
+  f.m_chunk_num_packets = f.m_in->read(f.m_chunk->get_buffer(), TS_PACKETS_PER_CHUNK * packet_size) / packet_size;
+  f.m_chunk_num_synced  = mtx::mpeg::extract_ts_pids(f.m_chunk->get_buffer(), f.m_chunk_num_packets, packet_size, f.m_chunk_pids.data());
+
+  return 0 != f.m_chunk_num_packets;
+}
+
+unsigned char *
+reader_c::next_packet() {
+  auto &f          = file();
+  auto packet_size = f.m_detected_packet_size;
+  auto filter      = f.m_pid_filter_active && (processing_state_e::muxing == f.m_state);
+
+  while (true) {
+    while (f.m_chunk_next_packet < f.m_chunk_num_synced) {
+      auto idx = f.m_chunk_next_packet++;
+
+      if (filter && !f.m_wanted_pids[f.m_chunk_pids[idx]])
+        continue;
+
+      f.m_packet_position = f.m_chunk_position + idx * packet_size;
+
+      return f.m_chunk->get_buffer() + idx * packet_size;
+    }
+
+    // Reading continues with the first packet without a sync byte
+    // once synchronization has been re-established.
+    if (f.m_chunk_num_synced < f.m_chunk_num_packets) {
+      auto position = f.m_chunk_position + f.m_chunk_num_synced * packet_size;
+
+      f.discard_chunk();
+
+      if (!resync(position))
+        return nullptr;
+    }
+
+    if (!read_chunk())
+      return nullptr;
+  }
+}
+
 track_ptr
 reader_c::find_track_for_pid(uint16_t pid)
   const {
@@ -17,6 +17,8 @@
 
 #include "common/common_pch.h"
 
+#include <bitset>
+
 #include "common/aac.h"
 #include "common/byte_buffer.h"
 #include "common/codec.h"
@@ -407,11 +409,26 @@ struct file_t {
   unsigned int m_detected_packet_size, m_num_pat_crc_errors, m_num_pmt_crc_errors;
   bool m_validate_pat_crc, m_validate_pmt_crc, m_has_audio_or_video_track;
 
+  // PIDs whose packets are needed while muxing. Packets of all other
+  // PIDs are dropped right after looking at their header.
+  std::bitset<0x2000> m_wanted_pids;
+  bool m_pid_filter_active;
+
+  // Packets are read in chunks of many packets at a time. The PIDs of
+  // all packets of the chunk up to the first one without a sync byte
+  // are extracted right after reading it.
+  memory_cptr m_chunk;
+  std::vector<uint16_t> m_chunk_pids;
+  uint64_t m_chunk_position, m_packet_position;
+  std::size_t m_chunk_num_packets, m_chunk_num_synced, m_chunk_next_packet;
+
   file_t(mm_io_cptr const &in);
 
   int64_t get_queued_bytes() const;
   void reset_processing_state(processing_state_e new_state);
   bool all_pmts_found() const;
+  void rewind();
+  void discard_chunk();
 };
 using file_cptr = std::shared_ptr<file_t>;
 
@@ -458,6 +475,7 @@ private:
   track_ptr find_track_for_pid(uint16_t pid) const;
   std::pair<unsigned char *, std::size_t> determine_ts_payload_start(packet_header_t *hdr) const;
   void setup_initial_tracks();
+  void setup_pid_filters();
 
   void handle_ts_payload(track_c &track, packet_header_t &ts_header, unsigned char *ts_payload, std::size_t ts_payload_size);
   void handle_pat_pmt_payload(track_c &track, packet_header_t &ts_header, unsigned char *ts_payload, std::size_t ts_payload_size);
@@ -502,6 +520,8 @@ private:
   void process_chapter_entries();
 
   bool resync(int64_t start_at);
+  bool read_chunk();
+  unsigned char *next_packet();
 
   uint32_t calculate_crc(void const *buffer, size_t size) const;
 
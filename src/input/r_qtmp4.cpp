@@ -60,6 +60,11 @@ using namespace libmatroska;
 
 #define MAX_INTERLEAVING_BADNESS 0.4
 
+// Samples of badly interleaved files are read in batches covering this
+// many nanoseconds of all tracks but not more than this many bytes.
+#define READ_SCHEDULER_WINDOW     1000000000ll
+#define READ_SCHEDULER_BATCH_SIZE (32 * 1024 * 1024)
+
 namespace mtx {
 
 class atom_chunk_size_x: public exception {
@@ -169,6 +174,7 @@ qtmp4_reader_c::qtmp4_reader_c(const track_info_c &ti,
   , m_debug_tables_full{                               "qtmp4_tables_full"}
   , m_debug_interleaving{"qtmp4|qtmp4_full|qtmp4_interleaving"}
   , m_debug_resync{      "qtmp4|qtmp4_full|qtmp4_resync"}
+  , m_debug_read_scheduler{    "qtmp4_full|qtmp4_read_scheduler"}
 {
 }
 
@@ -245,51 +251,106 @@ qtmp4_reader_c::resync_to_top_level_atom(uint64_t start_pos) {
   return false;
 }
 
+/* Determines the positions and sizes of the top-level atoms by reading
+   only their 8 or 16 byte headers and seeking over their payloads. The
+   file is read unbuffered meanwhile so that files with the 'moov' atom
+   at the end don't cause large parts of the 'mdat' atom to be read.
+
+   The walk stops at the first atom that doesn't look valid. Its
+   position is stored in 'resume_at' so that the caller can continue
+   from there with resyncing; otherwise 'resume_at' is set to the end
+   of the last atom. */
+std::vector<qt_atom_t>
+qtmp4_reader_c::walk_top_level_atoms(uint64_t &resume_at) {
+  std::vector<qt_atom_t> atoms;
+
+  resume_at = 0;
+  m_in->enable_buffering(false);
+
+  try {
+    while ((resume_at + 8) <= m_size) {
+      m_in->setFilePointer(resume_at);
+      auto atom = read_atom(nullptr, false);
+
+      if (!atom.fourcc.human_readable())
+        break;
+
+      atoms.push_back(atom);
+      resume_at = atom.pos + atom.size;
+    }
+
+  } catch (mtx::mm_io::exception &) {
+  } catch (mtx::atom_chunk_size_x &) {
+  }
+
+  m_in->enable_buffering(true);
+
+  mxdebug_if(m_debug_headers, boost::format("Top-level atom walk: %1% atoms, resuming at %2%\n") % atoms.size() % resume_at);
+
+  return atoms;
+}
+
 void
 qtmp4_reader_c::parse_headers() {
   unsigned int idx;
 
-  m_in->setFilePointer(0);
-
   bool headers_parsed = false;
   bool mdat_found     = false;
 
-  try {
-    while (!m_in->eof()) {
-      qt_atom_t atom = read_atom();
-      mxdebug_if(m_debug_headers, boost::format("'%1%' atom, size %2%, at %3%–%4%, human readable? %5%\n") % atom.fourcc % atom.size % atom.pos % (atom.pos + atom.size) % atom.fourcc.human_readable());
+  auto handle_top_level_atom = [&](qt_atom_t atom) -> bool {
+    mxdebug_if(m_debug_headers, boost::format("'%1%' atom, size %2%, at %3%–%4%, human readable? %5%\n") % atom.fourcc % atom.size % atom.pos % (atom.pos + atom.size) % atom.fourcc.human_readable());
 
-      if (atom.fourcc == "ftyp") {
-        auto tmp = fourcc_c{m_in};
-        mxdebug_if(m_debug_headers, boost::format("  File type major brand: %1%\n") % tmp);
+    if (atom.fourcc == "ftyp") {
+      auto tmp = fourcc_c{m_in};
+      mxdebug_if(m_debug_headers, boost::format("  File type major brand: %1%\n") % tmp);
+      tmp = fourcc_c{m_in};
+      mxdebug_if(m_debug_headers, boost::format("  File type minor brand: %1%\n") % tmp);
+
+      for (idx = 0; idx < ((atom.size - 16) / 4); ++idx) {
         tmp = fourcc_c{m_in};
-        mxdebug_if(m_debug_headers, boost::format("  File type minor brand: %1%\n") % tmp);
+        mxdebug_if(m_debug_headers, boost::format("  File type compatible brands #%1%: %2%\n") % idx % tmp);
+      }
 
-        for (idx = 0; idx < ((atom.size - 16) / 4); ++idx) {
-          tmp = fourcc_c{m_in};
-          mxdebug_if(m_debug_headers, boost::format("  File type compatible brands #%1%: %2%\n") % idx % tmp);
-        }
+    } else if (atom.fourcc == "moov") {
+      if (!headers_parsed)
+        handle_moov_atom(atom.to_parent(), 0);
+      else
+        skip_atom();
+      headers_parsed = true;
 
-      } else if (atom.fourcc == "moov") {
-        if (!headers_parsed)
-          handle_moov_atom(atom.to_parent(), 0);
-        else
-          skip_atom();
-        headers_parsed = true;
+    } else if (atom.fourcc == "mdat") {
+      skip_atom();
+      mdat_found = true;
 
-      } else if (atom.fourcc == "mdat") {
-        skip_atom();
-        mdat_found = true;
+    } else if (atom.fourcc == "moof") {
+      handle_moof_atom(atom.to_parent(), 0, atom);
 
-      } else if (atom.fourcc == "moof") {
-        handle_moof_atom(atom.to_parent(), 0, atom);
+    } else if (atom.fourcc.human_readable())
+      skip_atom();
 
-      } else if (atom.fourcc.human_readable())
-        skip_atom();
+    else
+      return resync_to_top_level_atom(atom.pos);
 
-      else if (!resync_to_top_level_atom(atom.pos))
-        break;
+    return true;
+  };
+
+  try {
+    auto resume_at = uint64_t{};
+
+    for (auto const &atom : walk_top_level_atoms(resume_at)) {
+      m_in->setFilePointer(atom.pos + atom.hsize);
+      handle_top_level_atom(atom);
+    }
+
+    // Damaged files: continue from the first invalid atom.
+    if (resume_at < m_size) {
+      m_in->setFilePointer(resume_at);
+
+      while (!m_in->eof())
+        if (!handle_top_level_atom(read_atom()))
+          break;
     }
+
   } catch (mtx::mm_io::exception &) {
   }
 
@@ -478,9 +539,66 @@ qtmp4_reader_c::handle_cmvd_atom(qt_atom_t atom,
   m_in = old_in;
 }
 
+uint32_t
+qtmp4_reader_c::limit_table_entries(qt_atom_t const &atom,
+                                    uint32_t count,
+                                    std::size_t entry_size) {
+  // Damaged files may announce more entries than the atom can hold.
+  // m_in may be the uncompressed 'moov' atom instead of the file.
+  auto end       = std::min<uint64_t>(atom.pos + atom.size, m_in->get_size());
+  auto pos       = m_in->getFilePointer();
+  auto available = end > pos ? (end - pos) / entry_size : 0;
+
+  if (count <= available)
+    return count;
+
+  mxdebug_if(m_debug_headers, boost::format("Table in atom %1% announces %2% entries but only has room for %3%\n") % atom.fourcc % count % available);
+
+  return available;
+}
+
+/* Reads 'count' table entries consisting of 'num_fields' big endian
+   values each with a single read and converts them in place. Returns
+   the number of entries actually read. */
+uint32_t
+qtmp4_reader_c::read_table(qt_atom_t const &atom,
+                           uint32_t count,
+                           std::size_t num_fields,
+                           std::vector<uint32_t> &values) {
+  count           = limit_table_entries(atom, count, num_fields * sizeof(uint32_t));
+  auto num_values = static_cast<std::size_t>(count) * num_fields;
+
+  values.resize(num_values);
+  num_values = m_in->read(values.data(), num_values * sizeof(uint32_t)) / sizeof(uint32_t);
+  count      = num_values / num_fields;
+  values.resize(count * num_fields);
+
+  get_uint32_be_array(values.data(), values.data(), values.size());
+
+  return count;
+}
+
+uint32_t
+qtmp4_reader_c::read_table(qt_atom_t const &atom,
+                           uint32_t count,
+                           std::size_t num_fields,
+                           std::vector<uint64_t> &values) {
+  count           = limit_table_entries(atom, count, num_fields * sizeof(uint64_t));
+  auto num_values = static_cast<std::size_t>(count) * num_fields;
+
+  values.resize(num_values);
+  num_values = m_in->read(values.data(), num_values * sizeof(uint64_t)) / sizeof(uint64_t);
+  count      = num_values / num_fields;
+  values.resize(count * num_fields);
+
+  get_uint64_be_array(values.data(), values.data(), values.size());
+
+  return count;
+}
+
 void
 qtmp4_reader_c::handle_ctts_atom(qtmp4_demuxer_c &dmx,
-                                 qt_atom_t,
+                                 qt_atom_t atom,
                                  int level) {
   auto version = m_in->read_uint8();
   m_in->skip(3);                // version & flags
@@ -488,14 +606,12 @@ qtmp4_reader_c::handle_ctts_atom(qtmp4_demuxer_c &dmx,
   auto count = m_in->read_uint32_be();
   mxdebug_if(m_debug_headers, boost::format("%1%Frame offset table v%3%: %2% raw entries\n") % space(level * 2 + 1) % count % static_cast<unsigned int>(version));
 
-  size_t i;
-  for (i = 0; i < count; ++i) {
-    qt_frame_offset_t frame_offset;
+  std::vector<uint32_t> values;
+  count = read_table(atom, count, 2, values);
 
-    frame_offset.count  = m_in->read_uint32_be();
-    frame_offset.offset = mtx::math::to_signed(m_in->read_uint32_be());
-    dmx.raw_frame_offset_table.push_back(frame_offset);
-  }
+  dmx.raw_frame_offset_table.reserve(dmx.raw_frame_offset_table.size() + count);
+  for (auto idx = std::size_t{}; idx < values.size(); idx += 2)
+    dmx.raw_frame_offset_table.emplace_back(values[idx], mtx::math::to_signed(values[idx + 1]));
 
   if (!m_debug_tables)
     return;
@@ -1199,15 +1315,19 @@ qtmp4_reader_c::handle_stbl_atom(qtmp4_demuxer_c &dmx,
 
 void
 qtmp4_reader_c::handle_stco_atom(qtmp4_demuxer_c &dmx,
-                                 qt_atom_t,
+                                 qt_atom_t atom,
                                  int level) {
   m_in->skip(1 + 3);        // version & flags
   uint32_t count = m_in->read_uint32_be();
 
   mxdebug_if(m_debug_headers, boost::format("%1%Chunk offset table: %2% entries\n") % space(level * 2 + 1) % count);
 
-  for (auto i = 0u; i < count; ++i)
-    dmx.chunk_table.emplace_back(0, m_in->read_uint32_be());
+  std::vector<uint32_t> offsets;
+  read_table(atom, count, 1, offsets);
+
+  dmx.chunk_table.reserve(dmx.chunk_table.size() + offsets.size());
+  for (auto offset : offsets)
+    dmx.chunk_table.emplace_back(0, offset);
 
   if (!m_debug_tables)
     return;
@@ -1221,15 +1341,19 @@ qtmp4_reader_c::handle_stco_atom(qtmp4_demuxer_c &dmx,
 
 void
 qtmp4_reader_c::handle_co64_atom(qtmp4_demuxer_c &dmx,
-                                 qt_atom_t,
+                                 qt_atom_t atom,
                                  int level) {
   m_in->skip(1 + 3);        // version & flags
   uint32_t count = m_in->read_uint32_be();
 
   mxdebug_if(m_debug_headers, boost::format("%1%64bit chunk offset table: %2% entries\n") % space(level * 2 + 1) % count);
 
-  for (auto i = 0u; i < count; ++i)
-    dmx.chunk_table.emplace_back(0, m_in->read_uint64_be());
+  std::vector<uint64_t> offsets;
+  read_table(atom, count, 1, offsets);
+
+  dmx.chunk_table.reserve(dmx.chunk_table.size() + offsets.size());
+  for (auto offset : offsets)
+    dmx.chunk_table.emplace_back(0, offset);
 
   if (!m_debug_tables)
     return;
@@ -1243,17 +1367,21 @@ qtmp4_reader_c::handle_co64_atom(qtmp4_demuxer_c &dmx,
 
 void
 qtmp4_reader_c::handle_stsc_atom(qtmp4_demuxer_c &dmx,
-                                 qt_atom_t,
+                                 qt_atom_t atom,
                                  int level) {
   m_in->skip(1 + 3);        // version & flags
   uint32_t count = m_in->read_uint32_be();
-  size_t i;
-  for (i = 0; i < count; ++i) {
+
+  std::vector<uint32_t> values;
+  count = read_table(atom, count, 3, values);
+
+  dmx.chunkmap_table.reserve(dmx.chunkmap_table.size() + count);
+  for (auto idx = std::size_t{}; idx < values.size(); idx += 3) {
     qt_chunkmap_t chunkmap;
 
-    chunkmap.first_chunk           = m_in->read_uint32_be() - 1;
-    chunkmap.samples_per_chunk     = m_in->read_uint32_be();
-    chunkmap.sample_description_id = m_in->read_uint32_be();
+    chunkmap.first_chunk           = values[idx] - 1;
+    chunkmap.samples_per_chunk     = values[idx + 1];
+    chunkmap.sample_description_id = values[idx + 2];
     dmx.chunkmap_table.push_back(chunkmap);
   }
 
@@ -1298,14 +1426,15 @@ qtmp4_reader_c::handle_stsd_atom(qtmp4_demuxer_c &dmx,
 
 void
 qtmp4_reader_c::handle_stss_atom(qtmp4_demuxer_c &dmx,
-                                 qt_atom_t,
+                                 qt_atom_t atom,
                                  int level) {
   m_in->skip(1 + 3);        // version & flags
   uint32_t count = m_in->read_uint32_be();
 
-  size_t i;
-  for (i = 0; i < count; ++i)
-    dmx.keyframe_table.push_back(m_in->read_uint32_be());
+  std::vector<uint32_t> keyframes;
+  count = read_table(atom, count, 1, keyframes);
+
+  dmx.keyframe_table.insert(dmx.keyframe_table.end(), keyframes.begin(), keyframes.end());
 
   std::sort(dmx.keyframe_table.begin(), dmx.keyframe_table.end());
 
@@ -1322,25 +1451,24 @@ qtmp4_reader_c::handle_stss_atom(qtmp4_demuxer_c &dmx,
 
 void
 qtmp4_reader_c::handle_stsz_atom(qtmp4_demuxer_c &dmx,
-                                 qt_atom_t,
+                                 qt_atom_t atom,
                                  int level) {
   m_in->skip(1 + 3);        // version & flags
   uint32_t sample_size = m_in->read_uint32_be();
   uint32_t count       = m_in->read_uint32_be();
 
   if (0 == sample_size) {
-    size_t i;
-    for (i = 0; i < count; ++i) {
-      qt_sample_t sample;
-
-      sample.size = m_in->read_uint32_be();
+    std::vector<uint32_t> sizes;
+    count = read_table(atom, count, 1, sizes);
 
+    dmx.sample_table.reserve(dmx.sample_table.size() + count);
+    for (auto size : sizes) {
       // This is a sanity check against damaged samples. I have one of
       // those in which one sample was suppposed to be > 2GB big.
-      if (sample.size >= 100 * 1024 * 1024)
-        sample.size = 0;
+      if (size >= 100 * 1024 * 1024)
+        size = 0;
 
-      dmx.sample_table.push_back(sample);
+      dmx.sample_table.emplace_back(size);
     }
 
     mxdebug_if(m_debug_headers, boost::format("%1%Sample size table: %2% entries\n") % space(level * 2 + 1) % count);
@@ -1360,19 +1488,17 @@ qtmp4_reader_c::handle_stsz_atom(qtmp4_demuxer_c &dmx,
 
 void
 qtmp4_reader_c::handle_sttd_atom(qtmp4_demuxer_c &dmx,
-                                 qt_atom_t,
+                                 qt_atom_t atom,
                                  int level) {
   m_in->skip(1 + 3);        // version & flags
   uint32_t count = m_in->read_uint32_be();
 
-  size_t i;
-  for (i = 0; i < count; ++i) {
-    qt_durmap_t durmap;
+  std::vector<uint32_t> values;
+  count = read_table(atom, count, 2, values);
 
-    durmap.number   = m_in->read_uint32_be();
-    durmap.duration = m_in->read_uint32_be();
-    dmx.durmap_table.push_back(durmap);
-  }
+  dmx.durmap_table.reserve(dmx.durmap_table.size() + count);
+  for (auto idx = std::size_t{}; idx < values.size(); idx += 2)
+    dmx.durmap_table.emplace_back(values[idx], values[idx + 1]);
 
   mxdebug_if(m_debug_headers, boost::format("%1%Sample duration table: %2% entries\n") % space(level * 2 + 1) % count);
   if (!m_debug_tables)
@@ -1387,19 +1513,17 @@ qtmp4_reader_c::handle_sttd_atom(qtmp4_demuxer_c &dmx,
 
 void
 qtmp4_reader_c::handle_stts_atom(qtmp4_demuxer_c &dmx,
-                                 qt_atom_t,
+                                 qt_atom_t atom,
                                  int level) {
   m_in->skip(1 + 3);        // version & flags
   uint32_t count = m_in->read_uint32_be();
 
-  size_t i;
-  for (i = 0; i < count; ++i) {
-    qt_durmap_t durmap;
+  std::vector<uint32_t> values;
+  count = read_table(atom, count, 2, values);
 
-    durmap.number   = m_in->read_uint32_be();
-    durmap.duration = m_in->read_uint32_be();
-    dmx.durmap_table.push_back(durmap);
-  }
+  dmx.durmap_table.reserve(dmx.durmap_table.size() + count);
+  for (auto idx = std::size_t{}; idx < values.size(); idx += 2)
+    dmx.durmap_table.emplace_back(values[idx], values[idx + 1]);
 
   mxdebug_if(m_debug_headers, boost::format("%1%Sample duration table: %2% entries\n") % space(level * 2 + 1) % count);
   if (!m_debug_tables)
@@ -1564,37 +1688,31 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
  auto &dmx   = *m_demuxers[dmx_idx];
  auto &index = dmx.m_index[dmx.pos];
 
-  m_in->setFilePointer(index.file_pos);
+  auto buffer = read_sample(dmx_idx);
 
-  int buffer_offset = 0;
-  memory_cptr buffer;
+  if (!buffer) {
+    mxwarn(boost::format(Y("Quicktime/MP4 reader: Could not read chunk number %1%/%2% with size %3% from position %4%. Aborting.\n"))
+           % dmx.pos % dmx.m_index.size() % index.size % index.file_pos);
+    return flush_packetizers();
+  }
 
   if (   dmx.is_video()
       && !dmx.pos
       && dmx.codec.is(codec_c::type_e::V_MPEG4_P2)
       && dmx.esds_parsed
       && (dmx.esds.decoder_config)) {
-    buffer        = memory_c::alloc(index.size + dmx.esds.decoder_config->get_size());
-    buffer_offset = dmx.esds.decoder_config->get_size();
+    auto config_size = dmx.esds.decoder_config->get_size();
+    auto sample      = buffer;
 
-    memcpy(buffer->get_buffer(), dmx.esds.decoder_config->get_buffer(), dmx.esds.decoder_config->get_size());
+    buffer = memory_c::alloc(config_size + sample->get_size());
+
+    memcpy(buffer->get_buffer(),               dmx.esds.decoder_config->get_buffer(), config_size);
+    memcpy(buffer->get_buffer() + config_size, sample->get_buffer(),                  sample->get_size());
 
   } else if (   dmx.is_video()
              && dmx.codec.is(codec_c::type_e::V_PRORES)
-             && (index.size >= 8)) {
-    m_in->skip(8);
-    index.size -= 8;
-    buffer = memory_c::alloc(index.size);
-
-  } else {
-    buffer = memory_c::alloc(index.size);
-  }
-
-  if (m_in->read(buffer->get_buffer() + buffer_offset, index.size) != index.size) {
-    mxwarn(boost::format(Y("Quicktime/MP4 reader: Could not read chunk number %1%/%2% with size %3% from position %4%. Aborting.\n"))
-           % dmx.pos % dmx.m_index.size() % index.size % index.file_pos);
-    return flush_packetizers();
-  }
+             && (index.size >= 8))
+    buffer = memory_c::view(*buffer, 8, buffer->get_size() - 8);
 
   auto duration = dmx.m_use_frame_rate_for_duration ? *dmx.m_use_frame_rate_for_duration : index.duration;
   PTZR(dmx.ptzr)->process(new packet_t(buffer, index.timecode, duration, index.is_keyframe ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
@@ -1606,6 +1724,73 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
   return flush_packetizers();
 }
 
+memory_cptr
+qtmp4_reader_c::read_sample(std::size_t dmx_idx) {
+  auto &dmx   = *m_demuxers[dmx_idx];
+  auto &index = dmx.m_index[dmx.pos];
+
+  if (m_read_scheduler) {
+    auto buffer = m_read_scheduler->take(dmx_idx, dmx.pos);
+    if (!buffer) {
+      schedule_reads(dmx_idx);
+      buffer = m_read_scheduler->take(dmx_idx, dmx.pos);
+    }
+
+    return buffer;
+  }
+
+  auto buffer = memory_c::alloc(index.size);
+
+  m_in->setFilePointer(index.file_pos);
+  if (m_in->read(buffer->get_buffer(), index.size) != index.size)
+    return {};
+
+  return buffer;
+}
+
+/* Reads the requested sample together with the upcoming samples of all
+   tracks within a time window in the order of their file positions so
+   that badly interleaved files are read nearly sequentially instead of
+   seeking back and forth between the tracks' data for each sample. */
+void
+qtmp4_reader_c::schedule_reads(std::size_t dmx_idx) {
+  auto &requested   = *m_demuxers[dmx_idx];
+  auto &first       = requested.m_index[requested.pos];
+  auto end_timecode = first.timecode + READ_SCHEDULER_WINDOW;
+  auto num_bytes    = static_cast<uint64_t>(first.size);
+
+  m_read_scheduler->add(dmx_idx, requested.pos, first.file_pos, first.size);
+
+  for (auto idx = std::size_t{}; idx < m_demuxers.size(); ++idx) {
+    auto &dmx = *m_demuxers[idx];
+
+    if (-1 == dmx.ptzr)
+      continue;
+
+    for (auto pos = static_cast<std::size_t>(dmx.pos); (pos < dmx.m_index.size()) && (num_bytes < READ_SCHEDULER_BATCH_SIZE); ++pos) {
+      auto const &index = dmx.m_index[pos];
+
+      if (index.timecode >= end_timecode)
+        break;
+
+      if (m_read_scheduler->is_scheduled(idx, pos))
+        continue;
+
+      m_read_scheduler->add(idx, pos, index.file_pos, index.size);
+      num_bytes += index.size;
+    }
+  }
+
+  m_read_scheduler->execute();
+
+  if (!m_debug_read_scheduler)
+    return;
+
+  auto const &stats = m_read_scheduler->get_statistics();
+  mxdebug(boost::format("Read scheduler: batch for track %1% sample %2%: %3% bytes; total: %4% samples in %5% reads, %6% bytes read, %7% bytes skipped in gaps\n")
+          % requested.id % requested.pos % num_bytes % stats.m_num_blocks % stats.m_num_reads % stats.m_num_bytes_read % stats.m_num_gap_bytes);
+}
+
 memory_cptr
 qtmp4_reader_c::create_bitmap_info_header(qtmp4_demuxer_c &dmx,
                                           const char *fourcc,
@@ -2007,8 +2192,10 @@ qtmp4_reader_c::detect_interleaving() {
   double badness = *boost::max_element(gradients) - *boost::min_element(gradients);
   mxdebug_if(m_debug_interleaving, boost::format("Interleaving: Badness: %1% (%2%)\n") % badness % (MAX_INTERLEAVING_BADNESS < badness ? "badly interleaved" : "ok"));
 
-  if (MAX_INTERLEAVING_BADNESS < badness)
+  if (MAX_INTERLEAVING_BADNESS < badness) {
     m_in->enable_buffering(false);
+    m_read_scheduler = std::make_unique<read_scheduler_c>(*m_in);
+  }
 }
 
 // ----------------------------------------------------------------------
@@ -21,6 +21,7 @@
 #include "common/dts.h"
 #include "common/fourcc.h"
 #include "common/mm_io.h"
+#include "common/read_scheduler.h"
 #include "input/qtmp4_atoms.h"
 #include "merge/generic_reader.h"
 #include "output/p_pcm.h"
@@ -456,7 +457,9 @@ private:
 
   bool m_timecodes_calculated;
 
-  debugging_option_c m_debug_chapters, m_debug_headers, m_debug_tables, m_debug_tables_full, m_debug_interleaving, m_debug_resync;
+  std::unique_ptr<read_scheduler_c> m_read_scheduler;
+
+  debugging_option_c m_debug_chapters, m_debug_headers, m_debug_tables, m_debug_tables_full, m_debug_interleaving, m_debug_resync, m_debug_read_scheduler;
 
   friend class qtmp4_demuxer_c;
 
@@ -480,11 +483,16 @@ public:
 
 protected:
   virtual void parse_headers();
+  virtual std::vector<qt_atom_t> walk_top_level_atoms(uint64_t &resume_at);
   virtual void verify_track_parameters_and_update_indexes();
   virtual void calculate_timecodes();
   virtual boost::optional<int64_t> calculate_global_min_timecode() const;
   virtual qt_atom_t read_atom(mm_io_c *read_from = nullptr, bool exit_on_error = true);
   virtual bool resync_to_top_level_atom(uint64_t start_pos);
+
+  virtual uint32_t limit_table_entries(qt_atom_t const &atom, uint32_t count, std::size_t entry_size);
+  virtual uint32_t read_table(qt_atom_t const &atom, uint32_t count, std::size_t num_fields, std::vector<uint32_t> &values);
+  virtual uint32_t read_table(qt_atom_t const &atom, uint32_t count, std::size_t num_fields, std::vector<uint64_t> &values);
   virtual void parse_itunsmpb(std::string data);
 
   virtual void handle_cmov_atom(qt_atom_t parent, int level);
@@ -553,6 +561,8 @@ protected:
   virtual void process_chapter_entries(int level, std::vector<qtmp4_chapter_entry_t> &entries);
 
   virtual void detect_interleaving();
+  virtual memory_cptr read_sample(std::size_t dmx_idx);
+  virtual void schedule_reads(std::size_t dmx_idx);
 
   virtual std::string read_string_atom(qt_atom_t atom, size_t num_skipped);
 };
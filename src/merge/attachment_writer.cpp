@@ -0,0 +1,177 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   serialization of attachments without buffering their content
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <ebml/EbmlElement.h>
+#include <matroska/KaxAttached.h>
+#include <matroska/KaxAttachments.h>
+
+#include "common/ebml.h"
+#include "common/endian.h"
+#include "common/mm_io_x.h"
+#include "merge/attachment_writer.h"
+
+using namespace libebml;
+using namespace libmatroska;
+
+static debugging_option_c s_debug{"attachment_writer"};
+
+static uint64_t
+calc_element_size(EbmlId const &id,
+                  uint64_t content_size) {
+  return EBML_ID_LENGTH(id) + CodedSizeLength(content_size, 0) + content_size;
+}
+
+static unsigned int
+calc_uint_size(uint64_t value) {
+  auto size = 1u;
+  while ((size < 8) && (value >> (size * 8)))
+    ++size;
+
+  return size;
+}
+
+static void
+write_string(mm_io_c &out,
+             EbmlId const &id,
+             std::string const &value) {
+  write_ebml_element_head(out, id, value.size());
+  out.write(value);
+}
+
+attachment_writer_c::attachment_writer_c(std::size_t chunk_size)
+  : m_chunk_size{chunk_size}
+{
+}
+
+void
+attachment_writer_c::add(attachment_cptr const &attachment) {
+  m_attachments.push_back(attachment);
+}
+
+bool
+attachment_writer_c::empty()
+  const {
+  return m_attachments.empty();
+}
+
+std::string
+attachment_writer_c::get_stored_name(attachment_t const &attachment) {
+  return attachment.stored_name.empty() ? bfs::path{attachment.name}.filename().string() : attachment.stored_name;
+}
+
+uint64_t
+attachment_writer_c::get_attached_size(attachment_t const &attachment)
+  const {
+  auto size = calc_element_size(EBML_ID(KaxFileName), get_stored_name(attachment).size())
+            + calc_element_size(EBML_ID(KaxMimeType), attachment.mime_type.size())
+            + calc_element_size(EBML_ID(KaxFileData), attachment.get_size())
+            + calc_element_size(EBML_ID(KaxFileUID),  calc_uint_size(attachment.id));
+
+  if (!attachment.description.empty())
+    size += calc_element_size(EBML_ID(KaxFileDescription), attachment.description.size());
+
+  return size;
+}
+
+void
+attachment_writer_c::render(mm_io_c &out) {
+  auto content_size = uint64_t{};
+  for (auto const &attachment : m_attachments)
+    content_size += calc_element_size(EBML_ID(KaxAttached), get_attached_size(*attachment));
+
+  m_position = out.getFilePointer();
+  m_size     = calc_element_size(EBML_ID(KaxAttachments), content_size);
+
+  mxdebug_if(s_debug, boost::format("attachment_writer: writing %1% attachments at %2% size %3%\n") % m_attachments.size() % m_position % m_size);
+
+  auto buffer = memory_c::alloc(m_chunk_size);
+
+  write_ebml_element_head(out, EBML_ID(KaxAttachments), content_size);
+
+  for (auto const &attachment : m_attachments)
+    write_attached(out, *attachment, *buffer);
+}
+
+void
+attachment_writer_c::write_attached(mm_io_c &out,
+                                    attachment_t const &attachment,
+                                    memory_c &buffer) {
+  write_ebml_element_head(out, EBML_ID(KaxAttached), get_attached_size(attachment));
+
+  write_string(out, EBML_ID(KaxFileName), get_stored_name(attachment));
+  write_string(out, EBML_ID(KaxMimeType), attachment.mime_type);
+
+  write_ebml_element_head(out, EBML_ID(KaxFileData), attachment.get_size());
+  if (attachment.data)
+    out.write(attachment.data);
+  else
+    copy_file_content(out, attachment, buffer);
+
+  unsigned char uid[8];
+  auto uid_size = calc_uint_size(attachment.id);
+  put_uint_be(uid, attachment.id, uid_size);
+
+  write_ebml_element_head(out, EBML_ID(KaxFileUID), uid_size);
+  out.write(uid, uid_size);
+
+  if (!attachment.description.empty())
+    write_string(out, EBML_ID(KaxFileDescription), attachment.description);
+}
+
+void
+attachment_writer_c::copy_file_content(mm_io_c &out,
+                                       attachment_t const &attachment,
+                                       memory_c &buffer) {
+  auto to_copy = attachment.get_size();
+
+  try {
+    auto in = mm_file_io_c::open(attachment.name);
+
+    // The element's size has already been written. A file that has
+    // been shortened in the meantime would result in a broken file.
+    while (to_copy) {
+      auto num_wanted = static_cast<std::size_t>(std::min<uint64_t>(to_copy, buffer.get_size()));
+      auto num_read   = in->read(buffer.get_buffer(), num_wanted);
+
+      if (num_read != num_wanted)
+        break;
+
+      out.write(buffer.get_buffer(), num_read);
+      to_copy -= num_read;
+    }
+
+  } catch (mtx::mm_io::exception &) {
+  }
+
+  if (to_copy)
+    mxerror(boost::format(Y("The attachment '%1%' could not be read.\n")) % attachment.name);
+}
+
+uint64_t
+attachment_writer_c::get_position()
+  const {
+  return m_position;
+}
+
+uint64_t
+attachment_writer_c::get_element_size()
+  const {
+  return m_size;
+}
+
+void
+attachment_writer_c::set_position(uint64_t position) {
+  m_position = position;
+}
@@ -0,0 +1,61 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   serialization of attachments without buffering their content
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_ATTACHMENT_WRITER_H
+#define MTX_MERGE_ATTACHMENT_WRITER_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+#include "merge/output_control.h"
+
+/* Writes a KaxAttachments element without building libmatroska's
+   element tree for it. The content of attachments that aren't kept in
+   memory (those given with '--attach-file') is copied from their files
+   in chunks while writing, so the memory used doesn't depend on the
+   attachments' sizes.
+
+   The output is byte-identical to what libmatroska renders for a
+   KaxAttached whose children are set in the order render_attachments()
+   used to set them: FileName, MimeType, FileData and FileUID come first
+   as they're mandatory, followed by an optional FileDescription. */
+class attachment_writer_c {
+protected:
+  std::vector<attachment_cptr> m_attachments;
+  std::size_t m_chunk_size;
+  uint64_t m_position{}, m_size{};
+
+public:
+  attachment_writer_c(std::size_t chunk_size = 1024 * 1024);
+
+  void add(attachment_cptr const &attachment);
+  bool empty() const;
+
+  // Writes all attachments to 'out' at its current position.
+  void render(mm_io_c &out);
+
+  uint64_t get_position() const;
+  uint64_t get_element_size() const;
+
+  // Used after the written data has been moved within the file.
+  void set_position(uint64_t position);
+
+protected:
+  uint64_t get_attached_size(attachment_t const &attachment) const;
+  void write_attached(mm_io_c &out, attachment_t const &attachment, memory_c &buffer);
+  void copy_file_content(mm_io_c &out, attachment_t const &attachment, memory_c &buffer);
+
+  static std::string get_stored_name(attachment_t const &attachment);
+};
+
+#endif // MTX_MERGE_ATTACHMENT_WRITER_H
@@ -0,0 +1,101 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   identification of several files at once
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "common/strings/editing.h"
+#include "merge/batch_identification.h"
+
+namespace mtx { namespace identification {
+
+int
+identify_in_order(std::vector<std::string> const &file_names,
+                  unsigned int num_threads,
+                  identify_cb const &identify,
+                  output_cb const &output) {
+  struct slot_t {
+    result_t m_result;
+    bool m_done{};
+  };
+
+  auto slots            = std::vector<slot_t>(file_names.size());
+  auto next_to_identify = std::size_t{};
+  auto threads          = std::vector<std::thread>{};
+  std::mutex mutex;
+  std::condition_variable result_available;
+
+  auto worker = [&]() {
+    while (true) {
+      auto idx = std::size_t{};
+
+      {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (next_to_identify >= file_names.size())
+          return;
+
+        idx = next_to_identify++;
+      }
+
+      auto result = identify(file_names[idx]);
+
+      {
+        std::lock_guard<std::mutex> lock{mutex};
+        slots[idx].m_result = std::move(result);
+        slots[idx].m_done   = true;
+      }
+
+      result_available.notify_all();
+    }
+  };
+
+  num_threads = std::max<unsigned int>(std::min<std::size_t>(num_threads, file_names.size()), 1);
+  for (auto idx = 0u; idx < num_threads; ++idx)
+    threads.emplace_back(worker);
+
+  auto exit_code = 0;
+
+  for (auto &slot : slots) {
+    std::unique_lock<std::mutex> lock{mutex};
+    result_available.wait(lock, [&slot]() { return slot.m_done; });
+    lock.unlock();
+
+    output(slot.m_result.first);
+    exit_code = std::max(exit_code, slot.m_result.second);
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+
+  return exit_code;
+}
+
+std::vector<std::string>
+parse_file_list(std::string const &content) {
+  auto file_names = std::vector<std::string>{};
+
+  for (auto file_name : split(content, "\n")) {
+    if (!file_name.empty() && (file_name.back() == '\r'))
+      file_name.pop_back();
+
+    if (!file_name.empty())
+      file_names.emplace_back(file_name);
+  }
+
+  return file_names;
+}
+
+}}
@@ -0,0 +1,41 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   identification of several files at once
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_BATCH_IDENTIFICATION_H
+#define MTX_MERGE_BATCH_IDENTIFICATION_H
+
+#include "common/common_pch.h"
+
+namespace mtx { namespace identification {
+
+// The output for a single file and the exit code its identification
+// would have resulted in.
+using result_t    = std::pair<std::string, int>;
+using identify_cb = std::function<result_t(std::string const &)>;
+using output_cb   = std::function<void(std::string const &)>;
+
+/* Identifies the files by calling 'identify' on up to 'num_threads'
+   threads. 'output' is called on the calling thread for each file's
+   output in the order the files were given, as soon as the output of
+   all preceding files has been passed on. Returns the highest exit
+   code of all identifications. */
+int identify_in_order(std::vector<std::string> const &file_names, unsigned int num_threads, identify_cb const &identify, output_cb const &output);
+
+/* Splits the content of a file list as given to
+   --identification-file-list into file names: one name per line,
+   Windows line endings are accepted, empty lines are ignored. */
+std::vector<std::string> parse_file_list(std::string const &content);
+
+}}
+
+#endif // MTX_MERGE_BATCH_IDENTIFICATION_H
@@ -21,6 +21,7 @@
 #include "common/tags/tags.h"
 #include "common/translation.h"
 #include "merge/cluster_helper.h"
+#include "merge/cluster_writer.h"
 #include "merge/cues.h"
 #include "merge/generic_packetizer.h"
 #include "merge/generic_reader.h"
@@ -307,7 +308,6 @@ cluster_helper_c::set_duration(render_groups_c *rg) {
   if (rg->m_durations.empty())
     return;
 
-  kax_block_blob_c *group = rg->m_groups.back().get();
   int64_t def_duration    = rg->m_source->get_track_default_duration();
   int64_t block_duration  = 0;
 
@@ -322,13 +322,22 @@ cluster_helper_c::set_duration(render_groups_c *rg) {
     if (   (0 == block_duration)
         || (   (0 < block_duration)
             && (RND_TIMECODE_SCALE(block_duration) != RND_TIMECODE_SCALE(static_cast<int64_t>(rg->m_durations.size()) * def_duration))))
-      group->set_block_duration(RND_TIMECODE_SCALE(block_duration));
+      set_block_duration(*rg, RND_TIMECODE_SCALE(block_duration));
 
   } else if (   (   g_use_durations
                  || (0 < def_duration))
              && (0 < block_duration)
              && (RND_TIMECODE_SCALE(block_duration) != RND_TIMECODE_SCALE(rg->m_durations.size() * def_duration)))
-    group->set_block_duration(RND_TIMECODE_SCALE(block_duration));
+    set_block_duration(*rg, RND_TIMECODE_SCALE(block_duration));
+}
+
+void
+cluster_helper_c::set_block_duration(render_groups_c &rg,
+                                     uint64_t duration) {
+  if (!rg.m_blocks.empty())
+    m->cluster_writer.set_block_duration(rg.m_blocks.back(), duration);
+  else
+    rg.m_groups.back()->set_block_duration(duration);
 }
 
 bool
@@ -379,6 +388,7 @@ cluster_helper_c::must_duration_be_set(render_groups_c *rg,
 int
 cluster_helper_c::render() {
   std::vector<render_groups_cptr> render_groups;
+  std::vector<render_groups_c *> render_groups_by_track_num;
   kax_cues_with_cleanup_c cues;
   cues.SetGlobalTimecodeScale(g_timecode_scale);
 
@@ -386,6 +396,8 @@ cluster_helper_c::render() {
 
   LacingType lacing_type  = hack_engaged(ENGAGE_LACING_XIPH) ? LACING_XIPH : hack_engaged(ENGAGE_LACING_EBML) ? LACING_EBML : LACING_AUTO;
 
+  bool render_directly    = can_render_directly();
+
   int64_t min_cl_timecode = std::numeric_limits<int64_t>::max();
   int64_t max_cl_timecode = 0;
 
@@ -401,6 +413,9 @@ cluster_helper_c::render() {
   m->timecode_offset       = boost::accumulate(m->packets, m->timecode_offset, [](int64_t a, const packet_cptr &p) { return std::min(a, p->assigned_timecode); });
   int64_t timecode_offset = m->timecode_offset + get_discarded_duration();
 
+  if (render_directly)
+    m->cluster_writer.reset(g_timecode_scale);
+
   for (auto &pack : m->packets) {
     generic_packetizer_c *source = pack->source;
     bool has_codec_state         = !!pack->codec_state;
@@ -418,12 +433,13 @@ cluster_helper_c::render() {
     if (source->contains_gap())
       m->cluster->SetSilentTrackUsed();
 
-    render_groups_c *render_group = nullptr;
-    for (auto &rg : render_groups)
-      if (rg->m_source == source) {
-        render_group = rg.get();
-        break;
-      }
+    // Track numbers are small and unique, so they can index the
+    // render groups directly.
+    auto track_num = static_cast<std::size_t>(source->get_track_num());
+    if (render_groups_by_track_num.size() <= track_num)
+      render_groups_by_track_num.resize(track_num + 1, nullptr);
+
+    auto &render_group = render_groups_by_track_num[track_num];
 
     if (!render_group) {
       render_groups.push_back(render_groups_cptr(new render_groups_c(source)));
@@ -433,8 +449,6 @@ cluster_helper_c::render() {
     min_cl_timecode                        = std::min(pack->assigned_timecode, min_cl_timecode);
     max_cl_timecode                        = std::max(pack->assigned_timecode, max_cl_timecode);
 
-    DataBuffer *data_buffer                = new DataBuffer((binary *)pack->data->get_buffer(), pack->data->get_size());
-
     KaxTrackEntry &track_entry             = static_cast<KaxTrackEntry &>(*source->get_track_entry());
 
     kax_block_blob_c *previous_block_group = !render_group->m_groups.empty() ? render_group->m_groups.back().get() : nullptr;
@@ -460,10 +474,15 @@ cluster_helper_c::render() {
         : pack->has_discard_padding()              ? BLOCK_BLOB_NO_SIMPLE
         :                                            BLOCK_BLOB_ALWAYS_SIMPLE;
 
-      render_group->m_groups.push_back(kax_block_blob_cptr(new kax_block_blob_c(this_block_blob_type)));
-      new_block_group = render_group->m_groups.back().get();
-      m->cluster->AddBlockBlob(new_block_group);
-      new_block_group->SetParent(*m->cluster);
+      if (render_directly)
+        render_group->m_blocks.push_back(m->cluster_writer.add_block(BLOCK_BLOB_ALWAYS_SIMPLE == this_block_blob_type));
+
+      else {
+        render_group->m_groups.push_back(kax_block_blob_cptr(new kax_block_blob_c(this_block_blob_type)));
+        new_block_group = render_group->m_groups.back().get();
+        m->cluster->AddBlockBlob(new_block_group);
+        new_block_group->SetParent(*m->cluster);
+      }
 
       added_to_cues = false;
     }
@@ -473,9 +492,17 @@ cluster_helper_c::render() {
         static_cast<before_adding_to_cluster_cb_packet_extension_c *>(extension.get())->get_callback()(pack, timecode_offset);
 
     // Now put the packet into the cluster.
-    render_group->m_more_data = new_block_group->add_frame_auto(track_entry, pack->assigned_timecode - timecode_offset, *data_buffer, lacing_type,
-                                                                pack->has_bref() ? pack->bref - timecode_offset : -1,
-                                                                pack->has_fref() ? pack->fref - timecode_offset : -1);
+    if (render_directly)
+      render_group->m_more_data = m->cluster_writer.add_frame(render_group->m_blocks.back(), source->get_track_num(), pack->assigned_timecode - timecode_offset, pack->data, lacing_type,
+                                                              pack->has_bref() ? pack->bref - timecode_offset : -1,
+                                                              pack->has_fref() ? pack->fref - timecode_offset : -1);
+
+    else {
+      DataBuffer *data_buffer   = new DataBuffer((binary *)pack->data->get_buffer(), pack->data->get_size());
+      render_group->m_more_data = new_block_group->add_frame_auto(track_entry, pack->assigned_timecode - timecode_offset, *data_buffer, lacing_type,
+                                                                  pack->has_bref() ? pack->bref - timecode_offset : -1,
+                                                                  pack->has_fref() ? pack->fref - timecode_offset : -1);
+    }
 
     if (has_codec_state) {
       KaxBlockGroup &bgroup = (KaxBlockGroup &)*new_block_group;
@@ -501,7 +528,15 @@ cluster_helper_c::render() {
 
     cues_c::get().set_duration_for_id_timecode(source->get_track_num(), pack->assigned_timecode - timecode_offset, pack->get_duration());
 
-    if (new_block_group) {
+    if (render_directly) {
+      // Neither codec states nor reference priorities occur here.
+      if (!pack->data_adds.empty())
+        m->cluster_writer.add_block_additions(render_group->m_blocks.back(), pack->data_adds);
+
+      if (pack->has_discard_padding())
+        m->cluster_writer.set_discard_padding(render_group->m_blocks.back(), pack->discard_padding.to_ns());
+
+    } else if (new_block_group) {
       // Set the reference priority if it was wanted.
       if ((0 < pack->ref_priority) && new_block_group->replace_simple_by_group())
         GetChild<KaxReferencePriority>(*new_block_group).SetValue(pack->ref_priority);
@@ -524,12 +559,14 @@ cluster_helper_c::render() {
 
     elements_in_cluster++;
 
-    if (!new_block_group)
+    if (!render_directly && !new_block_group)
       new_block_group = previous_block_group;
 
     else if (g_write_cues && (!added_to_cues || has_codec_state)) {
       added_to_cues = add_to_cues_maybe(pack);
-      if (added_to_cues)
+      if (added_to_cues && render_directly)
+        m->cluster_writer.add_to_cues(render_group->m_blocks.back());
+      else if (added_to_cues)
         cues.AddBlockBlob(*new_block_group);
     }
 
@@ -545,19 +582,24 @@ cluster_helper_c::render() {
       for (auto &rg : render_groups)
         set_duration(rg.get());
 
-      m->cluster->SetPreviousTimecode(min_cl_timecode - timecode_offset - 1, (int64_t)g_timecode_scale);
-      m->cluster->set_min_timecode(min_cl_timecode - timecode_offset);
-      m->cluster->set_max_timecode(max_cl_timecode - timecode_offset);
+      if (render_directly)
+        render_cluster_directly(min_cl_timecode - timecode_offset);
 
-      m->cluster->Render(*m->out, cues);
-      m->bytes_in_file += m->cluster->ElementSize();
+      else {
+        m->cluster->SetPreviousTimecode(min_cl_timecode - timecode_offset - 1, (int64_t)g_timecode_scale);
+        m->cluster->set_min_timecode(min_cl_timecode - timecode_offset);
+        m->cluster->set_max_timecode(max_cl_timecode - timecode_offset);
 
-      if (g_kax_sh_cues)
-        g_kax_sh_cues->IndexThis(*m->cluster, *g_kax_segment);
+        m->cluster->Render(*m->out, cues);
+        m->bytes_in_file += m->cluster->ElementSize();
 
-      m->previous_cluster_tc = m->cluster->GlobalTimecode();
+        if (g_kax_sh_cues)
+          g_kax_sh_cues->IndexThis(*m->cluster, *g_kax_segment);
 
-      cues_c::get().postprocess_cues(cues, *m->cluster);
+        m->previous_cluster_tc = m->cluster->GlobalTimecode();
+
+        cues_c::get().postprocess_cues(cues, *m->cluster);
+      }
 
     } else
       m->previous_cluster_tc = -1;
@@ -571,6 +613,61 @@ cluster_helper_c::render() {
   return 1;
 }
 
+// Clusters are encoded by cluster_writer_c unless they contain
+// something it cannot handle.
+bool
+cluster_helper_c::can_render_directly()
+  const {
+  if (hack_engaged(ENGAGE_NO_DIRECT_CLUSTER_WRITER))
+    return false;
+
+  for (auto const &pack : m->packets)
+    if (   pack->codec_state
+        || (0 < pack->ref_priority)
+        || pack->source->contains_gap()
+        || (0x80 <= pack->source->get_track_num()))
+      return false;
+
+  return true;
+}
+
+void
+cluster_helper_c::render_cluster_directly(uint64_t cluster_timecode) {
+  auto &writer = m->cluster_writer;
+
+  writer.render(*m->out, cluster_timecode);
+  m->bytes_in_file += writer.get_element_size();
+
+  auto cluster_position = g_kax_segment->GetRelativePosition(writer.get_position());
+
+  if (g_kax_sh_cues) {
+    // Same as KaxSeekHead::IndexThis() for the cluster.
+    auto &seek = AddNewChild<KaxSeek>(*g_kax_sh_cues);
+    GetChild<KaxSeekPosition>(seek).SetValue(cluster_position);
+
+    binary id[4];
+    EBML_ID(KaxCluster).Fill(id);
+    GetChild<KaxSeekID>(seek).CopyBuffer(id, EBML_ID_LENGTH(EBML_ID(KaxCluster)));
+  }
+
+  m->previous_cluster_tc = cluster_timecode;
+
+  // Cue points are created in the order of the blocks, just like
+  // KaxCluster::Render() does.
+  auto &cues           = cues_c::get();
+  auto timecode_scale  = static_cast<uint64_t>(g_timecode_scale);
+  auto block_positions = std::multimap<id_timecode_t, uint64_t>{};
+
+  for (auto const &block : writer.get_rendered_blocks()) {
+    block_positions.insert({ id_timecode_t{ block.m_track_num, block.m_timecode }, block.m_position });
+
+    if (block.m_add_to_cues)
+      cues.add(cue_point_t{ static_cast<uint64_t>((block.m_timecode / timecode_scale) * g_timecode_scale), 0, cluster_position, static_cast<uint32_t>(block.m_track_num), 0 });
+  }
+
+  cues.postprocess_cues(writer.get_data_start_position(), block_positions);
+}
+
 bool
 cluster_helper_c::add_to_cues_maybe(packet_cptr &pack) {
   auto &source  = *pack->source;
@@ -87,6 +87,7 @@ public:
 
 private:
   void set_duration(render_groups_c *rg);
+  void set_block_duration(render_groups_c &rg, uint64_t duration);
   bool must_duration_be_set(render_groups_c *rg, packet_cptr &new_packet);
 
   void render_before_adding_if_necessary(packet_cptr &packet);
@@ -97,6 +98,9 @@ private:
   void split(packet_cptr &packet);
 
   bool add_to_cues_maybe(packet_cptr &pack);
+
+  bool can_render_directly() const;
+  void render_cluster_directly(uint64_t cluster_timecode);
 };
 
 extern std::unique_ptr<cluster_helper_c> g_cluster_helper;
@@ -0,0 +1,501 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   serialization of clusters without libebml's element tree
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <ebml/EbmlElement.h>
+#include <matroska/KaxBlock.h>
+#include <matroska/KaxBlockData.h>
+#include <matroska/KaxCluster.h>
+#include <matroska/KaxClusterData.h>
+
+#include "common/endian.h"
+#include "merge/cluster_writer.h"
+
+using namespace libebml;
+
+void
+cluster_writer_c::reset(int64_t timecode_scale) {
+  m_timecode_scale = timecode_scale;
+  m_blocks.clear();
+  m_rendered_blocks.clear();
+}
+
+std::size_t
+cluster_writer_c::add_block(bool simple) {
+  m_blocks.emplace_back();
+  m_blocks.back().m_simple = simple;
+
+  return m_blocks.size() - 1;
+}
+
+bool
+cluster_writer_c::add_frame(std::size_t idx,
+                            uint64_t track_num,
+                            uint64_t timecode,
+                            memory_cptr const &frame,
+                            LacingType lacing,
+                            int64_t past_block,
+                            int64_t forw_block) {
+  auto &block = m_blocks[idx];
+
+  // KaxInternalBlock::AddFrame()
+  if (block.m_frames.empty()) {
+    block.m_timecode  = timecode;
+    block.m_track_num = track_num;
+    block.m_lacing    = lacing;
+  }
+
+  block.m_frames.push_back(frame);
+
+  auto more_frames_possible = (block.m_frames.size() < 8) && (LACING_NONE != lacing) && (frame->get_size() < 6 * 0xff);
+
+  if (block.m_simple) {
+    // kax_block_blob_c::add_frame_auto()
+    if ((-1 == past_block) && (-1 == forw_block)) {
+      block.m_key_frame   = true;
+      block.m_discardable = false;
+
+    } else {
+      block.m_key_frame   = false;
+      block.m_discardable = !(   ((-1 == forw_block) || (forw_block <= static_cast<int64_t>(timecode)))
+                              && ((-1 == past_block) || (past_block <= static_cast<int64_t>(timecode))));
+    }
+
+    return more_frames_possible;
+  }
+
+  // kax_block_group_c::add_frame()
+  auto past_ref = boost::optional<std::size_t>{};
+
+  if (0 <= past_block) {
+    if (block.m_references.empty()) {
+      block.m_references.push_back(0);
+      block.m_children.push_back(child_e::reference_block);
+    }
+
+    block.m_references[0] = past_block;
+    past_ref              = 0;
+  }
+
+  if (0 <= forw_block) {
+    auto first_ref = block.m_references.empty() ? boost::optional<std::size_t>{} : boost::optional<std::size_t>{0};
+
+    if (past_ref == first_ref) {
+      block.m_references.push_back(0);
+      block.m_children.push_back(child_e::reference_block);
+      block.m_references.back() = forw_block;
+
+    } else
+      block.m_references[0] = forw_block;
+  }
+
+  return more_frames_possible;
+}
+
+void
+cluster_writer_c::set_block_duration(std::size_t idx,
+                                     uint64_t duration) {
+  auto &block = m_blocks[idx];
+
+  if (block.m_simple)
+    return;
+
+  if (!brng::count(block.m_children, child_e::block_duration))
+    block.m_children.push_back(child_e::block_duration);
+
+  block.m_duration = duration / m_timecode_scale;
+}
+
+void
+cluster_writer_c::add_block_additions(std::size_t idx,
+                                      std::vector<memory_cptr> const &additions) {
+  auto &block = m_blocks[idx];
+
+  block.m_children.push_back(child_e::block_additions);
+  block.m_block_additions.push_back(additions);
+}
+
+void
+cluster_writer_c::set_discard_padding(std::size_t idx,
+                                      int64_t discard_padding) {
+  auto &block = m_blocks[idx];
+
+  if (!brng::count(block.m_children, child_e::discard_padding))
+    block.m_children.push_back(child_e::discard_padding);
+
+  block.m_discard_padding = discard_padding;
+}
+
+void
+cluster_writer_c::add_to_cues(std::size_t idx) {
+  m_blocks[idx].m_add_to_cues = true;
+}
+
+bool
+cluster_writer_c::empty()
+  const {
+  return m_blocks.empty();
+}
+
+LacingType
+cluster_writer_c::get_lacing_type(block_t const &block)
+  const {
+  if (block.m_frames.size() <= 1)
+    return LACING_NONE;
+
+  if (LACING_NONE == block.m_lacing)
+    return LACING_EBML;
+
+  if (LACING_AUTO != block.m_lacing)
+    return block.m_lacing;
+
+  // KaxInternalBlock::GetBestLacingType()
+  auto same_size        = true;
+  auto xiph_lacing_size = 1u;
+  auto ebml_lacing_size = 1u + CodedSizeLength(block.m_frames[0]->get_size(), 0);
+
+  for (auto idx = std::size_t{}, end = block.m_frames.size() - 1; idx < end; ++idx) {
+    if (block.m_frames[idx]->get_size() != block.m_frames[idx + 1]->get_size())
+      same_size = false;
+    xiph_lacing_size += block.m_frames[idx]->get_size() / 0xff + 1;
+  }
+
+  for (auto idx = std::size_t{1}, end = block.m_frames.size() - 1; idx < end; ++idx)
+    ebml_lacing_size += CodedSizeLengthSigned(static_cast<int64_t>(block.m_frames[idx]->get_size()) - static_cast<int64_t>(block.m_frames[idx - 1]->get_size()), 0);
+
+  return same_size                           ? LACING_FIXED
+       : xiph_lacing_size < ebml_lacing_size ? LACING_XIPH
+       :                                       LACING_EBML;
+}
+
+uint64_t
+cluster_writer_c::get_block_data_size(block_t const &block)
+  const {
+  auto size = boost::accumulate(block.m_frames, uint64_t{4}, [](uint64_t sum, memory_cptr const &frame) { return sum + frame->get_size(); });
+  if (block.m_frames.size() == 1)
+    return size;
+
+  auto lacing = get_lacing_type(block);
+  ++size;
+
+  if (LACING_XIPH == lacing)
+    for (auto idx = std::size_t{}, end = block.m_frames.size() - 1; idx < end; ++idx)
+      size += block.m_frames[idx]->get_size() / 0xff + 1;
+
+  else if (LACING_EBML == lacing) {
+    size += CodedSizeLength(block.m_frames[0]->get_size(), 0);
+    for (auto idx = std::size_t{1}, end = block.m_frames.size() - 1; idx < end; ++idx)
+      size += CodedSizeLengthSigned(static_cast<int64_t>(block.m_frames[idx]->get_size()) - static_cast<int64_t>(block.m_frames[idx - 1]->get_size()), 0);
+  }
+
+  return size;
+}
+
+int64_t
+cluster_writer_c::get_reference_value(block_t const &block,
+                                      int64_t reference)
+  const {
+  return (reference - static_cast<int64_t>(block.m_timecode)) / m_timecode_scale;
+}
+
+uint64_t
+cluster_writer_c::get_block_additions_size(std::vector<memory_cptr> const &additions)
+  const {
+  auto size = uint64_t{};
+
+  for (auto idx = 0u; idx < additions.size(); ++idx) {
+    // A BlockAddID of 1 is the default value and therefore omitted.
+    auto more_size = get_element_size(EBML_ID(KaxBlockAdditional), additions[idx]->get_size());
+    if (idx)
+      more_size   += get_element_size(EBML_ID(KaxBlockAddID), get_uint_size(idx + 1));
+
+    size += get_element_size(EBML_ID(KaxBlockMore), more_size);
+  }
+
+  return size;
+}
+
+uint64_t
+cluster_writer_c::get_block_group_size(block_t const &block)
+  const {
+  auto size                = get_element_size(EBML_ID(KaxBlock), get_block_data_size(block));
+  auto reference_idx       = 0u;
+  auto block_additions_idx = 0u;
+
+  for (auto child : block.m_children) {
+    if (child_e::reference_block == child)
+      size += get_element_size(EBML_ID(KaxReferenceBlock), get_sint_size(get_reference_value(block, block.m_references[reference_idx++])));
+
+    else if (child_e::block_additions == child)
+      size += get_element_size(EBML_ID(KaxBlockAdditions), get_block_additions_size(block.m_block_additions[block_additions_idx++]));
+
+    else if (child_e::discard_padding == child)
+      size += get_element_size(EBML_ID(KaxDiscardPadding), get_sint_size(block.m_discard_padding));
+
+    else
+      size += get_element_size(EBML_ID(KaxBlockDuration), get_uint_size(block.m_duration));
+  }
+
+  return size;
+}
+
+unsigned char *
+cluster_writer_c::write_block_data(unsigned char *dest,
+                                   block_t const &block)
+  const {
+  // KaxInternalBlock::RenderData()
+  auto lacing         = get_lacing_type(block);
+  auto local_timecode = static_cast<int16_t>((static_cast<int64_t>(block.m_timecode) - static_cast<int64_t>(m_cluster_timecode)) / m_timecode_scale);
+  auto flags          = static_cast<unsigned char>(0);
+
+  if (block.m_simple) {
+    if (block.m_key_frame)
+      flags |= 0x80;
+    if (block.m_discardable)
+      flags |= 0x01;
+  }
+
+  flags |= LACING_XIPH  == lacing ? 0x02
+         : LACING_EBML  == lacing ? 0x06
+         : LACING_FIXED == lacing ? 0x04
+         :                          0x00;
+
+  *dest++ = block.m_track_num | 0x80;
+  put_uint16_be(dest, static_cast<uint16_t>(local_timecode));
+  dest   += 2;
+  *dest++ = flags;
+
+  if (LACING_NONE != lacing)
+    *dest++ = block.m_frames.size() - 1;
+
+  if (LACING_XIPH == lacing) {
+    for (auto idx = std::size_t{}, end = block.m_frames.size() - 1; idx < end; ++idx) {
+      auto size = block.m_frames[idx]->get_size();
+      for (; size >= 0xff; size -= 0xff)
+        *dest++ = 0xff;
+      *dest++ = size;
+    }
+
+  } else if (LACING_EBML == lacing) {
+    auto size       = block.m_frames[0]->get_size();
+    auto coded_size = CodedSizeLength(size, 0);
+    CodedValueLength(size, coded_size, dest);
+    dest           += coded_size;
+
+    for (auto idx = std::size_t{1}, end = block.m_frames.size() - 1; idx < end; ++idx) {
+      auto difference = static_cast<int64_t>(block.m_frames[idx]->get_size()) - static_cast<int64_t>(block.m_frames[idx - 1]->get_size());
+      coded_size      = CodedSizeLengthSigned(difference, 0);
+      CodedValueLengthSigned(difference, coded_size, dest);
+      dest           += coded_size;
+    }
+  }
+
+  for (auto const &frame : block.m_frames) {
+    std::memcpy(dest, frame->get_buffer(), frame->get_size());
+    dest += frame->get_size();
+  }
+
+  return dest;
+}
+
+unsigned char *
+cluster_writer_c::write_block_additions(unsigned char *dest,
+                                        std::vector<memory_cptr> const &additions)
+  const {
+  dest = write_head(dest, EBML_ID(KaxBlockAdditions), get_block_additions_size(additions));
+
+  for (auto idx = 0u; idx < additions.size(); ++idx) {
+    auto more_size = get_element_size(EBML_ID(KaxBlockAdditional), additions[idx]->get_size());
+    if (idx)
+      more_size   += get_element_size(EBML_ID(KaxBlockAddID), get_uint_size(idx + 1));
+
+    dest = write_head(dest, EBML_ID(KaxBlockMore), more_size);
+    if (idx)
+      dest = write_uint(dest, EBML_ID(KaxBlockAddID), idx + 1);
+    dest = write_binary(dest, EBML_ID(KaxBlockAdditional), *additions[idx]);
+  }
+
+  return dest;
+}
+
+unsigned char *
+cluster_writer_c::write_block_group(unsigned char *dest,
+                                    block_t const &block)
+  const {
+  dest = write_head(dest, EBML_ID(KaxBlockGroup), get_block_group_size(block));
+  dest = write_head(dest, EBML_ID(KaxBlock),      get_block_data_size(block));
+  dest = write_block_data(dest, block);
+
+  auto reference_idx       = 0u;
+  auto block_additions_idx = 0u;
+
+  for (auto child : block.m_children) {
+    if (child_e::reference_block == child)
+      dest = write_sint(dest, EBML_ID(KaxReferenceBlock), get_reference_value(block, block.m_references[reference_idx++]));
+
+    else if (child_e::block_additions == child)
+      dest = write_block_additions(dest, block.m_block_additions[block_additions_idx++]);
+
+    else if (child_e::discard_padding == child)
+      dest = write_sint(dest, EBML_ID(KaxDiscardPadding), block.m_discard_padding);
+
+    else
+      dest = write_uint(dest, EBML_ID(KaxBlockDuration), block.m_duration);
+  }
+
+  return dest;
+}
+
+void
+cluster_writer_c::render(mm_io_c &out,
+                         uint64_t cluster_timecode) {
+  m_cluster_timecode = cluster_timecode;
+
+  auto timecode     = m_cluster_timecode / m_timecode_scale;
+  auto content_size = get_element_size(EBML_ID(KaxClusterTimecode), get_uint_size(timecode));
+  auto block_sizes  = std::vector<uint64_t>{};
+
+  block_sizes.reserve(m_blocks.size());
+
+  for (auto const &block : m_blocks) {
+    block_sizes.push_back(block.m_simple ? get_element_size(EBML_ID(KaxSimpleBlock), get_block_data_size(block))
+                          :                get_element_size(EBML_ID(KaxBlockGroup),  get_block_group_size(block)));
+    content_size += block_sizes.back();
+  }
+
+  m_position  = out.getFilePointer();
+  m_size      = get_element_size(EBML_ID(KaxCluster), content_size);
+  m_head_size = m_size - content_size;
+
+  m_buffer.resize(m_size);
+
+  auto start = m_buffer.data();
+  auto dest  = write_head(start, EBML_ID(KaxCluster), content_size);
+  dest       = write_uint(dest, EBML_ID(KaxClusterTimecode), timecode);
+
+  m_rendered_blocks.clear();
+  m_rendered_blocks.reserve(m_blocks.size());
+
+  for (auto idx = 0u; idx < m_blocks.size(); ++idx) {
+    auto const &block = m_blocks[idx];
+
+    m_rendered_blocks.push_back({ block.m_track_num, block.m_timecode, m_position + (dest - start), block.m_add_to_cues });
+
+    if (block.m_simple) {
+      dest = write_head(dest, EBML_ID(KaxSimpleBlock), get_block_data_size(block));
+      dest = write_block_data(dest, block);
+
+    } else
+      dest = write_block_group(dest, block);
+  }
+
+  assert(static_cast<uint64_t>(dest - start) == m_size);
+
+  out.write(start, m_size);
+
+  m_blocks.clear();
+}
+
+uint64_t
+cluster_writer_c::get_position()
+  const {
+  return m_position;
+}
+
+uint64_t
+cluster_writer_c::get_data_start_position()
+  const {
+  return m_position + m_head_size;
+}
+
+uint64_t
+cluster_writer_c::get_element_size()
+  const {
+  return m_size;
+}
+
+std::vector<cluster_writer_c::rendered_block_t> const &
+cluster_writer_c::get_rendered_blocks()
+  const {
+  return m_rendered_blocks;
+}
+
+uint64_t
+cluster_writer_c::get_element_size(EbmlId const &id,
+                                   uint64_t content_size) {
+  return EBML_ID_LENGTH(id) + CodedSizeLength(content_size, 0) + content_size;
+}
+
+unsigned int
+cluster_writer_c::get_uint_size(uint64_t value) {
+  auto size = 1u;
+  while ((size < 8) && (value >> (size * 8)))
+    ++size;
+
+  return size;
+}
+
+unsigned int
+cluster_writer_c::get_sint_size(int64_t value) {
+  auto size = 1u;
+  while ((size < 8) && ((value < -(1ll << (size * 8 - 1))) || (value >= (1ll << (size * 8 - 1)))))
+    ++size;
+
+  return size;
+}
+
+unsigned char *
+cluster_writer_c::write_head(unsigned char *dest,
+                             EbmlId const &id,
+                             uint64_t content_size) {
+  auto coded_size = CodedSizeLength(content_size, 0);
+
+  id.Fill(dest);
+  dest += EBML_ID_LENGTH(id);
+  CodedValueLength(content_size, coded_size, dest);
+
+  return dest + coded_size;
+}
+
+unsigned char *
+cluster_writer_c::write_uint(unsigned char *dest,
+                             EbmlId const &id,
+                             uint64_t value) {
+  auto size = get_uint_size(value);
+  dest      = write_head(dest, id, size);
+  put_uint_be(dest, value, size);
+
+  return dest + size;
+}
+
+unsigned char *
+cluster_writer_c::write_sint(unsigned char *dest,
+                             EbmlId const &id,
+                             int64_t value) {
+  auto size = get_sint_size(value);
+  dest      = write_head(dest, id, size);
+  put_uint_be(dest, static_cast<uint64_t>(value), size);
+
+  return dest + size;
+}
+
+unsigned char *
+cluster_writer_c::write_binary(unsigned char *dest,
+                               EbmlId const &id,
+                               memory_c const &data) {
+  dest = write_head(dest, id, data.get_size());
+  std::memcpy(dest, data.get_buffer(), data.get_size());
+
+  return dest + data.get_size();
+}
@@ -0,0 +1,126 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   serialization of clusters without libebml's element tree
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_CLUSTER_WRITER_H
+#define MTX_MERGE_CLUSTER_WRITER_H
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxBlock.h>
+
+#include "common/mm_io.h"
+
+using namespace libmatroska;
+
+/* Encodes SimpleBlocks and BlockGroups directly into one buffer per
+   cluster instead of building a KaxCluster with KaxBlockBlob,
+   KaxBlockGroup and DataBuffer objects and rendering that.
+
+   The interface mirrors the operations cluster_helper_c performs on
+   kax_block_blob_c objects, and the output is byte-identical to what
+   libmatroska renders for the same sequence of operations. This
+   includes the choice of the lacing type, the order of a BlockGroup's
+   children (which depends on the order in which they're added), and
+   omitting elements whose value equals their default value.
+
+   Not supported: CodecState, ReferencePriority, SilentTracks and track
+   numbers of 128 and above. Clusters containing those must be rendered
+   via libmatroska. */
+class cluster_writer_c {
+public:
+  struct rendered_block_t {
+    uint64_t m_track_num, m_timecode, m_position;
+    bool m_add_to_cues;
+  };
+
+protected:
+  enum class child_e {
+    reference_block,
+    block_additions,
+    discard_padding,
+    block_duration,
+  };
+
+  struct block_t {
+    bool m_simple{}, m_key_frame{}, m_discardable{}, m_add_to_cues{};
+    uint64_t m_track_num{}, m_timecode{};
+    LacingType m_lacing{LACING_NONE};
+    std::vector<memory_cptr> m_frames;
+
+    // BlockGroups only
+    std::vector<child_e> m_children;
+    std::vector<int64_t> m_references;
+    std::vector<std::vector<memory_cptr>> m_block_additions;
+    int64_t m_discard_padding{};
+    uint64_t m_duration{};
+  };
+
+  std::vector<block_t> m_blocks;
+  std::vector<unsigned char> m_buffer;
+  std::vector<rendered_block_t> m_rendered_blocks;
+  int64_t m_timecode_scale{1000000};
+  uint64_t m_cluster_timecode{}, m_position{}, m_size{}, m_head_size{};
+
+public:
+  void reset(int64_t timecode_scale);
+
+  // Equivalent of creating a new kax_block_blob_c of type
+  // BLOCK_BLOB_ALWAYS_SIMPLE ('simple' == true) or BLOCK_BLOB_NO_SIMPLE.
+  // Returns the new block's index.
+  std::size_t add_block(bool simple);
+
+  // Equivalent of kax_block_blob_c::add_frame_auto(). Returns whether
+  // or not more frames can be laced into the same block.
+  bool add_frame(std::size_t idx, uint64_t track_num, uint64_t timecode, memory_cptr const &frame, LacingType lacing, int64_t past_block, int64_t forw_block);
+
+  // Equivalent of kax_block_blob_c::set_block_duration(). No-op for
+  // SimpleBlocks.
+  void set_block_duration(std::size_t idx, uint64_t duration);
+  void add_block_additions(std::size_t idx, std::vector<memory_cptr> const &additions);
+  void set_discard_padding(std::size_t idx, int64_t discard_padding);
+  void add_to_cues(std::size_t idx);
+
+  bool empty() const;
+
+  // Writes the cluster with the given global timecode in nanoseconds
+  // to 'out'. Afterwards the blocks are cleared, and the positions of
+  // the blocks can be retrieved.
+  void render(mm_io_c &out, uint64_t cluster_timecode);
+
+  uint64_t get_position() const;
+  uint64_t get_data_start_position() const;
+  uint64_t get_element_size() const;
+  std::vector<rendered_block_t> const &get_rendered_blocks() const;
+
+protected:
+  LacingType get_lacing_type(block_t const &block) const;
+  uint64_t get_block_data_size(block_t const &block) const;
+  uint64_t get_block_additions_size(std::vector<memory_cptr> const &additions) const;
+  uint64_t get_block_group_size(block_t const &block) const;
+  int64_t get_reference_value(block_t const &block, int64_t reference) const;
+
+  unsigned char *write_block_data(unsigned char *dest, block_t const &block) const;
+  unsigned char *write_block_additions(unsigned char *dest, std::vector<memory_cptr> const &additions) const;
+  unsigned char *write_block_group(unsigned char *dest, block_t const &block) const;
+
+  static uint64_t get_element_size(EbmlId const &id, uint64_t content_size);
+  static unsigned int get_uint_size(uint64_t value);
+  static unsigned int get_sint_size(int64_t value);
+
+  static unsigned char *write_head(unsigned char *dest, EbmlId const &id, uint64_t content_size);
+  static unsigned char *write_uint(unsigned char *dest, EbmlId const &id, uint64_t value);
+  static unsigned char *write_sint(unsigned char *dest, EbmlId const &id, int64_t value);
+  static unsigned char *write_binary(unsigned char *dest, EbmlId const &id, memory_c const &data);
+};
+
+#endif // MTX_MERGE_CLUSTER_WRITER_H
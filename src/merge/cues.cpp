@@ -13,6 +13,8 @@
 
 #include "common/common_pch.h"
 
+#include <numeric>
+
 #include "common/debugging.h"
 #include "common/ebml.h"
 #include "common/fs_sys_helpers.h"
@@ -32,6 +34,7 @@ cues_c::cues_c()
   , m_no_cue_relative_position{hack_engaged(ENGAGE_NO_CUE_RELATIVE_POSITION)}
   , m_debug_cue_duration{         "cues|cues_cue_duration"}
   , m_debug_cue_relative_position{"cues|cues_cue_relative_position"}
+  , m_debug_memory{               "cues|cues_memory"}
 {
 }
 
@@ -40,7 +43,7 @@ cues_c::set_duration_for_id_timecode(uint64_t id,
                                      uint64_t timecode,
                                      uint64_t duration) {
   if (!m_no_cue_duration)
-    m_id_timecode_duration_multimap.insert({ id_timecode_t{id, timecode}, duration });
+    m_durations.push_back({ id, timecode, duration });
 }
 
 void
@@ -64,22 +67,103 @@ cues_c::add(KaxCuePoint &point) {
     uint64_t track_num = FindChildValue<KaxCueTrack>(*positions);
     assert(track_num <= static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()));
 
-    m_points.push_back({ timecode, 0, FindChildValue<KaxCueClusterPosition>(*positions), static_cast<uint32_t>(track_num), 0 });
+    add(cue_point_t{ timecode, 0, FindChildValue<KaxCueClusterPosition>(*positions), static_cast<uint32_t>(track_num), 0 });
 
     uint64_t codec_state_position = FindChildValue<KaxCueCodecState>(*positions);
     if (codec_state_position)
-      m_codec_state_position_map[ id_timecode_t{ track_num, timecode } ] = codec_state_position;
+      set_sparse_value(m_codec_state_positions, get_num_points() - 1, codec_state_position);
+  }
+}
+
+void
+cues_c::add(cue_point_t const &point) {
+  assert(get_num_points() < static_cast<std::size_t>(std::numeric_limits<uint32_t>::max()));
+
+  auto timecode = static_cast<int64_t>(point.timecode / g_timecode_scale);
+
+  if (   m_clusters.empty()
+      || (m_clusters.back().position != point.cluster_position)
+      || ((timecode - static_cast<int64_t>(m_clusters.back().timecode)) < std::numeric_limits<int32_t>::min())
+      || ((timecode - static_cast<int64_t>(m_clusters.back().timecode)) > std::numeric_limits<int32_t>::max()))
+    m_clusters.push_back({ point.cluster_position, static_cast<uint64_t>(timecode) });
+
+  m_cluster_indexes.push_back(m_clusters.size() - 1);
+  m_timecode_deltas.push_back(static_cast<int32_t>(timecode - static_cast<int64_t>(m_clusters.back().timecode)));
+  m_track_nums.push_back(point.track_num);
+  m_relative_positions.push_back(point.relative_position);
+
+  if (point.duration)
+    set_sparse_value(m_point_durations, get_num_points() - 1, point.duration);
+}
+
+std::size_t
+cues_c::get_num_points()
+  const {
+  return m_track_nums.size();
+}
+
+uint64_t
+cues_c::get_timecode(std::size_t idx)
+  const {
+  return (m_clusters[m_cluster_indexes[idx]].timecode + m_timecode_deltas[idx]) * g_timecode_scale;
+}
+
+uint64_t
+cues_c::get_cluster_position(std::size_t idx)
+  const {
+  return m_clusters[m_cluster_indexes[idx]].position;
+}
+
+uint64_t
+cues_c::get_sparse_value(std::vector<std::pair<uint32_t, uint64_t>> const &column,
+                         std::size_t idx)
+  const {
+  auto itr = std::lower_bound(column.begin(), column.end(), idx, [](std::pair<uint32_t, uint64_t> const &element, std::size_t wanted_idx) { return element.first < wanted_idx; });
+  return (itr != column.end()) && (itr->first == idx) ? itr->second : 0;
+}
+
+// Values are usually set in the order of the point indexes, so they
+// can simply be appended.
+void
+cues_c::set_sparse_value(std::vector<std::pair<uint32_t, uint64_t>> &column,
+                         std::size_t idx,
+                         uint64_t value) {
+  if (column.empty() || (column.back().first < idx)) {
+    column.emplace_back(idx, value);
+    return;
   }
+
+  auto itr = std::lower_bound(column.begin(), column.end(), idx, [](std::pair<uint32_t, uint64_t> const &element, std::size_t wanted_idx) { return element.first < wanted_idx; });
+  if ((itr != column.end()) && (itr->first == idx))
+    itr->second = value;
+  else
+    column.emplace(itr, idx, value);
+}
+
+std::size_t
+cues_c::get_memory_usage()
+  const {
+  return m_clusters.capacity()              * sizeof(cluster_t)
+       + m_cluster_indexes.capacity()       * sizeof(uint32_t)
+       + m_track_nums.capacity()            * sizeof(uint32_t)
+       + m_relative_positions.capacity()    * sizeof(uint32_t)
+       + m_timecode_deltas.capacity()       * sizeof(int32_t)
+       + m_point_durations.capacity()       * sizeof(std::pair<uint32_t, uint64_t>)
+       + m_codec_state_positions.capacity() * sizeof(std::pair<uint32_t, uint64_t>)
+       + m_durations.capacity()             * sizeof(cue_duration_t);
 }
 
 void
 cues_c::write(mm_io_c &out,
               KaxSeekHead &seek_head) {
-  if (!m_points.size() || !g_cue_writing_requested)
+  if (!get_num_points() || !g_cue_writing_requested)
     return;
 
+  mxdebug_if(m_debug_memory, boost::format("cues_c::write: %1% points in %2% cluster entries, %3% durations, %4% codec states; %5% bytes of memory used\n")
+             % get_num_points() % m_clusters.size() % m_point_durations.size() % m_codec_state_positions.size() % get_memory_usage());
+
   // auto start = mtx::sys::get_current_time_millis();
-  sort();
+  auto order = sort();
   // auto end_sort = mtx::sys::get_current_time_millis();
 
   // Need to write the (empty) cues element so that its position will
@@ -100,49 +184,68 @@ cues_c::write(mm_io_c &out,
   auto total_size = calculate_total_size();
   write_ebml_element_head(out, EBML_ID(KaxCues), total_size);
 
-  for (auto &point : m_points) {
+  for (auto idx : order) {
     KaxCuePoint kc_point;
 
-    GetChild<KaxCueTime>(kc_point).SetValue(point.timecode / g_timecode_scale);
+    GetChild<KaxCueTime>(kc_point).SetValue(get_timecode(idx) / g_timecode_scale);
 
     auto &positions = GetChild<KaxCueTrackPositions>(kc_point);
-    GetChild<KaxCueTrack>(positions).SetValue(point.track_num);
-    GetChild<KaxCueClusterPosition>(positions).SetValue(point.cluster_position);
+    GetChild<KaxCueTrack>(positions).SetValue(m_track_nums[idx]);
+    GetChild<KaxCueClusterPosition>(positions).SetValue(get_cluster_position(idx));
 
-    auto codec_state_position = m_codec_state_position_map.find({ point.track_num, point.timecode });
-    if (codec_state_position != m_codec_state_position_map.end())
-      GetChild<KaxCueCodecState>(positions).SetValue(codec_state_position->second);
+    auto codec_state_position = get_sparse_value(m_codec_state_positions, idx);
+    if (codec_state_position)
+      GetChild<KaxCueCodecState>(positions).SetValue(codec_state_position);
 
-    if (point.relative_position)
-      GetChild<KaxCueRelativePosition>(positions).SetValue(point.relative_position);
+    if (m_relative_positions[idx])
+      GetChild<KaxCueRelativePosition>(positions).SetValue(m_relative_positions[idx]);
 
-    if (point.duration)
-      GetChild<KaxCueDuration>(positions).SetValue(RND_TIMECODE_SCALE(point.duration) / g_timecode_scale);
+    auto duration = get_sparse_value(m_point_durations, idx);
+    if (duration)
+      GetChild<KaxCueDuration>(positions).SetValue(RND_TIMECODE_SCALE(duration) / g_timecode_scale);
 
     kc_point.Render(out);
   }
 
-  m_points.clear();
-  m_codec_state_position_map.clear();
-  m_num_cue_points_postprocessed = 0;
+  clear();
 
   // auto end_all = mtx::sys::get_current_time_millis();
   // mxinfo(boost::format("dur sort %1% write %2% total %3%\n") % (end_sort - start) % (end_all - end_sort) % (end_all - start));
 }
 
-void
-cues_c::sort() {
-  brng::sort(m_points, [](cue_point_t const &a, cue_point_t const &b) -> bool {
-      if (a.timecode < b.timecode)
-        return true;
-      if (a.timecode > b.timecode)
-        return false;
+// Returns the indexes of the points sorted by their timecodes and
+// track numbers. The points themselves aren't moved.
+std::vector<uint32_t>
+cues_c::sort()
+  const {
+  std::vector<uint32_t> order(get_num_points());
+  std::iota(order.begin(), order.end(), 0);
 
-      if (a.track_num < b.track_num)
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) -> bool {
+      auto a_timecode = get_timecode(a);
+      auto b_timecode = get_timecode(b);
+
+      if (a_timecode < b_timecode)
         return true;
+      if (a_timecode > b_timecode)
+        return false;
 
-      return false;
+      return m_track_nums[a] < m_track_nums[b];
     });
+
+  return order;
+}
+
+void
+cues_c::clear() {
+  m_clusters.clear();
+  m_cluster_indexes.clear();
+  m_track_nums.clear();
+  m_relative_positions.clear();
+  m_timecode_deltas.clear();
+  m_point_durations.clear();
+  m_codec_state_positions.clear();
+  m_num_cue_points_postprocessed = 0;
 }
 
 std::multimap<id_timecode_t, uint64_t>
@@ -182,19 +285,37 @@ cues_c::postprocess_cues(KaxCues &cues,
   if (m_no_cue_duration && m_no_cue_relative_position)
     return;
 
-  auto cluster_data_start_pos = cluster.GetElementPosition() + cluster.HeadSize();
-  auto block_positions        = calculate_block_positions(cluster);
+  postprocess_cues(cluster.GetElementPosition() + cluster.HeadSize(), calculate_block_positions(cluster));
+}
+
+void
+cues_c::postprocess_cues(uint64_t cluster_data_start_pos,
+                         std::multimap<id_timecode_t, uint64_t> const &block_positions) {
+  if (m_no_cue_duration && m_no_cue_relative_position)
+    return;
+
   std::map<id_timecode_t, size_t> nblocks_processed; //# blocks processed so far with given track #/timecode
 
-  for (auto point = m_points.begin() + m_num_cue_points_postprocessed, end = m_points.end(); point != end; ++point) {
-    nblocks_processed[id_timecode_t{ point->track_num, point->timecode }]++;
+  // Sorting keeps the order of the durations for the same track
+  // number & timecode, just like a multimap does.
+  auto by_id_timecode = [](cue_duration_t const &a, cue_duration_t const &b) -> bool {
+    return (a.track_num < b.track_num) || ((a.track_num == b.track_num) && (a.timecode < b.timecode));
+  };
+
+  if (!m_no_cue_duration)
+    std::stable_sort(m_durations.begin(), m_durations.end(), by_id_timecode);
+
+  for (auto idx = m_num_cue_points_postprocessed, num_points = get_num_points(); idx < num_points; ++idx) {
+    auto id_timecode = id_timecode_t{ m_track_nums[idx], get_timecode(idx) };
+
+    nblocks_processed[id_timecode]++;
 
     // Set CueRelativePosition for all cues.
     if (!m_no_cue_relative_position) {
-      auto pair          = block_positions.equal_range({ point->track_num, point->timecode });
+      auto pair          = block_positions.equal_range(id_timecode);
       auto position_itr  = pair.first;
       auto pos_end       = pair.second;
-      auto num_processed = nblocks_processed[id_timecode_t{ point->track_num, point->timecode }];
+      auto num_processed = nblocks_processed[id_timecode];
 
       for (auto i = 0u; ((i + 1) < num_processed) && (position_itr != pos_end); ++i)
         position_itr++;
@@ -203,47 +324,52 @@ cues_c::postprocess_cues(KaxCues &cues,
 
       assert(relative_position <= static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()));
 
-      point->relative_position = relative_position;
+      m_relative_positions[idx] = relative_position;
 
       mxdebug_if(m_debug_cue_relative_position,
                  boost::format("cue_relative_position: looking for <%1%:%2%>: cluster_data_start_pos %3% position %4%\n")
-                 % point->track_num % point->timecode % cluster_data_start_pos % relative_position);
+                 % id_timecode.first % id_timecode.second % cluster_data_start_pos % relative_position);
     }
 
     // Set CueDuration if the packetizer wants them.
     if (m_no_cue_duration)
       continue;
 
-    auto pair          = m_id_timecode_duration_multimap.equal_range({ point->track_num, point->timecode });
+    auto pair          = std::equal_range(m_durations.begin(), m_durations.end(), cue_duration_t{ id_timecode.first, id_timecode.second, 0 }, by_id_timecode);
     auto duration_itr  = pair.first;
     auto dur_end       = pair.second;
-    auto num_processed = nblocks_processed[id_timecode_t{ point->track_num, point->timecode }];
+    auto num_processed = nblocks_processed[id_timecode];
 
     for (auto i = 0u; ((i + 1) < num_processed) && (duration_itr != dur_end); ++i)
       duration_itr++;
 
-    auto ptzr         = g_packetizers_by_track_num[point->track_num];
+    auto ptzr         = g_packetizers_by_track_num[id_timecode.first];
 
     if (!ptzr || !ptzr->wants_cue_duration())
       continue;
 
-    if (m_id_timecode_duration_multimap.end() != duration_itr)
-      point->duration = duration_itr->second;
+    if ((m_durations.end() != duration_itr) && duration_itr->duration)
+      set_sparse_value(m_point_durations, idx, duration_itr->duration);
 
     mxdebug_if(m_debug_cue_duration,
                boost::format("cue_duration: looking for <%1%:%2%>: %3%\n")
-               % point->track_num % point->timecode % (duration_itr == m_id_timecode_duration_multimap.end() ? static_cast<int64_t>(-1) : duration_itr->second));
+               % id_timecode.first % id_timecode.second % (duration_itr == m_durations.end() ? static_cast<int64_t>(-1) : static_cast<int64_t>(duration_itr->duration)));
   }
 
-  m_num_cue_points_postprocessed = m_points.size();
+  m_num_cue_points_postprocessed = get_num_points();
 
-  m_id_timecode_duration_multimap.clear();
+  m_durations.clear();
 }
 
 uint64_t
 cues_c::calculate_total_size()
   const {
-  return boost::accumulate(m_points, 0ull, [this](uint64_t sum, cue_point_t const &point) { return sum + calculate_point_size(point); });
+  uint64_t total_size = 0;
+
+  for (auto idx = 0u, num_points = get_num_points(); idx < num_points; ++idx)
+    total_size += calculate_point_size(idx);
+
+  return total_size;
 }
 
 uint64_t
@@ -256,23 +382,24 @@ cues_c::calculate_bytes_for_uint(uint64_t value)
 }
 
 uint64_t
-cues_c::calculate_point_size(cue_point_t const &point)
+cues_c::calculate_point_size(std::size_t idx)
   const {
   uint64_t point_size = EBML_ID_LENGTH(EBML_ID(KaxCuePoint))           + 1
-                      + EBML_ID_LENGTH(EBML_ID(KaxCuePoint))           + 1 + calculate_bytes_for_uint(point.timecode / g_timecode_scale)
+                      + EBML_ID_LENGTH(EBML_ID(KaxCuePoint))           + 1 + calculate_bytes_for_uint(get_timecode(idx) / g_timecode_scale)
                       + EBML_ID_LENGTH(EBML_ID(KaxCueTrackPositions))  + 1
-                      + EBML_ID_LENGTH(EBML_ID(KaxCueTrack))           + 1 + calculate_bytes_for_uint(point.track_num)
-                      + EBML_ID_LENGTH(EBML_ID(KaxCueClusterPosition)) + 1 + calculate_bytes_for_uint(point.cluster_position);
+                      + EBML_ID_LENGTH(EBML_ID(KaxCueTrack))           + 1 + calculate_bytes_for_uint(m_track_nums[idx])
+                      + EBML_ID_LENGTH(EBML_ID(KaxCueClusterPosition)) + 1 + calculate_bytes_for_uint(get_cluster_position(idx));
 
-  auto codec_state_position = m_codec_state_position_map.find({ point.track_num, point.timecode });
-  if (codec_state_position != m_codec_state_position_map.end())
-    point_size += EBML_ID_LENGTH(EBML_ID(KaxCueCodecState)) + 1 + calculate_bytes_for_uint(codec_state_position->second);
+  auto codec_state_position = get_sparse_value(m_codec_state_positions, idx);
+  if (codec_state_position)
+    point_size += EBML_ID_LENGTH(EBML_ID(KaxCueCodecState)) + 1 + calculate_bytes_for_uint(codec_state_position);
 
-  if (point.relative_position)
-    point_size += EBML_ID_LENGTH(EBML_ID(KaxCueRelativePosition)) + 1 + calculate_bytes_for_uint(point.relative_position);
+  if (m_relative_positions[idx])
+    point_size += EBML_ID_LENGTH(EBML_ID(KaxCueRelativePosition)) + 1 + calculate_bytes_for_uint(m_relative_positions[idx]);
 
-  if (point.duration)
-    point_size += EBML_ID_LENGTH(EBML_ID(KaxCueDuration)) + 1 + calculate_bytes_for_uint(RND_TIMECODE_SCALE(point.duration) / g_timecode_scale);
+  auto duration = get_sparse_value(m_point_durations, idx);
+  if (duration)
+    point_size += EBML_ID_LENGTH(EBML_ID(KaxCueDuration)) + 1 + calculate_bytes_for_uint(RND_TIMECODE_SCALE(duration) / g_timecode_scale);
 
   return point_size;
 }
@@ -282,18 +409,18 @@ cues_c::adjust_positions(uint64_t old_position,
                          uint64_t delta) {
   auto s_debug_rerender_track_headers = debugging_option_c{"rerender|rerender_track_headers"};
 
-  if (!delta || (m_points.empty() && m_codec_state_position_map.empty()))
+  if (!delta || m_clusters.empty())
     return;
 
   mxdebug_if(s_debug_rerender_track_headers,
              boost::format("[rerender] cues_c::adjust_positions: old_position %1% delta %2% num_points %3% first point's position %4%\n")
-             % old_position % delta % m_points.size() % (!m_points.empty() ? m_points[0].cluster_position : 0));
+             % old_position % delta % get_num_points() % m_clusters[0].position);
 
-  for (auto &point : m_points)
-    if (point.cluster_position >= old_position)
-      point.cluster_position += delta;
+  for (auto &cluster : m_clusters)
+    if (cluster.position >= old_position)
+      cluster.position += delta;
 
-  for (auto &element : m_codec_state_position_map)
+  for (auto &element : m_codec_state_positions)
     if (element.second >= old_position)
       element.second += delta;
 }
@@ -29,18 +29,37 @@ struct cue_point_t {
   uint32_t track_num, relative_position;
 };
 
+struct cue_duration_t {
+  uint64_t track_num, timecode, duration;
+};
+
 class cues_c;
 using cues_cptr = std::shared_ptr<cues_c>;
 
 class cues_c {
 protected:
-  std::vector<cue_point_t> m_points;
-  std::multimap<id_timecode_t, uint64_t> m_id_timecode_duration_multimap;
-  std::map<id_timecode_t, uint64_t> m_codec_state_position_map;
+  // Cue points are added cluster by cluster, and all points of a
+  // cluster share the cluster's position. Therefore each point only
+  // stores the index of its cluster entry and its timecode relative to
+  // that entry's timecode. Timecodes are stored in units of the
+  // timecode scale.
+  struct cluster_t {
+    uint64_t position, timecode;
+  };
+
+  std::vector<cluster_t> m_clusters;
+  std::vector<uint32_t> m_cluster_indexes, m_track_nums, m_relative_positions;
+  std::vector<int32_t> m_timecode_deltas;
+
+  // Only few points have a duration or a codec state. These columns
+  // contain pairs of point index & value sorted by the index.
+  std::vector<std::pair<uint32_t, uint64_t>> m_point_durations, m_codec_state_positions;
+
+  std::vector<cue_duration_t> m_durations; // appended to for each packet, sorted once per cluster
 
   size_t m_num_cue_points_postprocessed;
   bool m_no_cue_duration, m_no_cue_relative_position;
-  debugging_option_c m_debug_cue_duration, m_debug_cue_relative_position;
+  debugging_option_c m_debug_cue_duration, m_debug_cue_relative_position, m_debug_memory;
 
 protected:
   static cues_cptr s_cues;
@@ -51,18 +70,28 @@ public:
   void add(KaxCues &cues);
   void add(KaxCuePoint &point);
   void write(mm_io_c &out, KaxSeekHead &seek_head);
+  void add(cue_point_t const &point);
   void postprocess_cues(KaxCues &cues, KaxCluster &cluster);
+  void postprocess_cues(uint64_t cluster_data_start_pos, std::multimap<id_timecode_t, uint64_t> const &block_positions);
   void set_duration_for_id_timecode(uint64_t id, uint64_t timecode, uint64_t duration);
   void adjust_positions(uint64_t old_position, uint64_t delta);
 
+  std::size_t get_num_points() const;
+  std::size_t get_memory_usage() const;
+
 public:
   static cues_c &get();
 
 protected:
-  void sort();
+  std::vector<uint32_t> sort() const;
+  void clear();
+  uint64_t get_timecode(std::size_t idx) const;
+  uint64_t get_cluster_position(std::size_t idx) const;
+  uint64_t get_sparse_value(std::vector<std::pair<uint32_t, uint64_t>> const &column, std::size_t idx) const;
+  void set_sparse_value(std::vector<std::pair<uint32_t, uint64_t>> &column, std::size_t idx, uint64_t value);
   std::multimap<id_timecode_t, uint64_t> calculate_block_positions(KaxCluster &cluster) const;
   uint64_t calculate_total_size() const;
-  uint64_t calculate_point_size(cue_point_t const &point) const;
+  uint64_t calculate_point_size(std::size_t idx) const;
   uint64_t calculate_bytes_for_uint(uint64_t value) const;
 };
 
@@ -34,6 +34,7 @@
 #include "merge/cluster_helper.h"
 #include "merge/filelist.h"
 #include "merge/generic_packetizer.h"
+#include "merge/packet_compression_workers.h"
 #include "merge/generic_reader.h"
 #include "merge/output_control.h"
 #include "merge/webm.h"
@@ -167,6 +168,11 @@ generic_packetizer_c::generic_packetizer_c(generic_reader_c *reader,
   else if (mtx::includes(m_ti.m_compression_list, -1))
     m_ti.m_compression = m_ti.m_compression_list[-1];
 
+  if (mtx::includes(m_ti.m_compression_level_list, m_ti.m_id))
+    m_ti.m_compression_level = m_ti.m_compression_level_list[m_ti.m_id];
+  else if (mtx::includes(m_ti.m_compression_level_list, -1))
+    m_ti.m_compression_level = m_ti.m_compression_level_list[-1];
+
   // Let's see if the user has specified a name for this track.
   if (mtx::includes(m_ti.m_track_names, m_ti.m_id))
     m_ti.m_track_name = m_ti.m_track_names[m_ti.m_id];
@@ -1154,6 +1160,14 @@ generic_packetizer_c::set_headers() {
 
     m_compressor = compressor_c::create(m_hcompression);
     m_compressor->set_track_headers(c_encoding);
+
+    if (m_ti.m_compression_level)
+      m_compressor->set_compression_level(*m_ti.m_compression_level);
+
+    // zlib compression is by far the most expensive one and the only
+    // one that doesn't depend on previous packets.
+    if ((COMPRESSION_ZLIB == m_hcompression) && !hack_engaged(ENGAGE_NO_COMPRESSION_THREADS))
+      m_parallel_compression_level = m_ti.m_compression_level ? *m_ti.m_compression_level : Z_BEST_COMPRESSION;
   }
 
   if (g_no_lacing)
@@ -1193,6 +1207,23 @@ generic_packetizer_c::compress_packet(packet_t &packet) {
   }
 }
 
+void
+generic_packetizer_c::compress_packet_in_parallel(packet_cptr const &packet) {
+  packet->pending_compression = packet_compression_workers_c::get().add(packet, *m_parallel_compression_level);
+}
+
+void
+generic_packetizer_c::wait_for_compression(packet_t &packet) {
+  try {
+    packet.pending_compression.get();
+
+  } catch (mtx::compression_x &e) {
+    mxerror_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Compression failed: %1%\n")) % e.error());
+  }
+
+  packet.pending_compression = std::shared_future<void>{};
+}
+
 void
 generic_packetizer_c::account_enqueued_bytes(packet_t &packet,
                                              int64_t factor) {
@@ -1303,7 +1334,10 @@ generic_packetizer_c::add_packet2(packet_cptr pack) {
 
   after_packet_timestamped(*pack);
 
-  compress_packet(*pack);
+  if (m_parallel_compression_level)
+    compress_packet_in_parallel(pack);
+  else
+    compress_packet(*pack);
 }
 
 void
@@ -1321,6 +1355,9 @@ generic_packetizer_c::get_packet() {
   packet_cptr pack = m_packet_queue.front();
   m_packet_queue.pop_front();
 
+  if (pack->pending_compression.valid())
+    wait_for_compression(*pack);
+
   pack->output_order_timecode = timestamp_c::ns(pack->assigned_timecode - std::max(m_codec_delay.to_ns(0), m_seek_pre_roll.to_ns(0)));
 
   account_enqueued_bytes(*pack, -1);
@@ -1493,10 +1530,14 @@ generic_packetizer_c::connect(generic_packetizer_c *src,
   m_huid                       = src->m_huid;
   m_hcompression               = src->m_hcompression;
   m_compressor                 = compressor_c::create(m_hcompression);
+  m_parallel_compression_level = src->m_parallel_compression_level;
   m_last_cue_timecode          = src->m_last_cue_timecode;
   m_timestamp_factory          = src->m_timestamp_factory;
   m_correction_timecode_offset = 0;
 
+  if (m_compressor && src->m_ti.m_compression_level)
+    m_compressor->set_compression_level(*src->m_ti.m_compression_level);
+
   if (-1 == append_timecode_offset)
     m_append_timecode_offset   = src->m_max_timecode_seen;
   else
@@ -76,6 +76,7 @@ protected:
 
   compression_method_e m_hcompression;
   compressor_ptr m_compressor;
+  boost::optional<int> m_parallel_compression_level;
 
   timestamp_factory_cptr m_timestamp_factory;
   timestamp_factory_application_e m_timestamp_factory_application_mode;
@@ -125,6 +126,9 @@ public:
   inline int64_t get_queued_bytes() const {
     return m_enqueued_bytes;
   }
+  inline int64_t get_num_queued_packets() const {
+    return m_packet_queue.size();
+  }
 
   inline void set_free_refs(int64_t free_refs) {
     m_free_refs      = m_next_free_refs;
@@ -271,6 +275,13 @@ public:
 
   virtual generic_packetizer_c *get_connected_successor() const;
 
+  // Number of bytes the track headers are expected to grow by after
+  // they've been written for the first time, e.g. for codec private
+  // data that's only known after the first frames have been parsed.
+  virtual int64_t get_expected_header_growth() const {
+    return 0;
+  }
+
   // Callbacks
   virtual void after_packet_timestamped(packet_t &packet);
   virtual void after_packet_rendered(packet_t const &packet);
@@ -284,6 +295,8 @@ protected:
   virtual void show_experimental_status_version(std::string const &codec_id);
 
   virtual void compress_packet(packet_t &packet);
+  virtual void compress_packet_in_parallel(packet_cptr const &packet);
+  virtual void wait_for_compression(packet_t &packet);
   virtual void account_enqueued_bytes(packet_t &packet, int64_t factor);
 };
 
@@ -31,6 +31,7 @@
 #include <iostream>
 #include <list>
 #include <sstream>
+#include <thread>
 #include <tuple>
 #include <typeinfo>
 
@@ -60,6 +61,7 @@
 #include "common/webm.h"
 #include "common/xml/ebml_segmentinfo_converter.h"
 #include "common/xml/ebml_tags_converter.h"
+#include "merge/batch_identification.h"
 #include "merge/cluster_helper.h"
 #include "merge/filelist.h"
 #include "merge/generic_reader.h"
@@ -125,6 +127,12 @@ set_usage() {
   usage_text += Y("  --timecode-scale <n>     Force the timecode scale factor to n.\n");
   usage_text += Y("  --disable-track-statistics-tags\n"
                   "                           Do not write tags with track statistics.\n");
+  usage_text += Y("  --parallel-reading       Run each source file's reader on a thread of its\n"
+                  "                           own. Only helps with several source files.\n");
+  usage_text += Y("  --read-ahead-size <d[K,M]>\n"
+                  "                           Read up to d bytes (KB, MB) of each source file\n"
+                  "                           ahead on a background thread. 0 disables reading\n"
+                  "                           ahead.\n");
   usage_text +=   "\n";
   usage_text += Y(" File splitting, linking, appending and concatenating (more global options):\n");
   usage_text += Y("  --split <d[K,M,G]|HH:MM:SS|s>\n"
@@ -314,9 +322,10 @@ set_usage() {
                   "                           read as for the conversion to UTF-8.\n");
   usage_text +=   "\n";
   usage_text += Y(" Options that only apply to VobSub subtitle tracks:\n");
-  usage_text += Y("  --compression <TID:method>\n"
+  usage_text += Y("  --compression <TID:method[:level]>\n"
                   "                           Sets the compression method used for the\n"
-                  "                           specified track ('none' or 'zlib').\n");
+                  "                           specified track ('none' or 'zlib') and the\n"
+                  "                           level for 'zlib' (0-9, default 9).\n");
   usage_text +=   "\n\n";
   usage_text += Y(" Other options:\n");
   usage_text += Y("  -i, --identify <file>    Print information about the source file.\n");
@@ -325,6 +334,14 @@ set_usage() {
   usage_text += Y("  -F, --identification-format <format>\n"
                   "                           Set the identification results format\n"
                   "                           ('text', 'verbose-text', 'json').\n");
+  usage_text += Y("  --identification-file-list <file>\n"
+                  "                           Identify all files listed in 'file', one\n"
+                  "                           file name per line ('-' for stdin).\n"
+                  "                           Several files are only supported with\n"
+                  "                           the 'json' format, one result per line.\n");
+  usage_text += Y("  --identification-threads <n>\n"
+                  "                           Use 'n' threads for identifying several\n"
+                  "                           files (default: number of CPUs).\n");
   usage_text += Y("  --probe-range-percentage <percent>\n"
                   "                           Sets maximum size to probe for tracks in percent\n"
                   "                           of the total file size for certain file types\n"
@@ -445,6 +462,31 @@ display_unsupported_file_type(filelist_t const &file) {
   mxerror(boost::format(Y("The type of file '%1%' is not supported.\n")) % file.name);
 }
 
+static void
+identify_file(std::string file_name) {
+  auto file = filelist_t{};
+  file.ti   = std::make_unique<track_info_c>();
+
+  if ('=' == file_name[0]) {
+    file.ti->m_disable_multi_file = true;
+    file_name                     = file_name.substr(1);
+  }
+
+  file.ti->m_fname = file_name;
+  file.name        = file_name;
+  file.all_names.push_back(file_name);
+
+  get_file_type(file);
+
+  if (FILE_TYPE_IS_UNKNOWN == file.type)
+    display_unsupported_file_type(file);
+
+  create_reader(file);
+
+  file.reader->identify();
+  file.reader->display_identification_results();
+}
+
 /** \brief Identify a file type and its contents
 
    This function called for \c --identify. It sets up dummy track info
@@ -452,34 +494,94 @@ display_unsupported_file_type(filelist_t const &file) {
    and calls its identify function.
 */
 static void
-identify(std::string &filename) {
-  g_files.emplace_back(new filelist_t);
-  auto &file = *g_files.back();
-  file.ti    = std::make_unique<track_info_c>();
+identify(std::string const &file_name) {
+  verbose             = 0;
+  g_suppress_warnings = true;
+  g_identifying       = true;
 
-  if ('=' == filename[0]) {
-    file.ti->m_disable_multi_file = true;
-    filename                      = filename.substr(1);
+  identify_file(file_name);
+}
+
+/** \brief Identifies a single file for the batch identification
+
+   The JSON output as well as all warnings and errors are collected
+   instead of being output. Attempts to exit the program, e.g. after an
+   error or for unsupported files, end the identification of this file
+   only.
+*/
+static std::pair<nlohmann::json, int>
+identify_file_captured(std::string const &file_name) {
+  mtx::output::json_capture_c capture;
+
+  try {
+    identify_file(file_name);
+
+  } catch (mtx::output::exit_x &) {
+
+  } catch (std::exception &ex) {
+    capture.m_errors.push_back((boost::format(Y("The file '%1%' could not be identified: %2%\n")) % file_name % ex.what()).str());
+    if (!capture.m_exit_code)
+      capture.m_exit_code = 2;
   }
 
+  if (capture.m_result.is_null())
+    display_json_output(nlohmann::json{});
+
+  // Results for errors don't name the file, but callers cannot tell
+  // the results of several files apart otherwise.
+  if (capture.m_result.find("file_name") == capture.m_result.end())
+    capture.m_result["file_name"] = '=' == file_name[0] ? file_name.substr(1) : file_name;
+
+  return { capture.m_result, capture.m_exit_code ? std::max(*capture.m_exit_code, 0) : 0 };
+}
+
+/** \brief Identifies several files concurrently
+
+   Used if several files are to be identified in JSON mode. The files
+   are distributed to a number of threads. The results are output in
+   the order the files were given, one compact JSON object per line.
+   The program's exit code is the highest one a single identification
+   would have resulted in.
+*/
+static void
+identify_files(std::vector<std::string> const &file_names,
+               unsigned int num_threads) {
   verbose             = 0;
   g_suppress_warnings = true;
   g_identifying       = true;
-  file.ti->m_fname    = filename;
-  file.name           = filename;
-  file.all_names.push_back(filename);
 
-  get_file_type(file);
+  auto identify = [](std::string const &file_name) -> mtx::identification::result_t {
+    auto result = identify_file_captured(file_name);
+    return { mtx::json::dump(result.first, -1), result.second };
+  };
 
-  if (FILE_TYPE_IS_UNKNOWN == file.type)
-    display_unsupported_file_type(file);
+  auto output = [](std::string const &result) {
+    mxinfo(boost::format("%1%\n") % result);
+  };
 
-  create_readers();
+  mxexit(mtx::identification::identify_in_order(file_names, num_threads, identify, output));
+}
 
-  file.reader->identify();
-  file.reader->display_identification_results();
+static std::vector<std::string>
+read_identification_file_list(std::string const &list_name) {
+  auto content = std::string{};
+
+  try {
+    if (list_name == "-") {
+      mm_stdio_c in;
+      while (in.read(content, 64 * 1024, content.size()))
+        ;
+
+    } else {
+      mm_file_io_c in{list_name};
+      in.read(content, in.get_size());
+    }
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % list_name % ex);
+  }
 
-  g_files.clear();
+  return mtx::identification::parse_file_list(content);
 }
 
 /** \brief Parse tags and add them to the list of all tags
@@ -1232,7 +1334,8 @@ parse_arg_cues(const std::string &s,
 
 /** \brief Parse the \c --compression argument
 
-   The argument must have the form \c TID:compression, e.g. \c 0:zlib.
+   The argument must have the form \c TID:compression, e.g. \c 0:zlib,
+   optionally followed by the compression level, e.g. \c 0:zlib:6.
 */
 static void
 parse_arg_compression(const std::string &s,
@@ -1257,8 +1360,19 @@ parse_arg_compression(const std::string &s,
   available_compression_methods.push_back("analyze_header_removal");
 
   ti.m_compression_list[id] = COMPRESSION_UNSPECIFIED;
+  ti.m_compression_level_list.erase(id);
   balg::to_lower(parts[1]);
 
+  auto method_and_level = split(parts[1], ":", 2);
+  if (method_and_level.size() == 2) {
+    int level = 0;
+    if ((method_and_level[0] != "zlib") || !parse_number(method_and_level[1], level) || (0 > level) || (9 < level))
+      mxerror(boost::format(Y("Invalid compression level specified in '--compression %1%'. Levels from 0 to 9 are only supported for 'zlib'.\n")) % s);
+
+    ti.m_compression_level_list[id] = level;
+    parts[1]                        = method_and_level[0];
+  }
+
   if (parts[1] == "zlib")
     ti.m_compression_list[id] = COMPRESSION_ZLIB;
 
@@ -1696,6 +1810,22 @@ parse_arg_cluster_length(std::string arg) {
   }
 }
 
+static void
+parse_arg_read_ahead_size(std::string const &arg) {
+  auto s        = arg;
+  auto mod      = s.empty() ? '\0' : tolower(s[s.length() - 1]);
+  auto modifier = 'k' == mod ? 1024 : 'm' == mod ? 1024 * 1024 : 1;
+
+  if (1 != modifier)
+    s.erase(s.size() - 1);
+
+  int64_t size = 0;
+  if (!parse_number(s, size) || (0 > size) || ((1024ll * 1024 * 1024) < (size * modifier)))
+    mxerror(boost::format(Y("Invalid read-ahead size in '--read-ahead-size %1%'.\n")) % arg);
+
+  g_read_ahead_size = size * modifier;
+}
+
 static void
 parse_arg_attach_file(attachment_cptr const &attachment,
                       const std::string &arg,
@@ -1725,8 +1855,8 @@ parse_arg_attach_file(attachment_cptr const &attachment,
     if (0 == io->get_size())
       mxerror(boost::format(Y("The size of attachment '%1%' is 0.\n")) % attachment->name);
 
-    attachment->data = memory_c::alloc(io->get_size());
-    io->read(attachment->data->get_buffer(), attachment->data->get_size());
+    // The content is only read when the attachment is written.
+    attachment->file_size = io->get_size();
 
   } catch (...) {
     mxerror(boost::format(Y("The attachment '%1%' could not be read.\n")) % attachment->name);
@@ -2073,7 +2203,7 @@ parse_arg_probe_range(boost::optional<std::string> next_arg) {
 static void
 handle_identification_args(std::vector<std::string> &args) {
   auto identification_command = boost::optional<std::string>{};
-  auto file_to_identify       = boost::optional<std::string>{};
+  auto files_to_identify      = std::vector<std::string>{};
   auto this_arg_itr           = args.begin();
 
   while (this_arg_itr != args.end()) {
@@ -2112,6 +2242,8 @@ handle_identification_args(std::vector<std::string> &args) {
   if (!identification_command)
     return;
 
+  auto num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
   for (auto sit = args.cbegin(), sit_end = args.cend(); sit != sit_end; sit++) {
     auto const &this_arg = *sit;
 
@@ -2121,17 +2253,38 @@ handle_identification_args(std::vector<std::string> &args) {
     if (mtx::included_in(this_arg, "-F", "--identification-format"))
       parse_arg_identification_format(sit, sit_end);
 
-    else if (file_to_identify)
+    else if (mtx::included_in(this_arg, "--identification-file-list", "--identification-threads")) {
+      if ((sit + 1) == sit_end)
+        mxerror(boost::format(Y("'%1%' lacks its argument.\n")) % this_arg);
+
+      ++sit;
+
+      if (this_arg == "--identification-file-list") {
+        auto file_names = read_identification_file_list(*sit);
+        brng::copy(file_names, std::back_inserter(files_to_identify));
+
+      } else if (!parse_number(*sit, num_threads) || !num_threads)
+        mxerror(boost::format(Y("Invalid number of threads in '%1% %2%'.\n")) % this_arg % *sit);
+
+    } else if (!files_to_identify.empty() && (this_arg[0] == '-'))
       mxerror(boost::format(Y("The argument '%1%' is not allowed in identification mode.\n")) % this_arg);
 
     else
-      file_to_identify = this_arg;
+      files_to_identify.emplace_back(this_arg);
   }
 
-  if (!file_to_identify)
+  if (files_to_identify.empty())
     mxerror(boost::format(Y("'%1%' lacks its argument.\n")) % *identification_command);
 
-  identify(*file_to_identify);
+  if (files_to_identify.size() == 1)
+    identify(files_to_identify[0]);
+
+  else if (identification_output_format_e::json != g_identification_output_format)
+    mxerror(Y("Several files can only be identified at once with the JSON identification format.\n"));
+
+  else
+    identify_files(files_to_identify, num_threads);
+
   mxexit();
 }
 
@@ -2185,6 +2338,16 @@ parse_args(std::vector<std::string> args) {
 
     } else if ((this_arg == "-w") || (this_arg == "--webm"))
       set_output_compatibility(OC_WEBM);
+
+    else if (this_arg == "--read-ahead-size") {
+      // Source files are opened while parsing the remaining options.
+      if (no_next_arg)
+        mxerror(Y("'--read-ahead-size' lacks the size.\n"));
+
+      parse_arg_read_ahead_size(next_arg);
+      sit++;
+
+    }
   }
 
   if (g_outfile.empty()) {
@@ -2212,7 +2375,8 @@ parse_args(std::vector<std::string> args) {
     if (   (this_arg == "-o")
         || (this_arg == "--output")
         || (this_arg == "--command-line-charset")
-        || (this_arg == "--engage")) {
+        || (this_arg == "--engage")
+        || (this_arg == "--read-ahead-size")) {
       sit++;
       continue;
     }
@@ -2308,6 +2472,9 @@ parse_args(std::vector<std::string> args) {
     else if (this_arg == "--disable-track-statistics-tags")
       g_no_track_statistics_tags = true;
 
+    else if (this_arg == "--parallel-reading")
+      g_parallel_reading = true;
+
     else if (this_arg == "--attachment-description") {
       if (no_next_arg)
         mxerror(Y("'--attachment-description' lacks the description.\n"));
@@ -15,9 +15,12 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <cmath>
 #include <iostream>
+#include <mutex>
+#include <set>
 #include <typeinfo>
 
 #include <ebml/EbmlHead.h>
@@ -26,7 +29,6 @@
 #include <ebml/EbmlVoid.h>
 
 #include <matroska/FileKax.h>
-#include <matroska/KaxAttached.h>
 #include <matroska/KaxAttachments.h>
 #include <matroska/KaxBlock.h>
 #include <matroska/KaxChapters.h>
@@ -55,6 +57,8 @@
 #include "common/ebml.h"
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
+#include "common/memory_pool.h"
+#include "common/mm_async_write_buffer_io.h"
 #include "common/mm_io_x.h"
 #include "common/mm_write_buffer_io.h"
 #include "common/strings/formatting.h"
@@ -62,12 +66,15 @@
 #include "common/translation.h"
 #include "common/unique_numbers.h"
 #include "common/version.h"
+#include "merge/attachment_writer.h"
 #include "merge/cluster_helper.h"
 #include "merge/cues.h"
 #include "merge/filelist.h"
 #include "merge/generic_packetizer.h"
 #include "merge/generic_reader.h"
 #include "merge/output_control.h"
+#include "merge/packetizer_heap.h"
+#include "merge/reader_threads.h"
 #include "merge/webm.h"
 
 using namespace libmatroska;
@@ -98,7 +105,7 @@ kax_info_cptr g_kax_info_chap;
 
 // Variables set by the command line parser.
 std::string g_outfile;
-int64_t g_file_sizes                        = 0;
+std::atomic<int64_t> g_file_sizes{0};
 int g_max_blocks_per_cluster                = 65535;
 int64_t g_max_ns_per_cluster                = 5000000000ll;
 bool g_write_cues                           = true;
@@ -110,6 +117,8 @@ bool g_no_linking                           = true;
 bool g_use_durations                        = false;
 bool g_no_track_statistics_tags             = false;
 bool g_write_date                           = true;
+bool g_parallel_reading                     = false;
+int64_t g_read_ahead_size                   = 1024 * 1024;
 
 double g_timecode_scale                     = TIMECODE_SCALE;
 timecode_scale_mode_e g_timecode_scale_mode = TIMECODE_SCALE_MODE_NORMAL;
@@ -152,6 +161,17 @@ append_mode_e g_append_mode                 = APPEND_MODE_FILE_BASED;
 bool s_appending_files                      = false;
 auto s_debug_appending                      = debugging_option_c{"append|appending"};
 auto s_debug_rerender_track_headers         = debugging_option_c{"rerender|rerender_track_headers"};
+auto s_debug_memory_pool                    = debugging_option_c{"memory_pool"};
+
+static std::unique_ptr<reader_threads_c> s_reader_threads;
+// The main loop only pulls the packetizers listed here and keeps the
+// packets ready for output in a heap instead of looking at all
+// packetizers for each packet.
+static std::set<std::size_t> s_packetizers_to_pull;
+static packetizer_heap_c s_packetizer_heap;
+static bool s_packetizer_holding{};
+static std::atomic<bool> s_track_headers_need_rerendering{};
+static std::recursive_mutex s_required_matroska_version_mutex;
 
 std::string g_default_language              = "und";
 
@@ -165,7 +185,7 @@ static KaxMyDuration *s_kax_duration;
 static std::unique_ptr<KaxTags> s_kax_tags;
 static kax_chapters_cptr s_chapters_in_this_file;
 
-static std::unique_ptr<KaxAttachments> s_kax_as;
+static std::unique_ptr<attachment_writer_c> s_attachment_writer;
 
 static std::unique_ptr<EbmlVoid> s_kax_sh_void;
 static std::unique_ptr<EbmlVoid> s_kax_chapters_void;
@@ -371,7 +391,7 @@ add_attachment(attachment_cptr const &attachment) {
           ||
           (   (ex_attachment->name             == attachment->name)
            && (ex_attachment->description      == attachment->description)
-           && (ex_attachment->data->get_size() == attachment->data->get_size())
+           && (ex_attachment->get_size()       == attachment->get_size())
            && (ex_attachment->source_file      != attachment->source_file)
            && !attachment->source_file.empty()))
         return attachment->id;
@@ -411,6 +431,7 @@ add_packetizer_globally(generic_packetizer_c *packetizer) {
     mxerror(boost::format(Y("filelist_t not found for generic_packetizer_c. %1%\n")) % BUGMSG);
 
   g_packetizers.push_back(pack);
+  s_packetizers_to_pull.insert(g_packetizers.size() - 1);
 }
 
 static void
@@ -452,6 +473,8 @@ set_timecode_scale() {
 
 bool
 set_required_matroska_version(unsigned int required_version) {
+  std::lock_guard<std::recursive_mutex> lock{s_required_matroska_version_mutex};
+
   auto previous               = s_required_matroska_version;
   s_required_matroska_version = std::max(s_required_matroska_version, required_version);
   auto version_changed        = s_required_matroska_version != previous;
@@ -464,6 +487,8 @@ set_required_matroska_version(unsigned int required_version) {
 
 bool
 set_required_matroska_read_version(unsigned int required_read_version) {
+  std::lock_guard<std::recursive_mutex> lock{s_required_matroska_version_mutex};
+
   auto previous                    = s_required_matroska_read_version;
   s_required_matroska_read_version = std::max(s_required_matroska_read_version, required_read_version);
 
@@ -683,9 +708,17 @@ render_headers(mm_io_c *out) {
       g_kax_sh_main->IndexThis(*g_kax_tracks, *g_kax_segment);
 
       // Reserve some small amount of space for header changes by the
-      // packetizers.
+      // packetizers plus whatever they expect to add once they've seen
+      // the actual content (e.g. codec private data).
+      auto expected_growth = int64_t{};
+      for (auto &ptzr : g_packetizers)
+        if (ptzr.packetizer)
+          expected_growth += ptzr.packetizer->get_expected_header_growth();
+
+      mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] render_headers: expected growth of track headers %1%\n") % expected_growth);
+
       s_void_after_track_headers = std::make_unique<EbmlVoid>();
-      s_void_after_track_headers->SetSize(1024 + full_header_size - g_kax_tracks->ElementSize(false));
+      s_void_after_track_headers->SetSize(1024 + expected_growth + full_header_size - g_kax_tracks->ElementSize(false));
       s_void_after_track_headers->Render(*out);
     }
 
@@ -727,6 +760,74 @@ adjust_cue_and_seekhead_positions(uint64_t data_start_pos,
     adjust_cluster_seekhead_positions(data_start_pos, delta);
 }
 
+static void
+handle_moved_written_data(uint64_t data_start_pos,
+                          uint64_t delta,
+                          uint64_t rel_pos_from_end) {
+  if (s_attachment_writer) {
+    // The attachments have been moved along with the other data; only
+    // their position for the meta seek element has to be updated.
+    mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender]  moving attachments; old position %1% new %2%\n") % s_attachment_writer->get_position() % (s_attachment_writer->get_position() + delta));
+    s_attachment_writer->set_position(s_attachment_writer->get_position() + delta);
+  }
+
+  if (s_kax_chapters_void) {
+    mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender]  re-writing chapter placeholder; old position %1% new %2%\n") % s_kax_chapters_void->GetElementPosition() % (s_kax_chapters_void->GetElementPosition() + delta));
+    s_out->setFilePointer(s_kax_chapters_void->GetElementPosition() + delta);
+    s_kax_chapters_void->Render(*s_out);
+  }
+
+  s_out->setFilePointer(rel_pos_from_end, seek_end);
+
+  adjust_cue_and_seekhead_positions(data_start_pos, delta);
+}
+
+/* Lets the file system shift all data written after the track headers
+   towards the end of the file (fallocate() with FALLOC_FL_INSERT_RANGE
+   on Linux) instead of copying it. The inserted range must start at a
+   file system block boundary, so the part of the block before
+   data_start_pos is saved and written again afterwards. Returns the
+   number of bytes the data has actually been moved by, which is
+   'delta' rounded up to the block size, or 0 if the file system
+   doesn't support it. */
+static uint64_t
+insert_space_for_written_data(uint64_t data_start_pos,
+                              uint64_t delta) {
+  auto block_size = s_out->get_fs_block_size();
+  if (!block_size)
+    return 0;
+
+  auto rel_pos_from_end = s_out->get_size() - s_out->getFilePointer();
+  auto aligned_pos      = data_start_pos / block_size * block_size;
+  auto length           = (delta + block_size - 1) / block_size * block_size;
+  auto head_size        = data_start_pos - aligned_pos;
+  auto head             = std::string{};
+
+  s_out->setFilePointer(aligned_pos);
+  if (s_out->read(head, head_size) != head_size) {
+    s_out->setFilePointer(rel_pos_from_end, seek_end);
+    return 0;
+  }
+
+  auto inserted = s_out->insert_range(aligned_pos, length);
+
+  mxdebug_if(s_debug_rerender_track_headers,
+             boost::format("[rerender] insert_space_for_written_data: data_start_pos %1% delta %2% block_size %3% aligned_pos %4% length %5% result %6%\n")
+             % data_start_pos % delta % block_size % aligned_pos % length % inserted);
+
+  if (!inserted) {
+    s_out->setFilePointer(rel_pos_from_end, seek_end);
+    return 0;
+  }
+
+  s_out->setFilePointer(aligned_pos);
+  s_out->write(head);
+
+  handle_moved_written_data(data_start_pos, length, rel_pos_from_end);
+
+  return length;
+}
+
 static void
 relocate_written_data(uint64_t data_start_pos,
                       uint64_t delta) {
@@ -778,21 +879,7 @@ relocate_written_data(uint64_t data_start_pos,
     relocated += to_copy;
   }
 
-  if (s_kax_as) {
-    mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender]  re-writing attachments; old position %1% new %2%\n") % s_kax_as->GetElementPosition() % (s_kax_as->GetElementPosition() + delta));
-    s_out->setFilePointer(s_kax_as->GetElementPosition() + delta);
-    s_kax_as->Render(*s_out);
-  }
-
-  if (s_kax_chapters_void) {
-    mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender]  re-writing chapter placeholder; old position %1% new %2%\n") % s_kax_chapters_void->GetElementPosition() % (s_kax_chapters_void->GetElementPosition() + delta));
-    s_out->setFilePointer(s_kax_chapters_void->GetElementPosition() + delta);
-    s_kax_chapters_void->Render(*s_out);
-  }
-
-  s_out->setFilePointer(rel_pos_from_end, seek_end);
-
-  adjust_cue_and_seekhead_positions(data_start_pos, delta);
+  handle_moved_written_data(data_start_pos, delta, rel_pos_from_end);
 }
 
 static void
@@ -846,6 +933,14 @@ shrink_void_and_rerender_track_headers(int64_t new_void_size) {
 */
 void
 rerender_track_headers() {
+  // Reader threads must neither touch the other tracks' headers nor
+  // the output file. The main thread will take care of it once it
+  // regains control.
+  if (reader_threads_c::is_reader_thread()) {
+    s_track_headers_need_rerendering = true;
+    return;
+  }
+
   g_kax_tracks->UpdateSize(false);
 
   auto position_before    = s_out->getFilePointer();
@@ -860,11 +955,19 @@ rerender_track_headers() {
              % new_tracks_end_pos % data_start_pos % data_size % s_void_after_track_headers->GetElementPosition() % s_void_after_track_headers->ElementSize(true) % new_void_size);
 
   if (data_size  && (new_tracks_end_pos >= (data_start_pos - 3))) {
-    auto delta      = 1024 + new_tracks_end_pos - data_start_pos;
-    data_start_pos += delta;
-    new_void_size   = 1024;
+    auto delta = 1024 + new_tracks_end_pos - data_start_pos;
 
-    relocate_written_data(data_start_pos - delta, delta);
+    if (!g_cluster_helper->discarding()) {
+      // Copying all the data written so far is only the last resort.
+      auto inserted = insert_space_for_written_data(data_start_pos, delta);
+      if (inserted)
+        delta = inserted;
+      else
+        relocate_written_data(data_start_pos, delta);
+    }
+
+    data_start_pos += delta;
+    new_void_size   = data_start_pos - new_tracks_end_pos;
   }
 
   shrink_void_and_rerender_track_headers(new_void_size);
@@ -879,43 +982,23 @@ rerender_track_headers() {
 
    This function also makes sure that no duplicates are output. This might
    happen when appending files.
+
+   The content of attachments read from disk is copied in chunks while
+   writing instead of being kept in memory.
 */
 static void
-render_attachments(IOCallback *out) {
-  s_kax_as   = std::make_unique<KaxAttachments>();
-  auto kax_a = static_cast<KaxAttached *>(nullptr);
-
-  for (auto &attachment_p : g_attachments) {
-    auto attch = *attachment_p;
-
-    if ((1 == g_file_num) || attch.to_all_files) {
-      kax_a = !kax_a ? &GetChild<KaxAttached>(*s_kax_as) : &GetNextChild<KaxAttached>(*s_kax_as, *kax_a);
-
-      if (attch.description != "")
-        GetChild<KaxFileDescription>(kax_a).SetValueUTF8(attch.description);
-
-      if (attch.mime_type != "")
-        GetChild<KaxMimeType>(kax_a).SetValue(attch.mime_type);
+render_attachments(mm_io_c &out) {
+  s_attachment_writer = std::make_unique<attachment_writer_c>();
 
-      std::string name;
-      if (attch.stored_name == "")
-        name = bfs::path{attch.name}.filename().string();
+  for (auto &attachment : g_attachments)
+    if ((1 == g_file_num) || attachment->to_all_files)
+      s_attachment_writer->add(attachment);
 
-      else
-        name = attch.stored_name;
-
-      GetChild<KaxFileName>(kax_a).SetValueUTF8(name);
-      GetChild<KaxFileUID >(kax_a).SetValue(attch.id);
-
-      GetChild<KaxFileData>(*kax_a).CopyBuffer(attch.data->get_buffer(), attch.data->get_size());
-    }
-  }
-
-  if (s_kax_as->ListSize() != 0)
-    s_kax_as->Render(*out);
+  if (!s_attachment_writer->empty())
+    s_attachment_writer->render(out);
   else
-    // Delete the kax_as pointer so that it won't be referenced in a seek head.
-    s_kax_as.reset();
+    // Delete the writer so that the attachments won't be referenced in a seek head.
+    s_attachment_writer.reset();
 }
 
 /** \brief Check the complete append mapping mechanism
@@ -1145,9 +1228,9 @@ void
 calc_attachment_sizes() {
   // Calculate the size of all attachments for split control.
   for (auto &att : g_attachments) {
-    g_attachment_sizes_first += att->data->get_size();
+    g_attachment_sizes_first += att->get_size();
     if (att->to_all_files)
-      g_attachment_sizes_others += att->data->get_size();
+      g_attachment_sizes_others += att->get_size();
   }
 }
 
@@ -1351,7 +1434,7 @@ create_next_output_file() {
 
   // Open the output file.
   try {
-    s_out = !g_cluster_helper->discarding() ? mm_write_buffer_io_c::open(this_outfile, 20 * 1024 * 1024) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
+    s_out = !g_cluster_helper->discarding() ? mm_async_write_buffer_io_c::open(this_outfile, 5 * 1024 * 1024, 4) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("The file '%1%' could not be opened for writing: %2%.\n")) % this_outfile % ex);
   }
@@ -1362,7 +1445,7 @@ create_next_output_file() {
   g_cluster_helper->set_output(s_out.get());
 
   render_headers(s_out.get());
-  render_attachments(s_out.get());
+  render_attachments(*s_out);
   render_chapter_void_placeholder();
   add_tags_from_cue_chapters();
   prepare_tags_for_rendering();
@@ -1617,9 +1700,16 @@ finish_file(bool last_file,
     s_chapters_in_this_file.reset();
   }
 
-  if (s_kax_as) {
-    g_kax_sh_main->IndexThis(*s_kax_as, *g_kax_segment);
-    s_kax_as.reset();
+  if (s_attachment_writer) {
+    // Same as KaxSeekHead::IndexThis() for the attachments.
+    auto &seek = AddNewChild<KaxSeek>(*g_kax_sh_main);
+    GetChild<KaxSeekPosition>(seek).SetValue(g_kax_segment->GetRelativePosition(s_attachment_writer->get_position()));
+
+    binary id[4];
+    EBML_ID(KaxAttachments).Fill(id);
+    GetChild<KaxSeekID>(seek).CopyBuffer(id, EBML_ID_LENGTH(EBML_ID(KaxAttachments)));
+
+    s_attachment_writer.reset();
   }
 
   if ((g_kax_sh_main->ListSize() > 0) && !hack_engaged(ENGAGE_NO_META_SEEK)) {
@@ -1658,6 +1748,12 @@ force_close_output_file() {
 
 static void establish_deferred_connections(filelist_t &file);
 
+static void
+mark_all_packetizers_for_pulling() {
+  for (auto idx = 0u; idx < g_packetizers.size(); ++idx)
+    s_packetizers_to_pull.insert(idx);
+}
+
 static void
 append_chapters_for_track(filelist_t &src_file,
                           int64_t timecode_adjustment) {
@@ -1795,6 +1891,8 @@ append_track(packetizer_t &ptzr,
   ptzr.file                            = amap.src_file_id;
   ptzr.status                          = FILE_STATUS_MOREDATA;
 
+  mark_all_packetizers_for_pulling();
+
   // Fix the globally stored video packetizer reference so that
   // decisions based on a packet's source such as when to render a new
   // cluster continue working.
@@ -1953,8 +2051,36 @@ check_and_handle_end_of_input_after_pulling(packetizer_t &ptzr) {
   file.old_num_unfinished_packetizers = file.num_unfinished_packetizers;
 }
 
+static file_status_e
+read_from_packetizer(packetizer_t &ptzr,
+                     bool force) {
+  if (!s_reader_threads)
+    return ptzr.packetizer->read(force);
+
+  auto status = s_reader_threads->read(*ptzr.packetizer, force);
+
+  if (s_track_headers_need_rerendering.exchange(false))
+    rerender_track_headers();
+
+  return status;
+}
+
+static void
+take_packet_from_packetizer(packetizer_t &ptzr) {
+  if (ptzr.pack)
+    return;
+
+  ptzr.pack = ptzr.packetizer->get_packet();
+  if (ptzr.pack)
+    s_packetizer_heap.add(&ptzr - &g_packetizers[0], ptzr.pack->output_order_timecode);
+}
+
 static bool
 force_pull_packetizers_of_fully_held_files() {
+  // A file can only be fully held if at least one packetizer is holding.
+  if (!s_packetizer_holding)
+    return false;
+
   std::unordered_map<generic_reader_c *, bool> fully_held_files;
 
   for (auto &ptzr : g_packetizers) {
@@ -1972,58 +2098,136 @@ force_pull_packetizers_of_fully_held_files() {
   for (auto &ptzr : g_packetizers)
     if (fully_held_files[ptzr.packetizer->m_reader] && !ptzr.packetizer->packet_available()) {
       ptzr.old_status = ptzr.status;
-      ptzr.status     = ptzr.packetizer->read(true);
+      ptzr.status     = read_from_packetizer(ptzr, true);
       force_pulled    = true;
 
-      if (!ptzr.pack)
-        ptzr.pack = ptzr.packetizer->get_packet();
+      take_packet_from_packetizer(ptzr);
 
       check_and_handle_end_of_input_after_pulling(ptzr);
+
+      s_packetizers_to_pull.insert(&ptzr - &g_packetizers[0]);
     }
 
   return force_pulled;
 }
 
 static void
-pull_packetizers_for_packets() {
-  for (auto &ptzr : g_packetizers) {
-    if (FILE_STATUS_HOLDING == ptzr.status)
-      ptzr.status = FILE_STATUS_MOREDATA;
+pull_packetizer_for_packet(std::size_t idx) {
+  auto &ptzr = g_packetizers[idx];
 
-    ptzr.old_status = ptzr.status;
+  if (FILE_STATUS_HOLDING == ptzr.status)
+    ptzr.status = FILE_STATUS_MOREDATA;
 
-    while (   !ptzr.pack
-           && (FILE_STATUS_MOREDATA == ptzr.status)
-           && !ptzr.packetizer->packet_available())
-      ptzr.status = ptzr.packetizer->read(false);
+  ptzr.old_status = ptzr.status;
+
+  while (   !ptzr.pack
+         && (FILE_STATUS_MOREDATA == ptzr.status)
+         && !ptzr.packetizer->packet_available())
+    ptzr.status = read_from_packetizer(ptzr, false);
+
+  if (   (FILE_STATUS_MOREDATA != ptzr.status)
+      && (FILE_STATUS_MOREDATA == ptzr.old_status))
+    ptzr.packetizer->force_duration_on_last_packet();
+
+  take_packet_from_packetizer(ptzr);
+
+  check_and_handle_end_of_input_after_pulling(ptzr);
+
+  // Pulling a packetizer that has a packet and isn't holding doesn't
+  // change anything; neither does pulling one that's done.
+  if (FILE_STATUS_HOLDING == ptzr.status)
+    s_packetizer_holding = true;
+
+  if (   (FILE_STATUS_HOLDING == ptzr.status)
+      || (!ptzr.pack && (FILE_STATUS_DONE_AND_DRY != ptzr.status)))
+    s_packetizers_to_pull.insert(idx);
+}
+
+static void
+pull_packetizers_for_packets() {
+  s_packetizer_holding = false;
+
+  // Packetizers are pulled in the order of their indexes. Pulling may
+  // mark additional packetizers for pulling; the ones with higher
+  // indexes are still pulled in this pass.
+  auto itr = s_packetizers_to_pull.begin();
 
-    if (   (FILE_STATUS_MOREDATA != ptzr.status)
-        && (FILE_STATUS_MOREDATA == ptzr.old_status))
-      ptzr.packetizer->force_duration_on_last_packet();
+  while (itr != s_packetizers_to_pull.end()) {
+    auto idx = *itr;
+    s_packetizers_to_pull.erase(itr);
 
-    if (!ptzr.pack)
-      ptzr.pack = ptzr.packetizer->get_packet();
+    pull_packetizer_for_packet(idx);
 
-    check_and_handle_end_of_input_after_pulling(ptzr);
+    itr = s_packetizers_to_pull.upper_bound(idx);
   }
 }
 
 static packetizer_t *
 select_winning_packetizer() {
-  packetizer_t *winner = nullptr;
+  while (true) {
+    auto idx = s_packetizer_heap.top();
+    if (!idx)
+      return nullptr;
 
-  for (auto &ptzr : g_packetizers) {
-    if (!ptzr.pack)
-      continue;
+    auto &ptzr = g_packetizers[*idx];
+    if (ptzr.pack)
+      return &ptzr;
+
+    s_packetizer_heap.remove(*idx);
+  }
+}
+
+/** \brief Runs the readers on threads of their own if requested
+
+   Appending files rearranges the packetizers while muxing and is
+   therefore only supported with the readers running on the main
+   thread. The same is true if there's only a single reader as the
+   main thread and the reader threads never run concurrently.
+*/
+static void
+start_reader_threads() {
+  if (!g_parallel_reading || s_appending_files)
+    return;
 
-    if (!winner || !winner->pack)
-      winner = &ptzr;
+  s_reader_threads = std::make_unique<reader_threads_c>();
+
+  for (auto &ptzr : g_packetizers)
+    s_reader_threads->add_packetizer(*ptzr.packetizer);
 
-    else if (ptzr.pack && (ptzr.pack->output_order_timecode < winner->pack->output_order_timecode))
-      winner = &ptzr;
+  if (2 > s_reader_threads->get_num_readers()) {
+    s_reader_threads.reset();
+    return;
   }
 
-  return winner;
+  s_reader_threads->start();
+}
+
+static void
+stop_reader_threads() {
+  if (!s_reader_threads)
+    return;
+
+  s_reader_threads->stop();
+
+  // If called from one of the reader threads (e.g. via mxerror() and
+  // cleanup()) the main thread might still be waiting on the reader
+  // threads' synchronization primitives. The process is about to exit
+  // anyway, so don't destroy them.
+  if (reader_threads_c::is_reader_thread())
+    s_reader_threads.release();
+  else
+    s_reader_threads.reset();
+}
+
+static void
+output_packet_of_packetizer(packetizer_t &ptzr) {
+  g_cluster_helper->add_packet(ptzr.pack);
+
+  ptzr.pack.reset();
+
+  auto idx = &ptzr - &g_packetizers[0];
+  s_packetizer_heap.remove(idx);
+  s_packetizers_to_pull.insert(idx);
 }
 
 static void
@@ -2042,6 +2246,8 @@ discard_queued_packets() {
 */
 void
 main_loop() {
+  start_reader_threads();
+
   // Let's go!
   while (1) {
     // Step 1: Make sure a packet is available for each output
@@ -2057,13 +2263,9 @@ main_loop() {
     bool appended_a_track = s_appending_files && append_tracks_maybe();
 
     if (winner && winner->pack) {
-      packet_cptr pack = winner->pack;
-
       // Step 3: Add the winning packet to a cluster. Full clusters will be
       // rendered automatically.
-      g_cluster_helper->add_packet(pack);
-
-      winner->pack.reset();
+      output_packet_of_packetizer(*winner);
 
       // If splitting by parts is active and the last part has been
       // processed fully then we can finish up.
@@ -2080,12 +2282,16 @@ main_loop() {
       break;
   }
 
+  stop_reader_threads();
+
   // Render all remaining packets (if there are any).
   if (g_cluster_helper && (0 < g_cluster_helper->get_packet_count()))
     g_cluster_helper->render();
 
   if (1 <= verbose)
     display_progress(true);
+
+  mxdebug_if(s_debug_memory_pool, mtx::mem::pool_c::get().format_statistics());
 }
 
 /** \brief Deletes the file readers and other associated objects
@@ -2094,6 +2300,8 @@ static void
 destroy_readers() {
   g_files.clear();
   g_packetizers.clear();
+  s_packetizers_to_pull.clear();
+  s_packetizer_heap.clear();
 }
 
 /** \brief Uninitialization
@@ -2102,6 +2310,8 @@ destroy_readers() {
 */
 void
 cleanup() {
+  stop_reader_threads();
+
   if (s_out) {
     // If cleanup was called as a result of an exception during
     // writing due to the file system being full, the destructor would
@@ -2123,7 +2333,7 @@ cleanup() {
   s_kax_tags.reset();
   g_tags_from_cue_chapters.reset();
   g_kax_chapters.reset();
-  s_kax_as.reset();
+  s_attachment_writer.reset();
   g_kax_info_chap.reset();
   g_forced_seguids.clear();
   g_kax_tracks.reset();
@@ -17,6 +17,7 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
 #include <deque>
 #include <unordered_map>
 
@@ -97,6 +98,16 @@ struct attachment_t {
   bool to_all_files{};
   memory_cptr data;
   int64_t ui_id{};
+
+  // Attachments given with '--attach-file' aren't read into 'data'.
+  // Their content is copied from the file 'name' when it's written.
+  uint64_t file_size{};
+
+  uint64_t
+  get_size()
+    const {
+    return data ? data->get_size() : file_size;
+  }
 };
 using attachment_cptr = std::shared_ptr<attachment_t>;
 
@@ -148,6 +159,8 @@ extern family_uids_c g_segfamily_uids;
 extern kax_info_cptr g_kax_info_chap;
 
 extern bool g_write_meta_seek_for_clusters;
+extern bool g_parallel_reading;
+extern int64_t g_read_ahead_size;
 
 extern std::string g_chapter_file_name;
 extern std::string g_chapter_language;
@@ -178,7 +191,7 @@ extern bool g_identifying;
 extern identification_output_format_e g_identification_output_format;
 
 extern int g_file_num;
-extern int64_t g_file_sizes;
+extern std::atomic<int64_t> g_file_sizes;
 
 extern int64_t g_max_ns_per_cluster;
 extern int g_max_blocks_per_cluster;
@@ -14,11 +14,24 @@
 #include "common/common_pch.h"
 
 #include "common/math.h"
+#include "common/memory_pool.h"
 #include "common/track_statistics.h"
 #include "merge/cluster_helper.h"
 #include "merge/output_control.h"
 #include "merge/packet.h"
 
+void *
+packet_t::operator new(size_t size) {
+  auto capacity = size_t{};
+  return mtx::mem::pool_c::get().allocate(size, capacity);
+}
+
+void
+packet_t::operator delete(void *p,
+                          size_t size) {
+  mtx::mem::pool_c::get().release(static_cast<unsigned char *>(p), mtx::mem::pool_c::get_class_size(size));
+}
+
 void
 packet_t::normalize_timecodes() {
   // Normalize the timecodes according to the timecode scale.
@@ -16,6 +16,8 @@
 
 #include "common/common_pch.h"
 
+#include <future>
+
 #include "common/timestamp.h"
 
 namespace libmatroska {
@@ -67,6 +69,9 @@ struct packet_t {
 
   std::vector<packet_extension_cptr> extensions;
 
+  // Set while the packet is being compressed on a worker thread.
+  std::shared_future<void> pending_compression;
+
   packet_t()
     : group{}
     , block{}
@@ -225,6 +230,11 @@ struct packet_t {
 
   void account(track_statistics_c &statistics, int64_t timestamp_offset);
   uint64_t calculate_uncompressed_size();
+
+  // Packets are created and destroyed at a high rate; recycle their
+  // memory via the memory pool.
+  static void *operator new(size_t size);
+  static void operator delete(void *p, size_t size);
 };
 using packet_cptr = std::shared_ptr<packet_t>;
 
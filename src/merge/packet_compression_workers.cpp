@@ -0,0 +1,91 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   compressing packets on worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <unordered_map>
+
+#include "common/compression.h"
+#include "merge/packet_compression_workers.h"
+
+static debugging_option_c s_debug{"compression_workers"};
+
+packet_compression_workers_c::packet_compression_workers_c(unsigned int num_threads)
+  : m_queue{ms_max_queued_jobs, ms_max_queued_bytes}
+{
+  mxdebug_if(s_debug, boost::format("compression_workers: starting %1% threads\n") % num_threads);
+
+  for (auto idx = 0u; idx < num_threads; ++idx)
+    m_threads.emplace_back([this]() { run(); });
+}
+
+packet_compression_workers_c::~packet_compression_workers_c() {
+  m_queue.close();
+
+  for (auto &thread : m_threads) {
+    // The process may be exiting due to an error on one of the workers.
+    if (thread.get_id() == std::this_thread::get_id())
+      thread.detach();
+    else if (thread.joinable())
+      thread.join();
+  }
+
+  mxdebug_if(s_debug, boost::format("compression_workers: stopped; queue: %1%\n") % m_queue.get_statistics());
+}
+
+packet_compression_workers_c &
+packet_compression_workers_c::get() {
+  static packet_compression_workers_c s_workers{std::max(std::thread::hardware_concurrency(), 1u)};
+  return s_workers;
+}
+
+std::shared_future<void>
+packet_compression_workers_c::add(packet_cptr const &packet,
+                                  int level) {
+  job_t job;
+  job.m_packet = packet;
+  job.m_level  = level;
+
+  auto done = job.m_done.get_future().share();
+
+  m_queue.push(std::move(job), packet->calculate_uncompressed_size());
+
+  return done;
+}
+
+void
+packet_compression_workers_c::run() {
+  auto compressors = std::unordered_map<int, compressor_ptr>{};
+  job_t job;
+
+  while (m_queue.pop(job)) {
+    try {
+      auto &compressor = compressors[job.m_level];
+      if (!compressor)
+        compressor = std::make_shared<zlib_compressor_c>(job.m_level);
+
+      auto &packet = *job.m_packet;
+      packet.data  = compressor->compress(packet.data);
+      for (auto &data_add : packet.data_adds)
+        data_add = compressor->compress(data_add);
+
+      job.m_done.set_value();
+
+    } catch (...) {
+      job.m_done.set_exception(std::current_exception());
+    }
+
+    // Don't keep the packet alive until the next job arrives.
+    job = job_t{};
+  }
+}
@@ -0,0 +1,62 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for compressing packets on worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_PACKET_COMPRESSION_WORKERS_H
+#define MTX_MERGE_PACKET_COMPRESSION_WORKERS_H
+
+#include "common/common_pch.h"
+
+#include <future>
+#include <thread>
+
+#include "common/bounded_queue.h"
+#include "merge/packet.h"
+
+/* Compresses the data and the block additions of packets with zlib on
+   a pool of worker threads shared by all packetizers. The packetizers
+   hand their packets over as soon as they've been queued and wait for
+   the returned future only when the packet is taken out of their queue,
+   so the order of the packets isn't affected.
+
+   zlib's streams must not be used by several threads at the same time,
+   therefore each worker uses compressors of its own, one per
+   compression level. Errors are reported through the futures. */
+class packet_compression_workers_c {
+protected:
+  struct job_t {
+    packet_cptr m_packet;
+    int m_level{};
+    std::promise<void> m_done;
+  };
+
+  static std::size_t const ms_max_queued_jobs  = 1024;
+  static std::size_t const ms_max_queued_bytes = 64 * 1024 * 1024;
+
+  bounded_queue_c<job_t> m_queue;
+  std::vector<std::thread> m_threads;
+
+public:
+  packet_compression_workers_c(unsigned int num_threads);
+  ~packet_compression_workers_c();
+
+  std::shared_future<void> add(packet_cptr const &packet, int level);
+
+  // The pool used by the packetizers, started on first use with one
+  // thread per CPU core.
+  static packet_compression_workers_c &get();
+
+protected:
+  void run();
+};
+
+#endif  // MTX_MERGE_PACKET_COMPRESSION_WORKERS_H
@@ -0,0 +1,81 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   selection of the packetizer whose packet is output next
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "merge/packetizer_heap.h"
+
+bool
+packetizer_heap_c::is_later(entry_t const &a,
+                            entry_t const &b) {
+  if (b.m_timecode < a.m_timecode)
+    return true;
+
+  if (a.m_timecode < b.m_timecode)
+    return false;
+
+  return b.m_idx < a.m_idx;
+}
+
+void
+packetizer_heap_c::add(std::size_t idx,
+                       timestamp_c const &timecode) {
+  if (idx >= m_generations.size()) {
+    m_generations.resize(idx + 1, 0);
+    m_has_packet.resize(idx + 1, false);
+  }
+
+  ++m_generations[idx];
+  m_has_packet[idx] = true;
+
+  m_heap.push_back({ timecode, idx, m_generations[idx] });
+  std::push_heap(m_heap.begin(), m_heap.end(), is_later);
+}
+
+void
+packetizer_heap_c::remove(std::size_t idx) {
+  if (idx >= m_generations.size())
+    return;
+
+  ++m_generations[idx];
+  m_has_packet[idx] = false;
+}
+
+void
+packetizer_heap_c::drop_outdated_entries() {
+  while (!m_heap.empty()) {
+    auto const &entry = m_heap.front();
+    if (m_has_packet[entry.m_idx] && (m_generations[entry.m_idx] == entry.m_generation))
+      return;
+
+    std::pop_heap(m_heap.begin(), m_heap.end(), is_later);
+    m_heap.pop_back();
+  }
+}
+
+boost::optional<std::size_t>
+packetizer_heap_c::top() {
+  drop_outdated_entries();
+
+  if (m_heap.empty())
+    return boost::none;
+
+  return m_heap.front().m_idx;
+}
+
+void
+packetizer_heap_c::clear() {
+  m_heap.clear();
+  m_generations.clear();
+  m_has_packet.clear();
+}
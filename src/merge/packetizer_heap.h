@@ -0,0 +1,64 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   selection of the packetizer whose packet is output next
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_PACKETIZER_HEAP_H
+#define MTX_MERGE_PACKETIZER_HEAP_H
+
+#include "common/common_pch.h"
+
+#include "common/timestamp.h"
+
+/* Min-heap over the packets the packetizers have ready for output,
+   ordered by their output order timecode. Packetizers are identified by
+   their index in the list of all packetizers. Packetizers with equal
+   timecodes are ordered by their index so that the result is the same
+   as that of a linear search for the first packetizer with the lowest
+   timecode.
+
+   Entries are never removed from the middle of the heap. Instead each
+   packetizer has a generation number that is increased whenever its
+   packet is replaced or removed; entries with an outdated generation
+   are dropped once they reach the top. */
+class packetizer_heap_c {
+protected:
+  struct entry_t {
+    timestamp_c m_timecode;
+    std::size_t m_idx;
+    uint64_t m_generation;
+  };
+
+  std::vector<entry_t> m_heap;
+  std::vector<uint64_t> m_generations;
+  std::vector<bool> m_has_packet;
+
+public:
+  // Packetizer 'idx' has a new packet with the given timecode. Replaces
+  // the packet it had before, if any.
+  void add(std::size_t idx, timestamp_c const &timecode);
+
+  // Packetizer 'idx' doesn't have a packet anymore.
+  void remove(std::size_t idx);
+
+  // Returns the packetizer with the lowest timecode, or none if no
+  // packetizer has a packet.
+  boost::optional<std::size_t> top();
+
+  void clear();
+
+protected:
+  void drop_outdated_entries();
+
+  static bool is_later(entry_t const &a, entry_t const &b);
+};
+
+#endif // MTX_MERGE_PACKETIZER_HEAP_H
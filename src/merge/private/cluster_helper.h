@@ -16,10 +16,12 @@
 #define MTX_MERGE_PRIVATE_CLUSTER_HELPER_H
 
 #include "common/track_statistics.h"
+#include "merge/cluster_writer.h"
 
 class render_groups_c {
 public:
   std::vector<kax_block_blob_cptr> m_groups;
+  std::vector<std::size_t> m_blocks; // indexes into cluster_writer_c's blocks
   std::vector<int64_t> m_durations;
   generic_packetizer_c *m_source;
   bool m_more_data, m_duration_mandatory;
@@ -36,6 +38,7 @@ using render_groups_cptr = std::shared_ptr<render_groups_c>;
 struct cluster_helper_c::impl_t {
 public:
   std::shared_ptr<kax_cluster_c> cluster;
+  cluster_writer_c cluster_writer;
   std::vector<packet_cptr> packets;
   int cluster_content_size{};
   int64_t max_timecode_and_duration{}, max_video_timecode_rendered{};
@@ -13,7 +13,9 @@
 #include "common/common_pch.h"
 
 // #include "common/logger.h"
+#include "common/mm_cached_head_io.h"
 #include "common/mm_mpls_multi_file_io.h"
+#include "common/mm_read_ahead_io.h"
 #include "common/mm_read_buffer_io.h"
 #include "common/strings/formatting.h"
 #include "common/xml/xml.h"
@@ -57,6 +59,7 @@
 #include "input/r_webvtt.h"
 #include "merge/filelist.h"
 #include "merge/input_x.h"
+#include "merge/output_control.h"
 #include "merge/reader_detection_and_creation.h"
 
 static std::vector<bfs::path>
@@ -68,15 +71,25 @@ file_names_to_paths(const std::vector<std::string> &file_names) {
   return paths;
 }
 
+static mm_io_c *
+buffer_input_file(mm_io_c *in) {
+  // The read-ahead size is split into several blocks so that the
+  // background thread can fill some while the reader consumes others.
+  if (g_read_ahead_size)
+    return new mm_read_ahead_io_c(in, std::max<int64_t>(g_read_ahead_size / 4, 4096), 4);
+
+  return new mm_read_buffer_io_c(in, 1 << 17);
+}
+
 static mm_io_cptr
 open_input_file(filelist_t &file) {
   try {
     if (file.all_names.size() == 1)
-      return mm_io_cptr(new mm_read_buffer_io_c(new mm_file_io_c(file.name), 1 << 17));
+      return mm_io_cptr(buffer_input_file(new mm_file_io_c(file.name)));
 
     else {
       std::vector<bfs::path> paths = file_names_to_paths(file.all_names);
-      return mm_io_cptr(new mm_read_buffer_io_c(new mm_multi_file_io_c(paths, file.name), 1 << 17));
+      return mm_io_cptr(buffer_input_file(new mm_multi_file_io_c(paths, file.name)));
     }
 
   } catch (mtx::mm_io::exception &ex) {
@@ -116,10 +129,11 @@ do_probe(Tio &io,
 }
 
 static file_type_e
-detect_text_file_formats(filelist_t const &file) {
+detect_text_file_formats(filelist_t const &file,
+                         mm_io_c *in) {
   auto text_io = mm_text_io_cptr{};
   try {
-    text_io        = std::make_shared<mm_text_io_c>(new mm_file_io_c(file.name));
+    text_io        = in ? std::make_shared<mm_text_io_c>(in, false) : std::make_shared<mm_text_io_c>(new mm_file_io_c(file.name));
     auto text_size = text_io->get_size();
 
     if (do_probe<webvtt_reader_c>(text_io, text_size))
@@ -147,6 +161,71 @@ detect_text_file_formats(filelist_t const &file) {
   return FILE_TYPE_IS_UNKNOWN;
 }
 
+template<typename Treader>
+int
+probe_by_signature(mm_io_c *io,
+                   int64_t size) {
+  return do_probe<Treader>(io, size);
+}
+
+struct file_signature_t {
+  std::vector<std::pair<std::size_t, std::string>> m_magics;
+  file_type_e m_type;
+  int (*m_probe)(mm_io_c *io, int64_t size);
+};
+
+/* Magic bytes of the file types that can be detected unambiguously.
+   A match only determines which reader's probe is run first. */
+static std::vector<file_signature_t> const s_file_signatures{
+  // Not supported
+  { { { 0, "ADIF"             }                  }, FILE_TYPE_AAC,         probe_by_signature<aac_adif_reader_c>    },
+  { { { 0, "\x30\x26\xb2\x75" }                  }, FILE_TYPE_ASF,         probe_by_signature<asf_reader_c>         },
+  { { { 0, "RIFF"             }, { 8, "CDXA" } }, FILE_TYPE_CDXA,        probe_by_signature<cdxa_reader_c>        },
+  { { { 0, "FLV"              }                  }, FILE_TYPE_FLV,         probe_by_signature<flv_reader_c>         },
+  { { { 0, "SP"               }                  }, FILE_TYPE_HDSUB,       probe_by_signature<hdsub_reader_c>       },
+
+  // Supported
+  { { { 0, "RIFF"             }, { 8, "AVI " } }, FILE_TYPE_AVI,         probe_by_signature<avi_reader_c>         },
+  { { { 0, "\x1a\x45\xdf\xa3" }                  }, FILE_TYPE_MATROSKA,    probe_by_signature<kax_reader_c>         },
+  { { { 0, "RIFF"             }, { 8, "WAVE" } }, FILE_TYPE_WAV,         probe_by_signature<wav_reader_c>         },
+  { { { 0, "OggS"             }                  }, FILE_TYPE_OGM,         probe_by_signature<ogm_reader_c>         },
+  { { { 0, "TextST"           }                  }, FILE_TYPE_HDMV_TEXTST, probe_by_signature<hdmv_textst_reader_c> },
+  { { { 0, "fLaC"             }                  }, FILE_TYPE_FLAC,        probe_by_signature<flac_reader_c>        },
+  { { { 0, "PG"               }                  }, FILE_TYPE_PGSSUP,      probe_by_signature<pgssup_reader_c>      },
+  { { { 0, ".RMF"             }                  }, FILE_TYPE_REAL,        probe_by_signature<real_reader_c>        },
+  { { { 4, "ftyp"             }                  }, FILE_TYPE_QTMP4,       probe_by_signature<qtmp4_reader_c>       },
+  { { { 4, "moov"             }                  }, FILE_TYPE_QTMP4,       probe_by_signature<qtmp4_reader_c>       },
+  { { { 4, "mdat"             }                  }, FILE_TYPE_QTMP4,       probe_by_signature<qtmp4_reader_c>       },
+  { { { 4, "pnot"             }                  }, FILE_TYPE_QTMP4,       probe_by_signature<qtmp4_reader_c>       },
+  { { { 4, "wide"             }                  }, FILE_TYPE_QTMP4,       probe_by_signature<qtmp4_reader_c>       },
+  { { { 4, "skip"             }                  }, FILE_TYPE_QTMP4,       probe_by_signature<qtmp4_reader_c>       },
+  { { { 0, "TTA1"             }                  }, FILE_TYPE_TTA,         probe_by_signature<tta_reader_c>         },
+  { { { 0, "wvpk"             }                  }, FILE_TYPE_WAVPACK4,    probe_by_signature<wavpack_reader_c>     },
+  { { { 0, "DKIF"             }                  }, FILE_TYPE_IVF,         probe_by_signature<ivf_reader_c>         },
+  { { { 0, "caff"             }                  }, FILE_TYPE_COREAUDIO,   probe_by_signature<coreaudio_reader_c>   },
+};
+
+static file_type_e
+detect_file_type_by_signature(mm_cached_head_io_c &io,
+                              int64_t size) {
+  static std::size_t const s_signature_size = 16;
+
+  auto head = io.get_head(s_signature_size);
+  auto data = reinterpret_cast<char const *>(head->get_buffer());
+
+  for (auto const &signature : s_file_signatures) {
+    auto matches = std::all_of(signature.m_magics.begin(), signature.m_magics.end(), [&head, data](std::pair<std::size_t, std::string> const &magic) {
+      return ((magic.first + magic.second.size()) <= head->get_size())
+          && !magic.second.compare(0, std::string::npos, data + magic.first, magic.second.size());
+    });
+
+    if (matches && signature.m_probe(&io, size))
+      return signature.m_type;
+  }
+
+  return FILE_TYPE_IS_UNKNOWN;
+}
+
 /** \brief Probe the file type
 
    Opens the input file and calls the \c probe_file function for each known
@@ -154,6 +233,8 @@ detect_text_file_formats(filelist_t const &file) {
 */
 static std::pair<file_type_e, int64_t>
 get_file_type_internal(filelist_t &file) {
+  static std::size_t const s_probe_head_size = 4 * 1024 * 1024;
+
   mm_io_cptr af_io = open_input_file(file);
   mm_io_c *io      = af_io.get();
   int64_t size     = std::min(io->get_size(), static_cast<int64_t>(1 << 25));
@@ -162,6 +243,17 @@ get_file_type_internal(filelist_t &file) {
   if (is_playlist)
     io = file.playlist_mpls_in.get();
 
+  // All probes read from the start of the file over and over again;
+  // only read it from the file once.
+  auto cached_io = std::make_shared<mm_cached_head_io_c>(io, s_probe_head_size, false);
+  io             = cached_io.get();
+
+  // Verify the file type indicated by the magic bytes first so that
+  // the common container formats are found with a single probe.
+  auto type = detect_file_type_by_signature(*cached_io, size);
+  if (FILE_TYPE_IS_UNKNOWN != type)
+    return { type, size };
+
   // File types that can be detected unambiguously but are not supported
   if (do_probe<aac_adif_reader_c>(io, size))
     return { FILE_TYPE_AAC, size };
@@ -207,7 +299,7 @@ get_file_type_internal(filelist_t &file) {
     return { FILE_TYPE_DIRAC, size };
 
   // All text file types (subtitles).
-  auto type = detect_text_file_formats(file);
+  type = detect_text_file_formats(file, !is_playlist && (file.all_names.size() == 1) ? io : nullptr);
 
   if (FILE_TYPE_IS_UNKNOWN != type)
     return { type, size };
@@ -300,149 +392,156 @@ get_file_type(filelist_t &file) {
   file.type     = result.first;
 }
 
-/** \brief Creates the file readers
+/** \brief Creates the file reader for a single file
 
-   For each file the appropriate file reader class is instantiated.
    The newly created class must read all track information in its
    constructor and throw an exception in case of an error. Otherwise
    it is assumed that the file can be handled.
 */
 void
-create_readers() {
+create_reader(filelist_t &file) {
   static auto s_debug_timecode_restrictions = debugging_option_c{"timecode_restrictions"};
 
-  for (auto &file : g_files) {
-    try {
-      mm_io_cptr input_file = file->playlist_mpls_in ? std::static_pointer_cast<mm_io_c>(file->playlist_mpls_in) : open_input_file(*file);
-
-      switch (file->type) {
-        case FILE_TYPE_AAC:
-          file->reader.reset(new aac_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_AC3:
-          file->reader.reset(new ac3_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_AVC_ES:
-          file->reader.reset(new avc_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_HEVC_ES:
-          file->reader.reset(new hevc_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_AVI:
-          file->reader.reset(new avi_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_COREAUDIO:
-          file->reader.reset(new coreaudio_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_DIRAC:
-          file->reader.reset(new dirac_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_DTS:
-          file->reader.reset(new dts_reader_c(*file->ti, input_file));
-          break;
+  try {
+    mm_io_cptr input_file = file.playlist_mpls_in ? std::static_pointer_cast<mm_io_c>(file.playlist_mpls_in) : open_input_file(file);
+
+    switch (file.type) {
+      case FILE_TYPE_AAC:
+        file.reader.reset(new aac_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_AC3:
+        file.reader.reset(new ac3_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_AVC_ES:
+        file.reader.reset(new avc_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_HEVC_ES:
+        file.reader.reset(new hevc_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_AVI:
+        file.reader.reset(new avi_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_COREAUDIO:
+        file.reader.reset(new coreaudio_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_DIRAC:
+        file.reader.reset(new dirac_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_DTS:
+        file.reader.reset(new dts_reader_c(*file.ti, input_file));
+        break;
 #if defined(HAVE_FLAC_FORMAT_H)
-        case FILE_TYPE_FLAC:
-          file->reader.reset(new flac_reader_c(*file->ti, input_file));
-          break;
+      case FILE_TYPE_FLAC:
+        file.reader.reset(new flac_reader_c(*file.ti, input_file));
+        break;
 #endif
-        case FILE_TYPE_FLV:
-          file->reader.reset(new flv_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_HDMV_TEXTST:
-          file->reader.reset(new hdmv_textst_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_IVF:
-          file->reader.reset(new ivf_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MATROSKA:
-          file->reader.reset(new kax_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MP3:
-          file->reader.reset(new mp3_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MPEG_ES:
-          file->reader.reset(new mpeg_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MPEG_PS:
-          file->reader.reset(new mpeg_ps_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_MPEG_TS:
-          file->reader.reset(new mtx::mpeg_ts::reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_OGM:
-          file->reader.reset(new ogm_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_PGSSUP:
-          file->reader.reset(new pgssup_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_QTMP4:
-          file->reader.reset(new qtmp4_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_REAL:
-          file->reader.reset(new real_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_SSA:
-          file->reader.reset(new ssa_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_SRT:
-          file->reader.reset(new srt_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_TRUEHD:
-          file->reader.reset(new truehd_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_TTA:
-          file->reader.reset(new tta_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_USF:
-          file->reader.reset(new usf_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_VC1:
-          file->reader.reset(new vc1_es_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_VOBBTN:
-          file->reader.reset(new vobbtn_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_VOBSUB:
-          file->reader.reset(new vobsub_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_WAV:
-          file->reader.reset(new wav_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_WAVPACK4:
-          file->reader.reset(new wavpack_reader_c(*file->ti, input_file));
-          break;
-        case FILE_TYPE_WEBVTT:
-          file->reader.reset(new webvtt_reader_c(*file->ti, input_file));
-          break;
-        default:
-          mxerror(boost::format(Y("EVIL internal bug! (unknown file type). %1%\n")) % BUGMSG);
-          break;
-      }
-
-      file->reader->read_headers();
-      file->reader->set_timecode_restrictions(file->restricted_timecode_min, file->restricted_timecode_max);
-
-      // Re-calculate file size because the reader might switch to a
-      // multi I/O reader in read_headers().
-      file->size = file->reader->get_file_size();
-
-      mxdebug_if(s_debug_timecode_restrictions,
-                 boost::format("Timecode restrictions for %3%: min %1% max %2%\n") % file->restricted_timecode_min % file->restricted_timecode_max % file->ti->m_fname);
-
-    } catch (mtx::mm_io::open_x &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % Y("The file could not be opened for reading, or there was not enough data to parse its headers."));
-
-    } catch (mtx::input::open_x &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % Y("The file could not be opened for reading, or there was not enough data to parse its headers."));
-
-    } catch (mtx::input::invalid_format_x &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % Y("The file content does not match its format type and was not recognized."));
-
-    } catch (mtx::input::header_parsing_x &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % Y("The file headers could not be parsed, e.g. because they're incomplete, invalid or damaged."));
-
-    } catch (mtx::input::exception &error) {
-      mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file->ti->m_fname % error.error());
+      case FILE_TYPE_FLV:
+        file.reader.reset(new flv_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_HDMV_TEXTST:
+        file.reader.reset(new hdmv_textst_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_IVF:
+        file.reader.reset(new ivf_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MATROSKA:
+        file.reader.reset(new kax_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MP3:
+        file.reader.reset(new mp3_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MPEG_ES:
+        file.reader.reset(new mpeg_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MPEG_PS:
+        file.reader.reset(new mpeg_ps_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_MPEG_TS:
+        file.reader.reset(new mtx::mpeg_ts::reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_OGM:
+        file.reader.reset(new ogm_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_PGSSUP:
+        file.reader.reset(new pgssup_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_QTMP4:
+        file.reader.reset(new qtmp4_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_REAL:
+        file.reader.reset(new real_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_SSA:
+        file.reader.reset(new ssa_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_SRT:
+        file.reader.reset(new srt_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_TRUEHD:
+        file.reader.reset(new truehd_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_TTA:
+        file.reader.reset(new tta_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_USF:
+        file.reader.reset(new usf_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_VC1:
+        file.reader.reset(new vc1_es_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_VOBBTN:
+        file.reader.reset(new vobbtn_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_VOBSUB:
+        file.reader.reset(new vobsub_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_WAV:
+        file.reader.reset(new wav_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_WAVPACK4:
+        file.reader.reset(new wavpack_reader_c(*file.ti, input_file));
+        break;
+      case FILE_TYPE_WEBVTT:
+        file.reader.reset(new webvtt_reader_c(*file.ti, input_file));
+        break;
+      default:
+        mxerror(boost::format(Y("EVIL internal bug! (unknown file type). %1%\n")) % BUGMSG);
+        break;
     }
+
+    file.reader->read_headers();
+    file.reader->set_timecode_restrictions(file.restricted_timecode_min, file.restricted_timecode_max);
+
+    // Re-calculate file size because the reader might switch to a
+    // multi I/O reader in read_headers().
+    file.size = file.reader->get_file_size();
+
+    mxdebug_if(s_debug_timecode_restrictions,
+               boost::format("Timecode restrictions for %3%: min %1% max %2%\n") % file.restricted_timecode_min % file.restricted_timecode_max % file.ti->m_fname);
+
+  } catch (mtx::mm_io::open_x &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % Y("The file could not be opened for reading, or there was not enough data to parse its headers."));
+
+  } catch (mtx::input::open_x &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % Y("The file could not be opened for reading, or there was not enough data to parse its headers."));
+
+  } catch (mtx::input::invalid_format_x &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % Y("The file content does not match its format type and was not recognized."));
+
+  } catch (mtx::input::header_parsing_x &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % Y("The file headers could not be parsed, e.g. because they're incomplete, invalid or damaged."));
+
+  } catch (mtx::input::exception &error) {
+    mxerror(boost::format(Y("The demultiplexer for the file '%1%' failed to initialize:\n%2%\n")) % file.ti->m_fname % error.error());
   }
 }
+
+/** \brief Creates the file readers
+
+   For each file the appropriate file reader class is instantiated.
+*/
+void
+create_readers() {
+  for (auto &file : g_files)
+    create_reader(*file);
+}
@@ -0,0 +1,222 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   running readers on threads of their own
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "merge/generic_packetizer.h"
+#include "merge/generic_reader.h"
+#include "merge/reader_threads.h"
+
+static debugging_option_c s_debug{"reader_threads"};
+static thread_local bool s_is_reader_thread = false;
+
+reader_threads_c::reader_threads_c() {
+}
+
+reader_threads_c::~reader_threads_c() {
+  stop();
+}
+
+bool
+reader_threads_c::is_reader_thread() {
+  return s_is_reader_thread;
+}
+
+void
+reader_threads_c::add_packetizer(generic_packetizer_c &packetizer) {
+  auto &state        = m_packetizers[&packetizer];
+  state.m_packetizer = &packetizer;
+
+  auto itr = std::find_if(m_readers.begin(), m_readers.end(), [&packetizer](std::unique_ptr<reader_state_t> const &reader) { return reader->m_reader == packetizer.m_reader; });
+  if (itr == m_readers.end()) {
+    m_readers.emplace_back(std::make_unique<reader_state_t>());
+    m_readers.back()->m_reader = packetizer.m_reader;
+    itr                        = m_readers.end() - 1;
+  }
+
+  (*itr)->m_packetizers.push_back(&state);
+}
+
+std::size_t
+reader_threads_c::get_num_readers()
+  const {
+  return m_readers.size();
+}
+
+void
+reader_threads_c::start() {
+  mxdebug_if(s_debug, boost::format("reader_threads: starting %1% threads for %2% packetizers\n") % m_readers.size() % m_packetizers.size());
+
+  for (auto &reader : m_readers) {
+    auto reader_ptr  = reader.get();
+    reader->m_thread = std::thread{[this, reader_ptr]() { run(*reader_ptr); }};
+  }
+}
+
+void
+reader_threads_c::stop() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  if (m_stop)
+    return;
+
+  m_stop = true;
+  m_cv.notify_all();
+
+  if (s_is_reader_thread) {
+    // Called from within a reader thread, e.g. when mxerror() is
+    // called while parsing. Joining the other threads might
+    // dead-lock. Wait for them to finish their current read instead
+    // and leave them behind as the process is about to exit anyway.
+    --m_num_active_readers;
+    m_cv.wait(lock, [this]() { return !m_num_active_readers; });
+
+    for (auto &reader : m_readers)
+      if (reader->m_thread.joinable())
+        reader->m_thread.detach();
+
+    return;
+  }
+
+  lock.unlock();
+
+  for (auto &reader : m_readers)
+    if (reader->m_thread.joinable())
+      reader->m_thread.join();
+
+  mxdebug_if(s_debug,
+             boost::format("reader_threads: stopped; reads requested by the main thread: %1% read ahead: %2% main thread waits: %3%\n")
+             % m_num_requested_reads % m_num_read_ahead_reads % m_num_main_thread_waits);
+}
+
+file_status_e
+reader_threads_c::read(generic_packetizer_c &packetizer,
+                       bool force) {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  auto &ptzr = m_packetizers[&packetizer];
+  if (FILE_STATUS_DONE == ptzr.m_status)
+    return FILE_STATUS_DONE;
+
+  ptzr.m_requested = true;
+  ptzr.m_forced    = force;
+
+  // The main thread has taken packets from the queues since the
+  // reader threads last looked at them.
+  for (auto &reader : m_readers)
+    update_queue_states(*reader);
+
+  ++m_num_main_thread_waits;
+  m_main_thread_active = false;
+  m_cv.notify_all();
+
+  m_cv.wait(lock, [this, &ptzr]() { return !ptzr.m_requested || m_exception; });
+
+  m_main_thread_active = true;
+  m_cv.wait(lock, [this]() { return !m_num_active_readers; });
+
+  if (m_exception) {
+    auto exception = m_exception;
+    lock.unlock();
+
+    stop();
+    std::rethrow_exception(exception);
+  }
+
+  return ptzr.m_status;
+}
+
+void
+reader_threads_c::run(reader_state_t &reader) {
+  s_is_reader_thread = true;
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  while (true) {
+    packetizer_state_t *ptzr = nullptr;
+
+    m_cv.wait(lock, [this, &reader, &ptzr]() {
+      return m_stop || (!m_main_thread_active && (ptzr = select_packetizer_to_read_for(reader)));
+    });
+
+    if (m_stop)
+      return;
+
+    auto requested = ptzr->m_requested;
+    auto force     = requested && ptzr->m_forced;
+
+    ++m_num_active_readers;
+    ++(requested ? m_num_requested_reads : m_num_read_ahead_reads);
+
+    lock.unlock();
+
+    auto status    = FILE_STATUS_DONE;
+    auto exception = std::exception_ptr{};
+
+    try {
+      status = ptzr->m_packetizer->read(force);
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    lock.lock();
+
+    ptzr->m_status = status;
+    update_queue_states(reader);
+
+    if (requested && (force || ptzr->m_packet_available || (FILE_STATUS_MOREDATA != status)))
+      ptzr->m_requested = false;
+
+    if (exception && !m_exception)
+      m_exception = exception;
+
+    --m_num_active_readers;
+    m_cv.notify_all();
+
+    if (exception)
+      return;
+  }
+}
+
+reader_threads_c::packetizer_state_t *
+reader_threads_c::select_packetizer_to_read_for(reader_state_t &reader) {
+  for (auto ptzr : reader.m_packetizers)
+    if (ptzr->m_requested)
+      return ptzr;
+
+  packetizer_state_t *candidate = nullptr;
+
+  for (auto ptzr : reader.m_packetizers) {
+    // Reading for one packetizer usually produces packets for the
+    // reader's other packetizers, too. Therefore stop reading ahead
+    // as soon as any of them is full.
+    if (   (ptzr->m_num_queued_packets >= ms_max_queued_packets)
+        || (ptzr->m_num_queued_bytes   >= ms_max_queued_bytes))
+      return nullptr;
+
+    if (   (FILE_STATUS_MOREDATA == ptzr->m_status)
+        && (!candidate || (ptzr->m_num_queued_packets < candidate->m_num_queued_packets)))
+      candidate = ptzr;
+  }
+
+  return candidate;
+}
+
+void
+reader_threads_c::update_queue_states(reader_state_t &reader) {
+  for (auto ptzr : reader.m_packetizers) {
+    ptzr->m_packet_available   = ptzr->m_packetizer->packet_available();
+    ptzr->m_num_queued_packets = ptzr->m_packetizer->get_num_queued_packets();
+    ptzr->m_num_queued_bytes   = ptzr->m_packetizer->get_queued_bytes();
+  }
+}
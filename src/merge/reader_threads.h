@@ -0,0 +1,90 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for running readers on threads of their own
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_READER_THREADS_H
+#define MTX_MERGE_READER_THREADS_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "merge/file_status.h"
+
+class generic_packetizer_c;
+class generic_reader_c;
+
+/* Each reader and its packetizers run on a thread of their own. The
+   threads read ahead until one of the reader's packetizer queues is
+   full, and they read on behalf of the main thread whenever it needs a
+   packet that isn't available yet.
+
+   The main thread and the reader threads never run at the same time:
+   the reader threads are only allowed to run while the main thread is
+   waiting in read(). Winner selection and cluster rendering are
+   therefore still done without any of the reader threads running, and
+   neither the packetizers nor their packet queues need locking of their
+   own. Only code that modifies state shared by all readers (e.g. the
+   output file) has to check is_reader_thread(). */
+class reader_threads_c {
+protected:
+  struct packetizer_state_t {
+    generic_packetizer_c *m_packetizer{};
+    file_status_e m_status{FILE_STATUS_MOREDATA};
+    bool m_packet_available{}, m_requested{}, m_forced{};
+    int64_t m_num_queued_packets{}, m_num_queued_bytes{};
+  };
+
+  struct reader_state_t {
+    generic_reader_c *m_reader{};
+    std::vector<packetizer_state_t *> m_packetizers;
+    std::thread m_thread;
+  };
+
+  static int64_t const ms_max_queued_packets = 512;
+  static int64_t const ms_max_queued_bytes   = 8 * 1024 * 1024;
+
+  std::unordered_map<generic_packetizer_c *, packetizer_state_t> m_packetizers;
+  std::vector<std::unique_ptr<reader_state_t>> m_readers;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_main_thread_active{true}, m_stop{};
+  unsigned int m_num_active_readers{};
+  std::exception_ptr m_exception;
+
+  uint64_t m_num_requested_reads{}, m_num_read_ahead_reads{}, m_num_main_thread_waits{};
+
+public:
+  reader_threads_c();
+  ~reader_threads_c();
+
+  void add_packetizer(generic_packetizer_c &packetizer);
+  std::size_t get_num_readers() const;
+  void start();
+  void stop();
+
+  file_status_e read(generic_packetizer_c &packetizer, bool force);
+
+  static bool is_reader_thread();
+
+protected:
+  void run(reader_state_t &reader);
+  packetizer_state_t *select_packetizer_to_read_for(reader_state_t &reader);
+  void update_queue_states(reader_state_t &reader);
+};
+
+#endif  // MTX_MERGE_READER_THREADS_H
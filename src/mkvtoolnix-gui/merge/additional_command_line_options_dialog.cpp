@@ -44,6 +44,11 @@ AdditionalCommandLineOptionsDialog::AdditionalCommandLineOptionsDialog(QWidget *
   add(Q("--disable-lacing"),                false, global, { QY("Disables lacing for all tracks."), QY("This will increase the file's size, especially if there are many audio tracks."), QY("Use only for testing.") });
   add(Q("--enable-durations"),              false, global, { QY("Write durations for all blocks."), QY("This will increase file size and does not offer any additional value for players at the moment.") });
   add(Q("--disable-track-statistics-tags"), false, global, { QY("Tells mkvmerge not to write tags with statistics for each track.") });
+  add(Q("--parallel-reading"),              false, global, { QY("Tells mkvmerge to read and parse each source file on a thread of its own."),
+                                                             QY("This speeds up multiplexing several source files whose parsing is CPU bound."),
+                                                             QY("It has no effect if there's only a single source file.") });
+  add(Q("--read-ahead-size"),               true,  global, { QY("Sets the amount of data mkvmerge reads ahead from each source file on a background thread."),
+                                                             QY("A size of 0 disables reading ahead.") });
   add(Q("--timecode-scale"),                true,  global,
       { QY("Forces the timecode scale factor to the given value."),
         QY("You have to enter a value between 1000 and 10000000 or the magic value -1."),
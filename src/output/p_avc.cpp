@@ -94,7 +94,7 @@ mpeg4_p10_es_video_packetizer_c::process(packet_cptr packet) {
   try {
     if (packet->has_timecode())
       m_parser.add_timecode(packet->timecode);
-    m_parser.add_bytes(packet->data->get_buffer(), packet->data->get_size());
+    m_parser.add_bytes(packet->data);
     flush_frames();
 
   } catch (mtx::mpeg::nalu_size_length_x &error) {
@@ -200,6 +200,14 @@ mpeg4_p10_es_video_packetizer_c::get_nalu_size_length()
   return m_parser.get_nalu_size_length();
 }
 
+int64_t
+mpeg4_p10_es_video_packetizer_c::get_expected_header_growth()
+  const {
+  // The SPS and PPS making up the codec private data are only known
+  // once the first frames have been parsed.
+  return m_hcodec_private ? 0 : 256;
+}
+
 void
 mpeg4_p10_es_video_packetizer_c::connect(generic_packetizer_c *src,
                                          int64_t p_append_timecode_offset) {
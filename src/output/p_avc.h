@@ -36,6 +36,7 @@ public:
   virtual void set_headers();
   virtual void set_container_default_field_duration(int64_t default_duration);
   virtual unsigned int get_nalu_size_length() const;
+  virtual int64_t get_expected_header_growth() const;
 
   virtual void flush_frames();
 
@@ -89,7 +89,7 @@ hevc_es_video_packetizer_c::process(packet_cptr packet) {
   try {
     if (packet->has_timecode())
       m_parser.add_timecode(packet->timecode);
-    m_parser.add_bytes(packet->data->get_buffer(), packet->data->get_size());
+    m_parser.add_bytes(packet->data);
     flush_frames();
 
   } catch (mtx::mpeg::nalu_size_length_x &error) {
@@ -185,6 +185,14 @@ hevc_es_video_packetizer_c::get_nalu_size_length()
   return m_parser.get_nalu_size_length();
 }
 
+int64_t
+hevc_es_video_packetizer_c::get_expected_header_growth()
+  const {
+  // The VPS, SPS, PPS and SEI NALUs making up the codec private data
+  // are only known once the first frames have been parsed.
+  return m_hcodec_private ? 0 : 512;
+}
+
 void
 hevc_es_video_packetizer_c::connect(generic_packetizer_c *src,
                                          int64_t p_append_timecode_offset) {
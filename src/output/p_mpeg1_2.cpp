@@ -171,6 +171,14 @@ mpeg1_2_video_packetizer_c::remove_stuffing_bytes_and_handle_sequence_headers(pa
   }
 }
 
+int64_t
+mpeg1_2_video_packetizer_c::get_expected_header_growth()
+  const {
+  // The sequence header is stored as the codec private data once it
+  // has been found.
+  return m_hcodec_private ? 0 : 256;
+}
+
 int
 mpeg1_2_video_packetizer_c::process(packet_cptr packet) {
   if (0.0 > m_fps)
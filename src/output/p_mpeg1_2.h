@@ -33,6 +33,7 @@ public:
   virtual ~mpeg1_2_video_packetizer_c();
 
   virtual int process(packet_cptr packet);
+  virtual int64_t get_expected_header_growth() const;
 
   virtual translatable_string_c get_format_name() const {
     return YT("MPEG-1/2");
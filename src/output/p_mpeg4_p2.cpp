@@ -79,6 +79,14 @@ mpeg4_p2_video_packetizer_c::~mpeg4_p2_video_packetizer_c() {
          % m_statistics.m_num_generated_timecodes % m_statistics.m_num_dropped_timecodes);
 }
 
+int64_t
+mpeg4_p2_video_packetizer_c::get_expected_header_growth()
+  const {
+  // Native mode stores the configuration data found in the first
+  // frames as the codec private data.
+  return m_hcodec_private ? 0 : 128;
+}
+
 int
 mpeg4_p2_video_packetizer_c::process(packet_cptr packet) {
   extract_size(packet->data->get_buffer(), packet->data->get_size());
@@ -0,0 +1,25 @@
+#!/usr/bin/ruby -w
+
+# T_605direct_cluster_writer
+describe "mkvmerge / clusters written directly are identical to those rendered by libmatroska"
+
+[ "data/mkv/complex.mkv",
+  "data/avi/v-h264-aac.avi",
+  "data/opus/v-opus.ogg",
+  "data/subtitles/srt/ven.srt",
+  "data/ac3/v.ac3",
+  "data/wavpack4/v.wv",
+  "data/mkv/vobsubs.mks",
+  "--engage lacing_xiph data/ac3/v.ac3",
+  "--engage no_simpleblocks data/avi/v-h264-aac.avi",
+].each do |args|
+  test args do
+    merge args
+    direct = hash_tmp
+
+    merge "--engage no_direct_cluster_writer #{args}"
+    libmatroska = hash_tmp
+
+    direct == libmatroska ? "same" : "different"
+  end
+end
@@ -0,0 +1,48 @@
+#!/usr/bin/ruby -w
+
+# T_606batch_identification
+describe "mkvmerge / identification of several files at once"
+
+files = [
+  "data/mkv/complex.mkv",
+  "data/avi/v-h264-aac.avi",
+  "data/opus/v-opus.ogg",
+  "data/subtitles/srt/ven.srt",
+  "data/ac3/v.ac3",
+  "data/wavpack4/v.wv",
+  "data/mkv/vobsubs.mks",
+]
+
+batch_identify = lambda do |args, exit_code = :success|
+  output, _ = sys("../src/mkvmerge -J --engage no_variable_data #{args}", :exit_code => exit_code)
+  output.map { |line| JSON.load(line) }
+end
+
+test "results in input order match single identifications" do
+  single = files.map { |file| identify_json file }
+  batch  = batch_identify.call(files.join(' '))
+
+  batch == single ? "same" : "different"
+end
+
+test "file list and command line give the same results" do
+  File.open(tmp, "w") { |file| file.write(files.join("\r\n") + "\r\n\r\n") }
+
+  from_list         = batch_identify.call("--identification-file-list #{tmp}")
+  from_command_line = batch_identify.call(files.join(' '))
+
+  from_list == from_command_line ? "same" : "different"
+end
+
+test "number of threads doesn't change the results" do
+  one  = batch_identify.call("--identification-threads 1 #{files.join(' ')}")
+  many = batch_identify.call("--identification-threads 4 #{files.join(' ')}")
+
+  one == many ? "same" : "different"
+end
+
+test "exit code is the highest one of all files" do
+  results = batch_identify.call("#{files[0]} data/does-not-exist.mkv #{files[1]}", :error)
+
+  [ results.size, results.map { |result| result["file_name"] }.join('+'), (results[1]["errors"] || []).empty? ? "no errors" : "errors" ].join('-')
+end
@@ -0,0 +1,66 @@
+#include "common/common_pch.h"
+
+#include <thread>
+
+#include "common/bounded_queue.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(BoundedQueue, OrderAndClosing) {
+  bounded_queue_c<int> queue{4};
+  auto item = 0;
+
+  ASSERT_TRUE(queue.push(1));
+  ASSERT_TRUE(queue.push(2));
+  queue.close();
+
+  ASSERT_TRUE(queue.pop(item));
+  EXPECT_EQ(1, item);
+  ASSERT_TRUE(queue.pop(item));
+  EXPECT_EQ(2, item);
+  EXPECT_FALSE(queue.pop(item));
+}
+
+TEST(BoundedQueue, ProducerAndConsumerThreads) {
+  // Both limits are hit regularly: at most three items or 100 bytes.
+  bounded_queue_c<int> queue{3, 100};
+  auto num_items = 10000;
+  auto sum       = int64_t{};
+
+  std::thread consumer{[&queue, &sum]() {
+    auto item = 0;
+    while (queue.pop(item))
+      sum += item;
+  }};
+
+  for (auto idx = 1; idx <= num_items; ++idx)
+    ASSERT_TRUE(queue.push(idx, idx % 120));
+
+  queue.close();
+  consumer.join();
+
+  EXPECT_EQ(static_cast<int64_t>(num_items) * (num_items + 1) / 2, sum);
+}
+
+TEST(BoundedQueue, OversizedItemsAndAborting) {
+  bounded_queue_c<int> queue{10, 100};
+  auto item = 0;
+
+  // An empty queue accepts an item bigger than the limit.
+  ASSERT_TRUE(queue.push(1, 1000));
+
+  std::thread producer{[&queue]() {
+    // Blocks until the queue is aborted.
+    EXPECT_FALSE(queue.push(2, 10));
+  }};
+
+  queue.abort();
+  producer.join();
+
+  EXPECT_FALSE(queue.pop(item));
+  EXPECT_FALSE(queue.push(3));
+}
+
+}
@@ -1,7 +1,12 @@
 #include "common/common_pch.h"
 
+#include <chrono>
+#include <iostream>
+#include <random>
+
 #include "gtest/gtest.h"
 
+#include "common/bswap.h"
 #include "common/checksums/base.h"
 #include "common/mm_io.h"
 #include "tests/unit/util.h"
@@ -134,4 +139,135 @@ TEST_F(ChecksumTest, FileChunked1000) {
   EXPECT_EQ(*m_data_md5, *calculate_bin(mtx::checksum::algorithm_e::md5,                       1000));
 }
 
+// The straight-forward bit-by-bit implementation for comparison with
+// the table driven and the folding code paths.
+uint32_t
+reference_crc(mtx::checksum::algorithm_e algorithm,
+              unsigned char const *buffer,
+              std::size_t size,
+              uint32_t crc) {
+  auto bits      = algorithm == mtx::checksum::algorithm_e::crc8_atm      ? 8
+                 : algorithm == mtx::checksum::algorithm_e::crc16_ansi    ? 16
+                 : algorithm == mtx::checksum::algorithm_e::crc16_ccitt   ? 16
+                 :                                                          32;
+  auto top_bit   = uint32_t{1} << (bits - 1);
+  auto mask      = bits == 32 ? 0xffffffffu : (uint32_t{1} << bits) - 1;
+  auto poly      = algorithm == mtx::checksum::algorithm_e::crc8_atm    ? 0x07u
+                 : algorithm == mtx::checksum::algorithm_e::crc16_ansi  ? 0x8005u
+                 : algorithm == mtx::checksum::algorithm_e::crc16_ccitt ? 0x1021u
+                 :                                                        0x04C11DB7u;
+
+  if (algorithm == mtx::checksum::algorithm_e::crc32_ieee_le) {
+    for (auto idx = 0u; idx < size; ++idx) {
+      crc ^= buffer[idx];
+      for (auto bit = 0; bit < 8; ++bit)
+        crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320u : 0);
+    }
+
+    return crc;
+  }
+
+  // The other variants keep their register in byte-swapped order.
+  crc = bits == 32 ? mtx::bswap_32(crc) : bits == 16 ? mtx::bswap_16(crc) : crc;
+
+  for (auto idx = 0u; idx < size; ++idx) {
+    crc ^= static_cast<uint32_t>(buffer[idx]) << (bits - 8);
+    for (auto bit = 0; bit < 8; ++bit)
+      crc = ((crc << 1) ^ (crc & top_bit ? poly : 0)) & mask;
+  }
+
+  return bits == 32 ? mtx::bswap_32(crc) : bits == 16 ? mtx::bswap_16(crc) : crc;
+}
+
+std::vector<mtx::checksum::algorithm_e> const s_crc_algorithms{
+  mtx::checksum::algorithm_e::crc8_atm,
+  mtx::checksum::algorithm_e::crc16_ansi,
+  mtx::checksum::algorithm_e::crc16_ccitt,
+  mtx::checksum::algorithm_e::crc32_ieee,
+  mtx::checksum::algorithm_e::crc32_ieee_le,
+};
+
+TEST(Checksum, CrcAllSizesAndAlignments) {
+  auto generator = std::mt19937{42};
+  auto data      = std::vector<unsigned char>(4096 + 16);
+
+  for (auto &byte : data)
+    byte = generator();
+
+  for (auto algorithm : s_crc_algorithms)
+    for (auto offset = 0u; offset < 16; ++offset)
+      for (auto size : std::vector<std::size_t>{ 0, 1, 7, 8, 9, 15, 16, 17, 63, 64, 65, 79, 80, 127, 128, 129, 1000, 4096 }) {
+        auto initial_value = static_cast<uint32_t>(generator());
+        if (algorithm == mtx::checksum::algorithm_e::crc8_atm)
+          initial_value &= 0xff;
+        else if (   (algorithm == mtx::checksum::algorithm_e::crc16_ansi)
+                 || (algorithm == mtx::checksum::algorithm_e::crc16_ccitt))
+          initial_value &= 0xffff;
+
+        EXPECT_EQ(reference_crc(algorithm, &data[offset], size, initial_value), mtx::checksum::calculate_as_uint(algorithm, &data[offset], size, initial_value))
+          << "algorithm " << static_cast<int>(algorithm) << " offset " << offset << " size " << size;
+      }
+}
+
+TEST(Checksum, CrcIncrementalAdds) {
+  auto generator = std::mt19937{23};
+  auto data      = std::vector<unsigned char>(100000);
+
+  for (auto &byte : data)
+    byte = generator();
+
+  for (auto algorithm : s_crc_algorithms) {
+    auto expected = mtx::checksum::calculate_as_uint(algorithm, data.data(), data.size(), 0);
+    auto worker   = mtx::checksum::for_algorithm(algorithm, 0);
+    auto pos      = std::size_t{};
+
+    while (pos < data.size()) {
+      auto size = std::min<std::size_t>(generator() % 300, data.size() - pos);
+      worker->add(&data[pos], size);
+      pos += size;
+    }
+
+    worker->finish();
+
+    EXPECT_EQ(reference_crc(algorithm, data.data(), data.size(), 0), expected);
+    EXPECT_EQ(expected, dynamic_cast<mtx::checksum::uint_result_c &>(*worker).get_result_as_uint());
+  }
+}
+
+// Not run by default. Run with --gtest_also_run_disabled_tests in order
+// to see the throughput of the CRC variants for buffers of the sizes of
+// MPEG TS PSI sections, audio frames and larger blocks.
+TEST(Checksum, DISABLED_BenchmarkCrc) {
+  static auto const s_total_size = std::size_t{256 * 1024 * 1024};
+
+  auto generator = std::mt19937{42};
+  auto data      = std::vector<unsigned char>(1024 * 1024);
+
+  for (auto &byte : data)
+    byte = generator();
+
+  auto run = [&data](mtx::checksum::algorithm_e algorithm, std::size_t block_size) -> double {
+    auto result = uint64_t{};
+    auto start  = std::chrono::steady_clock::now();
+
+    for (auto done = std::size_t{}; done < s_total_size; done += data.size())
+      for (auto pos = std::size_t{}; (pos + block_size) <= data.size(); pos += block_size)
+        result ^= mtx::checksum::calculate_as_uint(algorithm, &data[pos], block_size, 0xffffffff);
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_NE(0u, result + 1);
+
+    return s_total_size / seconds / 1024 / 1024;
+  };
+
+  auto names = std::vector<std::string>{ "crc8_atm", "crc16_ansi", "crc16_ccitt", "crc32_ieee", "crc32_ieee_le" };
+
+  std::cout << boost::format("%|1$-14s| %|2$12s| %|3$12s| %|4$12s|\n") % "algorithm" % "188 B MB/s" % "4 KB MB/s" % "1 MB MB/s";
+
+  for (auto idx = 0u; idx < s_crc_algorithms.size(); ++idx)
+    std::cout << boost::format("%|1$-14s| %|2$12.1f| %|3$12.1f| %|4$12.1f|\n")
+      % names[idx] % run(s_crc_algorithms[idx], 188) % run(s_crc_algorithms[idx], 4096) % run(s_crc_algorithms[idx], 1024 * 1024);
+}
+
 }
@@ -0,0 +1,101 @@
+#include "common/common_pch.h"
+
+#include "gtest/gtest.h"
+
+#include "common/compression.h"
+#include "common/mm_io.h"
+
+namespace {
+
+std::string
+gzip(std::string const &data) {
+  z_stream stream;
+
+  stream.zalloc = (alloc_func)0;
+  stream.zfree  = (free_func)0;
+  stream.opaque = (voidpf)0;
+  deflateInit2(&stream, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY); // 16: write a gzip header
+
+  auto compressed   = std::string(deflateBound(&stream, data.size()) + 32, '\0');
+  stream.next_in    = reinterpret_cast<Bytef *>(const_cast<char *>(data.c_str()));
+  stream.avail_in   = data.size();
+  stream.next_out   = reinterpret_cast<Bytef *>(&compressed[0]);
+  stream.avail_out  = compressed.size();
+
+  deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return compressed;
+}
+
+TEST(CompressionZlib, RoundTripsWithReusedStreams) {
+  zlib_compressor_c compressor;
+  auto content = mm_file_io_c::slurp("tests/unit/data/text/chapters-with-ebmlvoid.xml")->to_string();
+
+  for (auto const &data : std::vector<std::string>{ content, "", "a", content.substr(100), std::string(1024 * 1024, 'x') }) {
+    auto compressed = compressor.compress(data);
+
+    EXPECT_EQ(data, compressor.decompress(compressed));
+  }
+}
+
+TEST(CompressionZlib, ReusedStreamsProduceIdenticalOutput) {
+  zlib_compressor_c reused;
+  auto content = mm_file_io_c::slurp("tests/unit/data/text/chapters-with-ebmlvoid.xml")->to_string();
+
+  reused.compress(std::string(5000, 'y'));
+
+  EXPECT_EQ(zlib_compressor_c{}.compress(content), reused.compress(content));
+}
+
+TEST(CompressionZlib, HighlyCompressibleData) {
+  zlib_compressor_c compressor;
+
+  // Expands far beyond the initial output buffer size.
+  auto data       = std::string(16 * 1024 * 1024, '\0');
+  auto compressed = compressor.compress(data);
+
+  EXPECT_GT(data.size() / 100, compressed.size());
+  EXPECT_EQ(data, compressor.decompress(compressed));
+}
+
+TEST(CompressionZlib, GzipInput) {
+  zlib_compressor_c compressor;
+  auto data = std::string{};
+
+  for (auto idx = 0; idx < 100000; ++idx)
+    data += static_cast<char>('a' + (idx % 7));
+
+  EXPECT_EQ(data, compressor.decompress(gzip(data)));
+  EXPECT_EQ("abc",  compressor.decompress(gzip("abc")));
+}
+
+TEST(CompressionZlib, BrokenInput) {
+  zlib_compressor_c compressor;
+
+  EXPECT_THROW(compressor.decompress(std::string{"this is not compressed"}), mtx::compression_x);
+
+  // The stream must still be usable afterwards.
+  EXPECT_EQ("chunky bacon", compressor.decompress(compressor.compress(std::string{"chunky bacon"})));
+}
+
+TEST(CompressionZlib, Levels) {
+  auto data = std::string{};
+  for (auto idx = 0; idx < 100000; ++idx)
+    data += static_cast<char>('a' + ((idx * 7) % 13));
+
+  zlib_compressor_c compressor;
+  auto best = compressor.compress(data);
+
+  compressor.set_compression_level(0);
+  auto stored = compressor.compress(data);
+
+  EXPECT_GT(stored.size(), data.size());
+  EXPECT_LT(best.size(),   stored.size());
+  EXPECT_EQ(data, compressor.decompress(stored));
+  EXPECT_EQ(best, zlib_compressor_c{9}.compress(data));
+  EXPECT_EQ(best, zlib_compressor_c{}.compress(data));
+}
+
+}
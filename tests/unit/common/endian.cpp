@@ -1,6 +1,11 @@
 #include "common/common_pch.h"
 
+#include <chrono>
+#include <iostream>
+#include <random>
+
 #include "common/endian.h"
+#include "common/mm_io.h"
 
 #include "gtest/gtest.h"
 
@@ -194,4 +199,84 @@ TEST(Endian, PutUIntXYLE) {
   EXPECT_EQ(0, std::memcmp(buffer, resle8, 8));
 }
 
+TEST(Endian, GetUIntBEArray) {
+  auto generator = std::mt19937{42};
+  auto buffer    = std::vector<unsigned char>(8 * 100 + 1);
+
+  for (auto &byte : buffer)
+    byte = generator() % 256;
+
+  // All counts up to several vector widths plus an unaligned source.
+  for (auto offset = 0u; offset < 2; ++offset) {
+    auto src = &buffer[offset];
+
+    for (auto count = 0u; count <= 100; ++count) {
+      std::vector<uint32_t> values32(count);
+      std::vector<uint64_t> values64(count);
+
+      get_uint32_be_array(values32.data(), src, count);
+      get_uint64_be_array(values64.data(), src, count);
+
+      for (auto idx = 0u; idx < count; ++idx) {
+        ASSERT_EQ(get_uint32_be(src + idx * 4), values32[idx]);
+        ASSERT_EQ(get_uint64_be(src + idx * 8), values64[idx]);
+      }
+    }
+  }
+}
+
+TEST(Endian, GetUIntBEArrayInPlace) {
+  std::vector<uint32_t> values32(37);
+  std::vector<uint64_t> values64(37);
+
+  for (auto idx = 0u; idx < values32.size(); ++idx) {
+    put_uint32_be(&values32[idx], idx * 0x01020304u);
+    put_uint64_be(&values64[idx], idx * 0x0102030405060708ull);
+  }
+
+  get_uint32_be_array(values32.data(), values32.data(), values32.size());
+  get_uint64_be_array(values64.data(), values64.data(), values64.size());
+
+  for (auto idx = 0u; idx < values32.size(); ++idx) {
+    EXPECT_EQ(idx * 0x01020304u,            values32[idx]);
+    EXPECT_EQ(idx * 0x0102030405060708ull, values64[idx]);
+  }
+}
+
+// Not run by default. Run with --gtest_also_run_disabled_tests in order
+// to compare reading the sample size table (stsz) of a large MP4 moov
+// atom entry by entry with reading it in bulk.
+TEST(Endian, DISABLED_Benchmark) {
+  auto run = [](std::size_t num_entries, bool bulk) -> double {
+    auto table = memory_c::alloc(num_entries * 4);
+    for (auto idx = 0u; idx < num_entries; ++idx)
+      put_uint32_be(table->get_buffer() + idx * 4, idx % 100000);
+
+    mm_mem_io_c in{*table};
+
+    auto sizes = std::vector<uint32_t>{};
+    auto start = std::chrono::steady_clock::now();
+
+    if (bulk) {
+      sizes.resize(num_entries);
+      in.read(sizes.data(), num_entries * 4);
+      get_uint32_be_array(sizes.data(), sizes.data(), num_entries);
+
+    } else
+      for (auto idx = 0u; idx < num_entries; ++idx)
+        sizes.push_back(in.read_uint32_be());
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ((num_entries - 1) % 100000, sizes.back());
+
+    return num_entries / seconds / 1000000;
+  };
+
+  std::cout << boost::format("%|1$9s| %|2$21s| %|3$18s|\n") % "entries" % "per entry Mentries/s" % "bulk Mentries/s";
+
+  for (auto num_entries : std::vector<std::size_t>{ 1000, 10000, 100000, 1000000, 10000000 })
+    std::cout << boost::format("%|1$9d| %|2$21.1f| %|3$18.1f|\n") % num_entries % run(num_entries, false) % run(num_entries, true);
+}
+
 }
@@ -0,0 +1,190 @@
+#include "common/common_pch.h"
+
+#include "common/kax_cluster_parser.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Only sizes below 127 bytes are needed here.
+std::string
+element(std::string const &id,
+        std::string const &content) {
+  return id + static_cast<char>(0x80 | content.size()) + content;
+}
+
+std::string const s_timecode{"\xe7"}, s_simple_block{"\xa3"}, s_block_group{"\xa0"}, s_block{"\xa1"}, s_block_duration{"\x9b"}, s_reference_block{"\xfb"};
+std::string const s_codec_state{"\xa4"}, s_discard_padding{"\x75\xa2"}, s_block_additions{"\x75\xa1"}, s_block_more{"\xa6"}, s_block_additional{"\xa5"};
+
+std::string
+as_string(kax_cluster_parser_c::frame_t const &frame) {
+  return { reinterpret_cast<char const *>(frame.m_data), frame.m_size };
+}
+
+TEST(KaxClusterParser, SimpleBlocksAndBlockGroups) {
+  auto content = element(s_simple_block, std::string{"\x81\x00\x02\x80" "abc", 7})
+               + element(s_timecode,     std::string{"\x03\xe8", 2})
+               + element(s_block_group,
+                           element(s_block,             std::string{"\x82\xff\xfe\x00" "de", 6})
+                         + element(s_reference_block,   std::string{"\xfc", 1})
+                         + element(s_block_duration,    std::string{"\x28", 1})
+                         + element(s_reference_block,   std::string{"\x01\x00", 2})
+                         + element(s_codec_state,       "state")
+                         + element(s_discard_padding,   std::string{"\xfb", 1})
+                         + element(s_block_additions,
+                                     element(s_block_more, element(s_block_additional, "add1"))
+                                   + element(s_block_more, std::string{"\xee\x81\x03", 3})))
+               + element(s_block_group, element(s_block_duration, std::string{"\x01", 1}))
+               + element(s_simple_block, std::string{"\x81\x00\x05\x01" "f", 5});
+
+  kax_cluster_parser_c parser;
+  parser.set_timecode_scale(1000);
+
+  ASSERT_TRUE(parser.parse(reinterpret_cast<unsigned char *>(&content[0]), content.size()));
+  EXPECT_EQ(1000u, parser.get_cluster_timecode());
+
+  // The timecode may come after the first block.
+  auto block = parser.next_block();
+  ASSERT_NE(nullptr, block);
+  EXPECT_TRUE(block->m_simple);
+  EXPECT_TRUE(block->m_key_frame);
+  EXPECT_FALSE(block->m_discardable);
+  EXPECT_EQ(1u,      block->m_track_num);
+  EXPECT_EQ(1002000, block->m_timecode);
+  ASSERT_EQ(1u,      block->m_num_frames);
+  ASSERT_EQ(1u,      block->m_frames.size());
+  EXPECT_EQ("abc",   as_string(block->m_frames[0]));
+  EXPECT_FALSE(block->m_duration);
+
+  block = parser.next_block();
+  ASSERT_NE(nullptr, block);
+  EXPECT_FALSE(block->m_simple);
+  EXPECT_FALSE(block->m_key_frame);
+  EXPECT_EQ(2u,      block->m_track_num);
+  EXPECT_EQ(998000,  block->m_timecode);
+  ASSERT_EQ(1u,      block->m_frames.size());
+  EXPECT_EQ("de",    as_string(block->m_frames[0]));
+  ASSERT_TRUE(!!block->m_duration);
+  EXPECT_EQ(40u,     *block->m_duration);
+  EXPECT_EQ((std::vector<int64_t>{ -4, 256 }), block->m_references);
+  ASSERT_TRUE(!!block->m_codec_state);
+  EXPECT_EQ("state", as_string(*block->m_codec_state));
+  ASSERT_TRUE(!!block->m_discard_padding);
+  EXPECT_EQ(-5,      *block->m_discard_padding);
+  ASSERT_EQ(2u,      block->m_block_additions.size());
+  EXPECT_EQ("add1",  as_string(block->m_block_additions[0]));
+  EXPECT_EQ(0u,      block->m_block_additions[1].m_size);
+
+  // BlockGroups without a Block are skipped.
+  block = parser.next_block();
+  ASSERT_NE(nullptr, block);
+  EXPECT_TRUE(block->m_simple);
+  EXPECT_FALSE(block->m_key_frame);
+  EXPECT_TRUE(block->m_discardable);
+  EXPECT_FALSE(block->m_duration);
+  EXPECT_TRUE(block->m_references.empty());
+  EXPECT_TRUE(block->m_block_additions.empty());
+
+  EXPECT_EQ(nullptr, parser.next_block());
+}
+
+TEST(KaxClusterParser, Lacing) {
+  // Xiph lacing: 300 bytes, 2 bytes, rest (3 bytes)
+  auto xiph_header = std::string{"\x81\x00\x00\x82\x02\xff\x2d\x02", 8};
+  auto xiph_frames = std::string(300, 'x') + "yyzzz";
+
+  // EBML lacing: 2 bytes, 3 bytes (+1), rest (1 byte)
+  auto ebml_header = std::string{"\x81\x00\x00\x86\x02\x82\xc0", 7};
+  auto ebml_frames = std::string{"aabbbc"};
+
+  // Fixed-size lacing: 3 frames with 2 bytes each
+  auto fixed_header = std::string{"\x81\x00\x00\x84\x02", 5};
+  auto fixed_frames = std::string{"ddeeff"};
+
+  for (auto const &laced : std::vector<std::pair<std::string, std::vector<std::string>>>{
+      { xiph_header  + xiph_frames,  { std::string(300, 'x'), "yy", "zzz" } },
+      { ebml_header  + ebml_frames,  { "aa", "bbb", "c" } },
+      { fixed_header + fixed_frames, { "dd", "ee", "ff" } },
+    }) {
+    // Sizes of 127 bytes and more need two bytes.
+    auto size    = laced.first.size();
+    auto content = s_simple_block + (size < 127 ? std::string(1, static_cast<char>(0x80 | size)) : std::string{static_cast<char>(0x40 | (size >> 8)), static_cast<char>(size & 0xff)}) + laced.first;
+
+    kax_cluster_parser_c parser;
+    ASSERT_TRUE(parser.parse(reinterpret_cast<unsigned char *>(&content[0]), content.size()));
+
+    auto block = parser.next_block();
+    ASSERT_NE(nullptr, block);
+    ASSERT_EQ(3u, block->m_num_frames);
+    ASSERT_EQ(3u, block->m_frames.size());
+
+    for (auto idx = 0u; idx < 3; ++idx)
+      EXPECT_EQ(laced.second[idx], as_string(block->m_frames[idx]));
+  }
+}
+
+TEST(KaxClusterParser, UnwantedTracks) {
+  auto content = element(s_simple_block, std::string{"\x81\x00\x00\x82\x01\x02" "abc", 9})
+               + element(s_simple_block, std::string{"\x82\x00\x00\x80" "d", 5});
+
+  kax_cluster_parser_c parser;
+  parser.set_track_wanted_callback([](uint64_t track_num) { return 2 == track_num; });
+
+  ASSERT_TRUE(parser.parse(reinterpret_cast<unsigned char *>(&content[0]), content.size()));
+
+  auto block = parser.next_block();
+  ASSERT_NE(nullptr, block);
+  EXPECT_EQ(2u, block->m_num_frames);
+  EXPECT_TRUE(block->m_frames.empty());
+
+  block = parser.next_block();
+  ASSERT_NE(nullptr, block);
+  ASSERT_EQ(1u, block->m_frames.size());
+  EXPECT_EQ("d", as_string(block->m_frames[0]));
+}
+
+TEST(KaxClusterParser, InvalidStructure) {
+  kax_cluster_parser_c parser;
+
+  // Unknown size
+  auto content = s_simple_block + std::string{"\xff\x81\x00\x00\x80", 5};
+  EXPECT_FALSE(parser.parse(reinterpret_cast<unsigned char *>(&content[0]), content.size()));
+
+  // Size exceeds the cluster
+  content = s_timecode + std::string{"\x85\x00", 2};
+  EXPECT_FALSE(parser.parse(reinterpret_cast<unsigned char *>(&content[0]), content.size()));
+
+  // Size of a BlockGroup's child exceeds the BlockGroup
+  content = element(s_block_group, s_block + std::string{"\x88\x81\x00\x00", 4});
+  EXPECT_FALSE(parser.parse(reinterpret_cast<unsigned char *>(&content[0]), content.size()));
+
+  // Laced frames exceed the block
+  content = element(s_simple_block, std::string{"\x81\x00\x00\x82\x01\x10" "a", 7});
+  ASSERT_TRUE(parser.parse(reinterpret_cast<unsigned char *>(&content[0]), content.size()));
+  EXPECT_EQ(nullptr, parser.next_block());
+}
+
+TEST(KaxClusterParser, InvalidBlocksAreSkipped) {
+  auto content = element(s_simple_block, std::string{"\x81\x00\x00\x80" "a", 5})
+               + element(s_simple_block, std::string{"\x81\x00\x01\x82\x02\x10\x20" "bc", 9}) // Xiph laced frames exceed the block
+               + element(s_block_group,  element(s_block, std::string{"\x81\x00", 2}))            // block header too short
+               + element(s_simple_block, std::string{"\x81\x00\x01\x86\x01", 5})              // EBML lacing header too short
+               + element(s_simple_block, std::string{"\x81\x00\x02\x80" "f", 5});
+
+  kax_cluster_parser_c parser;
+  ASSERT_TRUE(parser.parse(reinterpret_cast<unsigned char *>(&content[0]), content.size()));
+
+  auto block = parser.next_block();
+  ASSERT_NE(nullptr, block);
+  ASSERT_EQ(1u, block->m_frames.size());
+  EXPECT_EQ("a", as_string(block->m_frames[0]));
+
+  block = parser.next_block();
+  ASSERT_NE(nullptr, block);
+  ASSERT_EQ(1u, block->m_frames.size());
+  EXPECT_EQ("f", as_string(block->m_frames[0]));
+
+  EXPECT_EQ(nullptr, parser.next_block());
+}
+
+}
@@ -0,0 +1,153 @@
+#include "common/common_pch.h"
+
+#include "common/memory.h"
+#include "common/memory_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(Memory, View) {
+  auto parent = memory_c::clone("Hello world", 11);
+  auto view   = memory_c::view(*parent, 6, 5);
+
+  EXPECT_TRUE(view->is_view());
+  EXPECT_FALSE(parent->is_view());
+  EXPECT_EQ(parent->get_buffer() + 6, view->get_buffer());
+  EXPECT_EQ(std::string{"world"}, view->to_string());
+
+  parent.reset();
+  EXPECT_EQ(std::string{"world"}, view->to_string());
+
+  auto view_of_view = memory_c::view(*view, 1, 3);
+  view.reset();
+  EXPECT_EQ(std::string{"orl"}, view_of_view->to_string());
+
+  view_of_view->set_size(2);
+  EXPECT_EQ(std::string{"or"}, view_of_view->to_string());
+}
+
+TEST(Memory, ViewDetaching) {
+  auto parent = memory_c::clone("Hello world", 11);
+  auto view   = memory_c::view(*parent, 0, 5);
+
+  view->grab();
+  EXPECT_FALSE(view->is_view());
+  EXPECT_NE(parent->get_buffer(), view->get_buffer());
+  EXPECT_EQ(std::string{"Hello"}, view->to_string());
+
+  auto other_view = memory_c::view(*parent, 6, 5);
+  other_view->resize(6);
+  other_view->get_buffer()[5] = '!';
+
+  EXPECT_FALSE(other_view->is_view());
+  EXPECT_EQ(std::string{"world!"}, other_view->to_string());
+  EXPECT_EQ(std::string{"Hello world"}, parent->to_string());
+}
+
+TEST(MemorySliceCursor, GetViewOrCopy) {
+  memory_slice_cursor_c cursor;
+  std::string not_owned{"0123"};
+
+  cursor.add_slice(memory_c::clone("abcdef", 6));
+  cursor.add_slice(reinterpret_cast<unsigned char *>(&not_owned[0]), not_owned.size());
+
+  auto mem = cursor.get_view_or_copy(1, 4);
+  EXPECT_TRUE(mem->is_view());
+  EXPECT_EQ(std::string{"bcde"}, mem->to_string());
+
+  mem = cursor.get_view_or_copy(4, 4);
+  EXPECT_FALSE(mem->is_view());
+  EXPECT_EQ(std::string{"ef01"}, mem->to_string());
+
+  mem = cursor.get_view_or_copy(7, 2);
+  EXPECT_FALSE(mem->is_view());
+  EXPECT_EQ(std::string{"12"}, mem->to_string());
+}
+
+TEST(MemoryPool, ClassSizes) {
+  using pool_c = mtx::mem::pool_c;
+
+  EXPECT_EQ(64u,      pool_c::get_class_size(0));
+  EXPECT_EQ(64u,      pool_c::get_class_size(64));
+  EXPECT_EQ(80u,      pool_c::get_class_size(65));
+  EXPECT_EQ(128u,     pool_c::get_class_size(128));
+  EXPECT_EQ(160u,     pool_c::get_class_size(129));
+  EXPECT_EQ(1280u,    pool_c::get_class_size(1025));
+  EXPECT_EQ(1048576u, pool_c::get_class_size(1048576));
+  EXPECT_EQ(0u,       pool_c::get_class_size(1048577));
+
+  for (auto size = 1u; size <= 300000; size += 97) {
+    auto class_size = pool_c::get_class_size(size);
+    EXPECT_LE(size, class_size);
+    EXPECT_GE(size + size / 4 + 64, class_size);
+    EXPECT_EQ(class_size, pool_c::get_class_size(class_size));
+  }
+}
+
+TEST(MemoryPool, ReusesReleasedBuffers) {
+  auto pool     = std::make_unique<mtx::mem::pool_c>();
+  auto capacity = std::size_t{};
+  auto buffer   = pool->allocate(1000, capacity);
+
+  EXPECT_EQ(1024u, capacity);
+  pool->release(buffer, capacity);
+
+  auto other_capacity = std::size_t{};
+  EXPECT_EQ(buffer, pool->allocate(900, other_capacity));
+  EXPECT_EQ(capacity, other_capacity);
+  pool->release(buffer, capacity);
+
+  auto big = pool->allocate(2 * 1024 * 1024, capacity);
+  EXPECT_EQ(0u, capacity);
+  pool->release(big, capacity);
+
+  auto stats = pool->get_statistics();
+  EXPECT_EQ(3u,    stats.m_num_allocations);
+  EXPECT_EQ(1u,    stats.m_num_reused);
+  EXPECT_EQ(1u,    stats.m_num_malloced);
+  EXPECT_EQ(1u,    stats.m_num_unpooled);
+  EXPECT_EQ(2u,    stats.m_num_cached);
+  EXPECT_EQ(1024u, stats.m_cached_bytes);
+
+  pool->trim();
+  EXPECT_EQ(0u, pool->get_statistics().m_cached_bytes);
+}
+
+TEST(MemoryPool, SteadyStateWithoutMalloc) {
+  auto &pool = mtx::mem::pool_c::get();
+
+  for (auto round = 0; round < 2; ++round) {
+    auto before  = pool.get_statistics();
+    auto packets = std::vector<memory_cptr>{};
+
+    for (auto idx = 0u; idx < 100; ++idx) {
+      packets.push_back(memory_c::alloc(100 + idx * 37));
+      packets.push_back(memory_c::clone(packets.back()->get_buffer(), packets.back()->get_size()));
+    }
+
+    packets.clear();
+
+    if (round)
+      EXPECT_EQ(before.m_num_malloced, pool.get_statistics().m_num_malloced);
+  }
+}
+
+TEST(MemoryPool, PooledBufferResizing) {
+  auto mem = memory_c::clone("Hello", 5);
+  auto ptr = mem->get_buffer();
+
+  mem->add(reinterpret_cast<unsigned char const *>(" world"), 6);
+  EXPECT_EQ(ptr, mem->get_buffer());
+  EXPECT_EQ(std::string{"Hello world"}, mem->to_string());
+
+  auto big = std::string(1000, 'x');
+  mem->add(reinterpret_cast<unsigned char const *>(big.c_str()), big.size());
+  EXPECT_EQ(std::string{"Hello world"} + big, mem->to_string());
+
+  mem->set_offset(6);
+  mem->resize(5);
+  EXPECT_EQ(std::string{"world"}, mem->to_string());
+}
+
+}
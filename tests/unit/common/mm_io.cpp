@@ -1,9 +1,16 @@
 #include "common/common_pch.h"
 
+#include <atomic>
+
 #include "gtest/gtest.h"
 #include "tests/unit/util.h"
 
+#include "common/mm_async_write_buffer_io.h"
+#include "common/mm_cached_head_io.h"
 #include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
+#include "common/mm_read_ahead_io.h"
+#include "common/mm_read_buffer_io.h"
 
 namespace {
 
@@ -16,4 +23,331 @@ TEST(MmIo, Slurp) {
   ASSERT_THROW(mm_file_io_c::slurp("doesnotexist"), mtx::mm_io::exception);
 }
 
+TEST(MmIo, AsyncWriteBuffer) {
+  auto reference = std::make_shared<mm_mem_io_c>(nullptr, 0, 1024);
+  auto target    = std::make_shared<mm_mem_io_c>(nullptr, 0, 1024);
+  auto async     = std::make_shared<mm_async_write_buffer_io_c>(target.get(), 100, 3, false);
+  auto data      = std::string{};
+
+  for (auto idx = 0; idx < 1000; ++idx)
+    data += static_cast<char>('a' + (idx % 26));
+
+  for (auto out : std::vector<mm_io_c *>{ reference.get(), async.get() }) {
+    out->write(data);
+
+    // Back-patching the beginning and the middle
+    out->save_pos(3);
+    out->write(std::string{"HEADER"});
+    out->restore_pos();
+
+    out->setFilePointer(-500, seek_end);
+    out->write(std::string{"middle"});
+    EXPECT_EQ(506u, out->getFilePointer());
+
+    // Reading back written data, extending the file
+    out->setFilePointer(100);
+    auto read_back = std::string{};
+    EXPECT_EQ(10u, out->read(read_back, 10));
+    EXPECT_EQ(data.substr(100, 10), read_back);
+
+    out->setFilePointer(0, seek_end);
+    EXPECT_EQ(1000u, out->getFilePointer());
+    out->write(data.substr(0, 250));
+    EXPECT_EQ(1250, out->get_size());
+  }
+
+  async->close();
+
+  EXPECT_EQ(reference->get_content(), target->get_content());
+  EXPECT_EQ(1250u, target->get_content().size());
+}
+
+TEST(MmIo, InsertRange) {
+  mm_mem_io_c mem{nullptr, 0, 1024};
+  mem.write(std::string{"data"});
+  EXPECT_FALSE(mem.insert_range(0, 4096));
+  EXPECT_EQ(4, mem.get_size());
+
+  auto file_name = (bfs::temp_directory_path() / bfs::unique_path("mtx-unit-tests-%%%%-%%%%-%%%%")).string();
+  auto data      = std::string{};
+
+  for (auto idx = 0; idx < 3 * 4096; ++idx)
+    data += static_cast<char>('a' + (idx % 26));
+
+  auto out        = std::make_shared<mm_async_write_buffer_io_c>(new mm_file_io_c{file_name, MODE_CREATE}, 1000, 3);
+  auto block_size = out->get_fs_block_size();
+
+  out->write(data);
+
+  // Not supported by all file systems; the file must remain untouched
+  // in that case.
+  auto inserted = block_size && ((data.size() % block_size) == 0) && out->insert_range(block_size, block_size);
+  auto expected = !inserted ? data : data.substr(0, block_size) + std::string(block_size, '\0') + data.substr(block_size);
+
+  EXPECT_EQ(static_cast<int64_t>(expected.size()), out->get_size());
+
+  out->setFilePointer(0, seek_end);
+  out->write(std::string{"end"});
+  out->close();
+
+  EXPECT_EQ(expected + "end", mm_file_io_c::slurp(file_name)->to_string());
+
+  bfs::remove(file_name);
+}
+
+TEST(MmIo, ReadAhead) {
+  auto data   = std::string{};
+  auto source = std::make_shared<mm_mem_io_c>(nullptr, 0, 1024);
+
+  for (auto idx = 0; idx < 1000; ++idx)
+    data += static_cast<char>('a' + (idx % 26));
+
+  source->write(data);
+
+  auto in        = std::make_shared<mm_read_ahead_io_c>(source.get(), 64, 3, false);
+  auto read_back = std::string{};
+
+  EXPECT_EQ(1000, in->get_size());
+
+  // Sequential reads spanning several blocks
+  EXPECT_EQ(10u, in->read(read_back, 10));
+  EXPECT_EQ(data.substr(0, 10), read_back);
+  EXPECT_EQ(150u, in->read(read_back, 150));
+  EXPECT_EQ(data.substr(10, 150), read_back);
+  EXPECT_EQ(160u, in->getFilePointer());
+
+  // Seeking backwards and far ahead
+  in->setFilePointer(5);
+  EXPECT_EQ(20u, in->read(read_back, 20));
+  EXPECT_EQ(data.substr(5, 20), read_back);
+
+  in->setFilePointer(-100, seek_end);
+  EXPECT_EQ(50u, in->read(read_back, 50));
+  EXPECT_EQ(data.substr(900, 50), read_back);
+
+  in->setFilePointer(-30, seek_current);
+  EXPECT_EQ(30u, in->read(read_back, 30));
+  EXPECT_EQ(data.substr(920, 30), read_back);
+
+  // Reading beyond the end
+  EXPECT_FALSE(in->eof());
+  EXPECT_EQ(50u, in->read(read_back, 100));
+  EXPECT_EQ(data.substr(950, 50), read_back);
+  EXPECT_TRUE(in->eof());
+
+  in->setFilePointer(2000);
+  EXPECT_EQ(1000u, in->getFilePointer());
+  EXPECT_FALSE(in->eof());
+
+  // Reading without buffering
+  in->setFilePointer(300);
+  in->enable_buffering(false);
+  EXPECT_EQ(300u, in->getFilePointer());
+  EXPECT_EQ(40u, in->read(read_back, 40));
+  EXPECT_EQ(data.substr(300, 40), read_back);
+
+  in->enable_buffering(true);
+  EXPECT_EQ(340u, in->getFilePointer());
+  EXPECT_EQ(500u, in->read(read_back, 500));
+  EXPECT_EQ(data.substr(340, 500), read_back);
+}
+
+// Fails reading from [512, 576) and seeking to 800 and beyond until
+// told otherwise.
+class failing_mem_io_c: public mm_mem_io_c {
+public:
+  std::atomic<bool> m_fail{true};
+
+  failing_mem_io_c(memory_c const &mem)
+    : mm_mem_io_c{mem}
+  {
+  }
+
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning) override {
+    if (m_fail && (seek_beginning == mode) && (800 <= offset))
+      throw mtx::mm_io::seek_x{};
+    mm_mem_io_c::setFilePointer(offset, mode);
+  }
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size) override {
+    auto position = getFilePointer();
+    if (m_fail && (512 <= position) && (576 > position))
+      throw mtx::mm_io::read_write_x{};
+    return mm_mem_io_c::_read(buffer, size);
+  }
+};
+
+TEST(MmIo, ReadAheadErrors) {
+  auto data = std::string{};
+
+  for (auto idx = 0; idx < 1000; ++idx)
+    data += static_cast<char>('a' + (idx % 26));
+
+  auto content   = memory_c::clone(data);
+  auto source    = std::make_shared<failing_mem_io_c>(*content);
+  auto in        = std::make_shared<mm_read_ahead_io_c>(source.get(), 64, 3, false);
+  auto read_back = std::string{};
+
+  // Everything before the failing block is still available.
+  EXPECT_EQ(512u, in->read(read_back, 512));
+  EXPECT_EQ(data.substr(0, 512), read_back);
+
+  // The error is thrown on this thread instead of being reported as the
+  // end of the file.
+  EXPECT_THROW(in->read(read_back, 10), mtx::mm_io::read_write_x);
+  EXPECT_EQ(512u, in->getFilePointer());
+  EXPECT_FALSE(in->eof());
+
+  // Errors from seeking are reported, too.
+  in->setFilePointer(900);
+  EXPECT_THROW(in->read(read_back, 10), mtx::mm_io::seek_x);
+
+  // Accessing the same position again retries.
+  source->m_fail = false;
+
+  EXPECT_EQ(10u, in->read(read_back, 10));
+  EXPECT_EQ(data.substr(900, 10), read_back);
+
+  in->setFilePointer(512);
+  EXPECT_EQ(100u, in->read(read_back, 100));
+  EXPECT_EQ(data.substr(512, 100), read_back);
+}
+
+TEST(MmIo, ReadBufferToggleBuffering) {
+  auto data   = std::string{};
+  auto source = std::make_shared<mm_mem_io_c>(nullptr, 0, 1024);
+
+  for (auto idx = 0; idx < 1000; ++idx)
+    data += static_cast<char>('a' + (idx % 26));
+
+  source->write(data);
+
+  auto in        = std::make_shared<mm_read_buffer_io_c>(source.get(), 256, false);
+  auto read_back = std::string{};
+
+  // The buffer has been filled beyond the current position.
+  in->setFilePointer(10);
+  EXPECT_EQ(10u, in->read(read_back, 10));
+
+  in->enable_buffering(false);
+  EXPECT_EQ(20u, in->getFilePointer());
+  EXPECT_EQ(8u, in->read(read_back, 8));
+  EXPECT_EQ(data.substr(20, 8), read_back);
+
+  in->setFilePointer(700);
+  EXPECT_EQ(8u, in->read(read_back, 8));
+
+  in->enable_buffering(true);
+  EXPECT_EQ(708u, in->getFilePointer());
+  EXPECT_EQ(20u, in->read(read_back, 20));
+  EXPECT_EQ(data.substr(708, 20), read_back);
+
+  // Seeking to the start after re-enabling the buffer
+  in->enable_buffering(false);
+  in->setFilePointer(900);
+  in->enable_buffering(true);
+  in->setFilePointer(0);
+  EXPECT_EQ(10u, in->read(read_back, 10));
+  EXPECT_EQ(data.substr(0, 10), read_back);
+}
+
+TEST(MmIo, CachedHead) {
+  auto data   = std::string{};
+  auto source = std::make_shared<mm_mem_io_c>(nullptr, 0, 1024);
+
+  for (auto idx = 0; idx < 1000; ++idx)
+    data += static_cast<char>('a' + (idx % 26));
+
+  source->write(data);
+
+  auto in        = std::make_shared<mm_cached_head_io_c>(source.get(), 256, false);
+  auto read_back = std::string{};
+
+  EXPECT_EQ(1000, in->get_size());
+
+  auto head = in->get_head(16);
+  ASSERT_EQ(16u, head->get_size());
+  EXPECT_EQ(data.substr(0, 16), std::string(reinterpret_cast<char const *>(head->get_buffer()), 16));
+
+  // Reads within the head are served from memory only.
+  source->setFilePointer(0);
+  source->write(std::string(256, 'x'));
+
+  EXPECT_EQ(100u, in->read(read_back, 100));
+  EXPECT_EQ(data.substr(0, 100), read_back);
+
+  in->setFilePointer(10);
+  EXPECT_EQ(20u, in->read(read_back, 20));
+  EXPECT_EQ(data.substr(10, 20), read_back);
+
+  // Reads crossing the end of the head
+  source->setFilePointer(0);
+  source->write(data.substr(0, 256));
+
+  in->setFilePointer(200);
+  EXPECT_EQ(300u, in->read(read_back, 300));
+  EXPECT_EQ(data.substr(200, 300), read_back);
+  EXPECT_EQ(500u, in->getFilePointer());
+
+  in->setFilePointer(-100, seek_end);
+  EXPECT_EQ(50u, in->read(read_back, 50));
+  EXPECT_EQ(data.substr(900, 50), read_back);
+
+  // Reading beyond the end
+  EXPECT_FALSE(in->eof());
+  EXPECT_EQ(50u, in->read(read_back, 100));
+  EXPECT_EQ(data.substr(950, 50), read_back);
+  EXPECT_TRUE(in->eof());
+
+  in->setFilePointer(2000);
+  EXPECT_EQ(1000u, in->getFilePointer());
+  EXPECT_FALSE(in->eof());
+
+  // The head of files smaller than the maximum head size
+  auto small_in = std::make_shared<mm_cached_head_io_c>(new mm_mem_io_c(reinterpret_cast<unsigned char const *>(data.c_str()), 10), 256);
+  EXPECT_EQ(10u, small_in->get_head(16)->get_size());
+  EXPECT_EQ(10u, small_in->read(read_back, 20));
+  EXPECT_EQ(data.substr(0, 10), read_back);
+  EXPECT_TRUE(small_in->eof());
+}
+
+TEST(MmIo, Mmap) {
+  auto file_name = std::string{"tests/unit/data/text/chapters-valid.xml"};
+  auto content   = mm_file_io_c::slurp(file_name)->to_string();
+
+  // Windows of a single page force remapping.
+  auto in        = std::make_shared<mm_mmap_io_c>(file_name, 1);
+  auto read_back = std::string{};
+
+  EXPECT_EQ(static_cast<int64_t>(content.size()), in->get_size());
+
+  EXPECT_EQ(content.size(), in->read(read_back, content.size()));
+  EXPECT_EQ(content, read_back);
+  EXPECT_FALSE(in->eof());
+
+  EXPECT_EQ(0u, in->read(read_back, 10));
+  EXPECT_TRUE(in->eof());
+
+  in->setFilePointer(-5000, seek_end);
+  EXPECT_FALSE(in->eof());
+  EXPECT_EQ(5000u, in->read(read_back, 5000));
+  EXPECT_EQ(content.substr(content.size() - 5000), read_back);
+
+  in->setFilePointer(100);
+  EXPECT_EQ(content.substr(100, 20), in->read(20)->to_string());
+
+  // Reads spanning several windows
+  in->setFilePointer(4000);
+  EXPECT_EQ(content.substr(4000, 200),  in->read(200)->to_string());
+  EXPECT_EQ(content.substr(4200, 6000), in->read(6000)->to_string());
+  EXPECT_EQ(10200u, in->getFilePointer());
+
+  in->setFilePointer(0);
+  EXPECT_EQ(content.substr(0, 10), in->read(10)->to_string());
+  in->close();
+
+  EXPECT_THROW(mm_mmap_io_c::open("doesnotexist"), mtx::mm_io::exception);
+}
+
 }
@@ -0,0 +1,172 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "common/mm_io.h"
+#include "common/mpeg.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using start_codes_t = std::vector<std::pair<std::size_t, std::size_t>>;
+
+start_codes_t
+find_start_codes(std::vector<std::string> const &slices) {
+  memory_slice_cursor_c cursor;
+  start_codes_t start_codes;
+
+  for (auto const &slice : slices)
+    cursor.add_slice(memory_c::clone(slice));
+
+  mtx::mpeg::find_start_codes(cursor, [&start_codes](std::size_t position, std::size_t marker_size) {
+    start_codes.emplace_back(position, marker_size);
+  });
+
+  return start_codes;
+}
+
+TEST(Mpeg, FindThreeByteSequence) {
+  auto buffer = std::string(100, '\x42');
+  auto data   = reinterpret_cast<unsigned char const *>(buffer.c_str());
+
+  EXPECT_EQ(100u, mtx::mpeg::find_start_code(data, buffer.size()));
+  EXPECT_EQ(0u,   mtx::mpeg::find_start_code(data, 0));
+
+  buffer.replace(97, 3, std::string{"\x00\x00\x01", 3});
+  EXPECT_EQ(97u,  mtx::mpeg::find_start_code(data, buffer.size()));
+  EXPECT_EQ(99u,  mtx::mpeg::find_start_code(data, 99));
+
+  buffer.replace(40, 4, std::string{"\x00\x00\x00\x03", 4});
+  EXPECT_EQ(97u,  mtx::mpeg::find_start_code(data, buffer.size()));
+  EXPECT_EQ(41u,  mtx::mpeg::find_three_byte_sequence(data, buffer.size(), 0x03));
+
+  buffer.replace(16, 3, std::string{"\x00\x00\x01", 3});
+  EXPECT_EQ(16u,  mtx::mpeg::find_start_code(data, buffer.size()));
+  EXPECT_EQ(16u,  mtx::mpeg::find_start_code(data, 19));
+  EXPECT_EQ(97u,  mtx::mpeg::find_start_code(data + 17, buffer.size() - 17) + 17);
+}
+
+TEST(Mpeg, FindStartCodesSingleSlice) {
+  EXPECT_EQ(start_codes_t{}, find_start_codes({ std::string{"\x00\x00\x02\x00\x01", 5} }));
+
+  EXPECT_EQ((start_codes_t{ { 0, 3 }, { 4, 4 }, { 10, 3 } }),
+            find_start_codes({ std::string{"\x00\x00\x01\x42\x00\x00\x00\x01\x42\x42\x00\x00\x01", 13} }));
+}
+
+TEST(Mpeg, FindStartCodesAcrossSlices) {
+  EXPECT_EQ((start_codes_t{ { 1, 4 } }), find_start_codes({ std::string{"\x42\x00", 2}, std::string{"\x00\x00\x01\x42", 4} }));
+  EXPECT_EQ((start_codes_t{ { 1, 4 } }), find_start_codes({ std::string{"\x42\x00\x00", 3}, std::string{"\x00\x01\x42", 3} }));
+  EXPECT_EQ((start_codes_t{ { 1, 4 } }), find_start_codes({ std::string{"\x42\x00\x00\x00", 4}, std::string{"\x01\x42", 2} }));
+  EXPECT_EQ((start_codes_t{ { 1, 3 } }), find_start_codes({ std::string{"\x42\x00", 2}, std::string{"\x00", 1}, std::string{"\x01\x42", 2} }));
+  EXPECT_EQ((start_codes_t{ { 0, 3 }, { 3, 3 } }),
+            find_start_codes({ std::string{"\x00\x00\x01", 3}, std::string{"\x00\x00\x01", 3} }));
+}
+
+TEST(Mpeg, NaluToRbsp) {
+  auto nalu     = memory_c::clone(std::string{"\x42\x00\x00\x03\x01\x00\x00\x03\x00\x00\x03\x42\x00\x00\x03", 15});
+  auto expected = memory_c::clone(std::string{"\x42\x00\x00\x01\x00\x00\x00\x00\x42\x00\x00", 11});
+
+  EXPECT_TRUE(*expected == *mtx::mpeg::nalu_to_rbsp(nalu));
+
+  auto unchanged = memory_c::clone(std::string(100, '\x42'));
+  EXPECT_TRUE(*unchanged == *mtx::mpeg::nalu_to_rbsp(unchanged));
+}
+
+TEST(Mpeg, ExtractTsPids) {
+  for (auto packet_size : std::vector<std::size_t>{ 188, 192, 204 }) {
+    auto num_packets = 37u;
+    auto buffer      = std::string(num_packets * packet_size, '\x00');
+    auto pids        = std::vector<uint16_t>(num_packets);
+
+    for (auto idx = 0u; idx < num_packets; ++idx) {
+      auto pid                        = static_cast<uint16_t>((idx * 0x0123) & 0x1fff);
+      buffer[idx * packet_size]       = 0x47;
+      buffer[idx * packet_size + 1]   = static_cast<char>(0xe0 | (pid >> 8)); // flags must be masked
+      buffer[idx * packet_size + 2]   = static_cast<char>(pid & 0xff);
+      buffer[idx * packet_size + 3]   = 0x47;
+    }
+
+    auto data = reinterpret_cast<unsigned char const *>(buffer.data());
+
+    ASSERT_EQ(num_packets, mtx::mpeg::extract_ts_pids(data, num_packets, packet_size, pids.data()));
+    for (auto idx = 0u; idx < num_packets; ++idx)
+      EXPECT_EQ((idx * 0x0123) & 0x1fff, pids[idx]);
+
+    // A missing sync byte stops the extraction, both within and after
+    // the first vector-sized group of packets.
+    for (auto broken : std::vector<std::size_t>{ 0, 3, 8, 20, 36 }) {
+      auto copy                   = buffer;
+      copy[broken * packet_size]  = 0x48;
+
+      EXPECT_EQ(broken, mtx::mpeg::extract_ts_pids(reinterpret_cast<unsigned char const *>(copy.data()), num_packets, packet_size, pids.data()));
+    }
+
+    EXPECT_EQ(0u, mtx::mpeg::extract_ts_pids(data, 0, packet_size, pids.data()));
+  }
+}
+
+
+// Demultiplexes a transport stream the way the MPEG TS reader does:
+// packets are either read one at a time or in chunks of many packets
+// whose sync bytes and PIDs are extracted at once. Only the payload of
+// one of the eight PIDs is collected.
+TEST(Mpeg, DISABLED_BenchmarkTsDemux) {
+  auto run = [](std::size_t packet_size, std::size_t packets_per_read) -> double {
+    auto num_packets = std::size_t{256 * 1024};
+    auto stream      = memory_c::alloc(num_packets * packet_size);
+    auto buffer      = stream->get_buffer();
+
+    std::memset(buffer, 0x55, num_packets * packet_size);
+
+    for (auto idx = 0u; idx < num_packets; ++idx) {
+      auto packet = buffer + idx * packet_size;
+      packet[0]   = 0x47;
+      packet[1]   = 0x10 + (idx % 8);
+      packet[2]   = 0x11;
+      packet[3]   = 0x10;
+    }
+
+    mm_mem_io_c in{*stream};
+
+    auto chunk      = memory_c::alloc(packets_per_read * packet_size);
+    auto pids       = std::vector<uint16_t>(packets_per_read);
+    auto payload    = std::vector<unsigned char>{};
+    auto num_wanted = std::size_t{};
+    auto start      = std::chrono::steady_clock::now();
+
+    payload.reserve(num_packets / 8 * 184);
+
+    while (true) {
+      auto num_read = in.read(chunk->get_buffer(), packets_per_read * packet_size) / packet_size;
+      if (!num_read)
+        break;
+
+      auto num_synced = mtx::mpeg::extract_ts_pids(chunk->get_buffer(), num_read, packet_size, pids.data());
+      EXPECT_EQ(num_read, num_synced);
+
+      for (auto idx = 0u; idx < num_synced; ++idx) {
+        if (0x1011 != pids[idx])
+          continue;
+
+        auto packet = chunk->get_buffer() + idx * packet_size;
+        payload.insert(payload.end(), packet + 4, packet + 188);
+        ++num_wanted;
+      }
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(num_packets / 8, num_wanted);
+
+    return num_packets * packet_size / seconds / 1024 / 1024;
+  };
+
+  std::cout << boost::format("%|1$11s| %|2$16s| %|3$16s|\n") % "packet size" % "per packet MB/s" % "chunked MB/s";
+
+  for (auto packet_size : std::vector<std::size_t>{ 188, 192 })
+    std::cout << boost::format("%|1$11d| %|2$16.1f| %|3$16.1f|\n") % packet_size % run(packet_size, 1) % run(packet_size, 2048);
+}
+
+}
@@ -0,0 +1,35 @@
+#include "common/common_pch.h"
+
+#include <thread>
+
+#include "tests/unit/init.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(Output, ErrorsAsExceptions) {
+  EXPECT_THROW(mxerror("error"), mtxut::mxerror_x);
+
+  {
+    mtx::output::errors_as_exceptions_c errors_as_exceptions;
+
+    try {
+      mxerror("error on this thread\n");
+      ADD_FAILURE() << "mxerror() didn't throw";
+
+    } catch (mtx::output::error_x &ex) {
+      EXPECT_EQ(std::string{"error on this thread\n"}, ex.what());
+    }
+
+    // Other threads aren't affected.
+    std::thread other{[]() {
+      EXPECT_THROW(mxerror("error"), mtxut::mxerror_x);
+    }};
+    other.join();
+  }
+
+  EXPECT_THROW(mxerror("error"), mtxut::mxerror_x);
+}
+
+}
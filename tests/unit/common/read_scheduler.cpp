@@ -0,0 +1,101 @@
+#include "common/common_pch.h"
+
+#include "common/read_scheduler.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string
+create_content(std::size_t size) {
+  std::string content;
+  for (auto idx = 0u; idx < size; ++idx)
+    content += static_cast<char>('a' + idx % 26);
+
+  return content;
+}
+
+std::string
+as_string(memory_cptr const &block) {
+  return block ? block->to_string() : std::string{"<null>"};
+}
+
+TEST(ReadScheduler, CoalescesAdjacentBlocks) {
+  auto content = create_content(1000);
+  mm_mem_io_c in{reinterpret_cast<unsigned char const *>(content.data()), content.size()};
+  read_scheduler_c scheduler{in};
+
+  // Two streams whose blocks alternate in the file.
+  for (auto idx = 0u; idx < 5; ++idx) {
+    scheduler.add(1, idx, 200 + idx * 20 + 10, 10);
+    scheduler.add(0, idx, 200 + idx * 20,      10);
+  }
+
+  EXPECT_TRUE(scheduler.is_scheduled(0, 4));
+  EXPECT_FALSE(scheduler.is_scheduled(0, 5));
+  EXPECT_EQ(nullptr, scheduler.take(0, 0));
+
+  ASSERT_TRUE(scheduler.execute());
+  EXPECT_EQ(1u,   scheduler.get_statistics().m_num_reads);
+  EXPECT_EQ(100u, scheduler.get_statistics().m_num_bytes_read);
+  EXPECT_EQ(10u,  scheduler.get_num_blocks());
+
+  EXPECT_EQ(content.substr(260, 10), as_string(scheduler.take(0, 3)));
+  EXPECT_EQ(content.substr(210, 10), as_string(scheduler.take(1, 0)));
+  EXPECT_EQ("<null>",                as_string(scheduler.take(1, 0)));
+  EXPECT_FALSE(scheduler.is_scheduled(1, 0));
+  EXPECT_EQ(8u,   scheduler.get_num_blocks());
+
+  // Blocks that haven't been taken yet aren't read again.
+  scheduler.add(0, 4, 280, 10);
+  scheduler.add(0, 5, 300, 10);
+  ASSERT_TRUE(scheduler.execute());
+  EXPECT_EQ(2u,   scheduler.get_statistics().m_num_reads);
+  EXPECT_EQ(110u, scheduler.get_statistics().m_num_bytes_read);
+  EXPECT_EQ(content.substr(300, 10), as_string(scheduler.take(0, 5)));
+
+  scheduler.clear();
+  EXPECT_EQ(0u, scheduler.get_num_blocks());
+}
+
+TEST(ReadScheduler, GapsAndMaximumReadSize) {
+  auto content = create_content(10000);
+  mm_mem_io_c in{reinterpret_cast<unsigned char const *>(content.data()), content.size()};
+  read_scheduler_c scheduler{in, 1000, 50};
+
+  scheduler.add(0, 0, 0,    100);
+  scheduler.add(0, 1, 150,  100); // gap of 50: same read
+  scheduler.add(0, 2, 301,  100); // gap of 51: new read
+  scheduler.add(0, 3, 401,  950); // would exceed the maximum size: new read
+  scheduler.add(0, 4, 1351, 2000); // bigger than the maximum size: a read of its own
+
+  ASSERT_TRUE(scheduler.execute());
+
+  auto const &stats = scheduler.get_statistics();
+  EXPECT_EQ(4u,    stats.m_num_reads);
+  EXPECT_EQ(5u,    stats.m_num_blocks);
+  EXPECT_EQ(50u,   stats.m_num_gap_bytes);
+  EXPECT_EQ(3300u, stats.m_num_bytes_read);
+
+  for (auto const &expected : std::vector<std::pair<std::size_t, std::pair<std::size_t, std::size_t>>>{ { 4, { 1351, 2000 } }, { 2, { 301, 100 } }, { 0, { 0, 100 } }, { 1, { 150, 100 } }, { 3, { 401, 950 } } })
+    EXPECT_EQ(content.substr(expected.second.first, expected.second.second), as_string(scheduler.take(0, expected.first)));
+}
+
+TEST(ReadScheduler, ShortReads) {
+  auto content = create_content(100);
+  mm_mem_io_c in{reinterpret_cast<unsigned char const *>(content.data()), content.size()};
+  read_scheduler_c scheduler{in};
+
+  scheduler.add(0, 0, 80,  10);
+  scheduler.add(0, 1, 90,  20);
+  scheduler.add(0, 2, 500, 10);
+
+  EXPECT_FALSE(scheduler.execute());
+  EXPECT_EQ(content.substr(80, 10), as_string(scheduler.take(0, 0)));
+  EXPECT_EQ(nullptr, scheduler.take(0, 1));
+  EXPECT_EQ(nullptr, scheduler.take(0, 2));
+  EXPECT_FALSE(scheduler.is_scheduled(0, 1));
+  EXPECT_EQ(0u, scheduler.get_num_blocks());
+}
+
+}
@@ -0,0 +1,112 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "merge/attachment_writer.h"
+
+#include "gtest/gtest.h"
+#include "tests/unit/init.h"
+
+namespace {
+
+std::string const s_file_name = "tests/unit/data/text/chapters-valid.xml";
+
+std::string
+render(attachment_writer_c &writer,
+       std::string const &prefix = std::string{}) {
+  mm_mem_io_c out{nullptr, 0, 1000};
+
+  out.write(prefix);
+  writer.render(out);
+
+  return std::string{reinterpret_cast<char const *>(out.get_buffer()) + prefix.size(), static_cast<std::size_t>(out.getFilePointer() - prefix.size())};
+}
+
+attachment_cptr
+create_attachment(std::string const &name,
+                  std::string const &stored_name,
+                  std::string const &mime_type,
+                  std::string const &description,
+                  uint64_t id) {
+  auto attachment         = std::make_shared<attachment_t>();
+  attachment->name        = name;
+  attachment->stored_name = stored_name;
+  attachment->mime_type   = mime_type;
+  attachment->description = description;
+  attachment->id          = id;
+
+  return attachment;
+}
+
+TEST(AttachmentWriter, AttachmentsInMemory) {
+  auto first   = create_attachment("dir/a.txt", "", "text/plain", "d", 0x1234);
+  auto second  = create_attachment("b.bin", "stored", "", "", 0x80);
+  first->data  = memory_c::clone("hello");
+  second->data = memory_c::clone(std::string("\x00\x01", 2));
+
+  attachment_writer_c writer;
+  EXPECT_TRUE(writer.empty());
+
+  writer.add(first);
+  writer.add(second);
+  EXPECT_FALSE(writer.empty());
+
+  EXPECT_EQ(std::string("\x19\x41\xa4\x69\xc1"                     // Attachments
+                        "\x61\xa7\xa6"                             // Attached
+                        "\x46\x6e\x85" "a.txt"                     // FileName
+                        "\x46\x60\x8a" "text/plain"                // MimeType
+                        "\x46\x5c\x85" "hello"                     // FileData
+                        "\x46\xae\x82\x12\x34"                     // FileUID
+                        "\x46\x7e\x81" "d"                         // FileDescription
+                        "\x61\xa7\x95"
+                        "\x46\x6e\x86" "stored"
+                        "\x46\x60\x80"
+                        "\x46\x5c\x82\x00\x01"
+                        "\x46\xae\x81\x80", 70),
+            render(writer, "xyz"));
+
+  EXPECT_EQ(3u,  writer.get_position());
+  EXPECT_EQ(70u, writer.get_element_size());
+
+  writer.set_position(13);
+  EXPECT_EQ(13u, writer.get_position());
+}
+
+TEST(AttachmentWriter, ContentCopiedFromFile) {
+  auto content = mm_file_io_c::slurp(s_file_name);
+
+  auto in_memory  = create_attachment(s_file_name, "c.xml", "text/xml", "chapters", 0x12345678);
+  in_memory->data = content;
+
+  auto from_file       = create_attachment(s_file_name, "c.xml", "text/xml", "chapters", 0x12345678);
+  from_file->file_size = content->get_size();
+
+  attachment_writer_c writer_memory, writer_file{7};
+  writer_memory.add(in_memory);
+  writer_file.add(from_file);
+
+  auto expected = render(writer_memory);
+
+  EXPECT_EQ(expected, render(writer_file));
+  EXPECT_EQ(expected.size(), writer_file.get_element_size());
+}
+
+TEST(AttachmentWriter, UnreadableFiles) {
+  auto missing       = create_attachment("does-not-exist/nonono.bin", "", "application/octet-stream", "", 1);
+  missing->file_size = 10;
+
+  attachment_writer_c writer_missing;
+  writer_missing.add(missing);
+
+  EXPECT_THROW(render(writer_missing), mtxut::mxerror_x);
+
+  // The file has been shortened since its size has been determined.
+  auto shortened       = create_attachment(s_file_name, "", "text/xml", "", 1);
+  shortened->file_size = mm_file_io_c::slurp(s_file_name)->get_size() + 1;
+
+  attachment_writer_c writer_shortened{16};
+  writer_shortened.add(shortened);
+
+  EXPECT_THROW(render(writer_shortened), mtxut::mxerror_x);
+}
+
+}
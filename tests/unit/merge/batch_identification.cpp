@@ -0,0 +1,146 @@
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "merge/batch_identification.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace mtx::identification;
+
+std::vector<std::string>
+create_file_names(std::size_t num) {
+  auto file_names = std::vector<std::string>{};
+  for (auto idx = 0u; idx < num; ++idx)
+    file_names.emplace_back((boost::format("file%1%.mkv") % idx).str());
+
+  return file_names;
+}
+
+std::vector<std::string>
+identify_with_delays(std::vector<std::string> const &file_names,
+                     unsigned int num_threads) {
+  auto outputs = std::vector<std::string>{};
+
+  // Files early in the list take longest so that later ones are done
+  // first if several threads are used.
+  auto identify = [&file_names](std::string const &file_name) -> result_t {
+    auto idx = std::find(file_names.begin(), file_names.end(), file_name) - file_names.begin();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2 * (file_names.size() - idx)));
+    return { "result for " + file_name, 0 };
+  };
+
+  auto output = [&outputs](std::string const &result) {
+    outputs.emplace_back(result);
+  };
+
+  EXPECT_EQ(0, identify_in_order(file_names, num_threads, identify, output));
+
+  return outputs;
+}
+
+TEST(BatchIdentification, OutputInInputOrder) {
+  auto file_names = create_file_names(20);
+  auto expected   = std::vector<std::string>{};
+  for (auto const &file_name : file_names)
+    expected.emplace_back("result for " + file_name);
+
+  EXPECT_EQ(expected, identify_with_delays(file_names, 1));
+  EXPECT_EQ(expected, identify_with_delays(file_names, 4));
+  EXPECT_EQ(expected, identify_with_delays(file_names, 64));
+}
+
+TEST(BatchIdentification, OutputOnCallingThread) {
+  auto file_names     = create_file_names(10);
+  auto calling_thread = std::this_thread::get_id();
+  auto num_outputs    = 0u;
+
+  auto identify = [](std::string const &file_name) -> result_t {
+    return { file_name, 0 };
+  };
+
+  auto output = [calling_thread, &num_outputs](std::string const &) {
+    EXPECT_EQ(calling_thread, std::this_thread::get_id());
+    ++num_outputs;
+  };
+
+  identify_in_order(file_names, 4, identify, output);
+
+  EXPECT_EQ(10u, num_outputs);
+}
+
+TEST(BatchIdentification, ThreadLimit) {
+  auto file_names = create_file_names(16);
+
+  for (auto num_threads : std::vector<unsigned int>{ 1, 3, 100 }) {
+    std::atomic<unsigned int> num_running{}, max_running{};
+
+    auto identify = [&](std::string const &file_name) -> result_t {
+      auto now_running = ++num_running;
+      auto previous    = max_running.load();
+      while ((previous < now_running) && !max_running.compare_exchange_weak(previous, now_running))
+        ;
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      --num_running;
+
+      return { file_name, 0 };
+    };
+
+    identify_in_order(file_names, num_threads, identify, [](std::string const &) {});
+
+    EXPECT_GE(std::min<unsigned int>(num_threads, file_names.size()), max_running.load());
+  }
+}
+
+TEST(BatchIdentification, ExitCodeIsHighestOfAllFiles) {
+  auto file_names  = create_file_names(4);
+  auto exit_codes  = std::map<std::string, int>{};
+  auto identify    = [&exit_codes](std::string const &file_name) -> result_t {
+    return { file_name, exit_codes[file_name] };
+  };
+  auto run         = [&](unsigned int num_threads) {
+    return identify_in_order(file_names, num_threads, identify, [](std::string const &) {});
+  };
+
+  EXPECT_EQ(0, run(1));
+  EXPECT_EQ(0, run(4));
+
+  exit_codes[file_names[2]] = 1;
+  EXPECT_EQ(1, run(1));
+  EXPECT_EQ(1, run(4));
+
+  exit_codes[file_names[0]] = 2;
+  EXPECT_EQ(2, run(1));
+  EXPECT_EQ(2, run(4));
+
+  exit_codes[file_names[0]] = 0;
+  exit_codes[file_names[3]] = 2;
+  EXPECT_EQ(2, run(1));
+  EXPECT_EQ(2, run(4));
+}
+
+TEST(BatchIdentification, NoFiles) {
+  auto num_calls = 0u;
+  auto identify  = [&num_calls](std::string const &file_name) -> result_t {
+    ++num_calls;
+    return { file_name, 2 };
+  };
+
+  EXPECT_EQ(0, identify_in_order({}, 4, identify, [&num_calls](std::string const &) { ++num_calls; }));
+  EXPECT_EQ(0u, num_calls);
+}
+
+TEST(BatchIdentification, ParseFileList) {
+  EXPECT_EQ(std::vector<std::string>{}, parse_file_list(""));
+  EXPECT_EQ(std::vector<std::string>{}, parse_file_list("\n\r\n\n"));
+  EXPECT_EQ((std::vector<std::string>{ "a.mkv", "b c.mp4", "d.ts" }), parse_file_list("a.mkv\nb c.mp4\nd.ts"));
+  EXPECT_EQ((std::vector<std::string>{ "a.mkv", "b c.mp4", "d.ts" }), parse_file_list("a.mkv\r\n\r\nb c.mp4\r\nd.ts\r\n"));
+  EXPECT_EQ((std::vector<std::string>{ "/path/to/x.mkv", "=y.mkv" }), parse_file_list("\n/path/to/x.mkv\n\n=y.mkv\n"));
+}
+
+}
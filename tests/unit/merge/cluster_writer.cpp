@@ -0,0 +1,97 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "merge/cluster_writer.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string
+render(cluster_writer_c &writer,
+       uint64_t cluster_timecode,
+       std::string const &prefix = std::string{}) {
+  mm_mem_io_c out{nullptr, 0, 1000};
+
+  out.write(prefix);
+  writer.render(out, cluster_timecode);
+
+  return std::string{reinterpret_cast<char const *>(out.get_buffer()) + prefix.size(), static_cast<std::size_t>(out.getFilePointer() - prefix.size())};
+}
+
+memory_cptr
+frame(std::string const &content) {
+  return memory_c::clone(content);
+}
+
+TEST(ClusterWriter, SingleSimpleBlock) {
+  cluster_writer_c writer;
+  writer.reset(1000000);
+
+  auto idx = writer.add_block(true);
+  EXPECT_TRUE(writer.add_frame(idx, 1, 0, frame("\xaa"), LACING_AUTO, -1, -1));
+
+  EXPECT_EQ(std::string("\x1f\x43\xb6\x75\x8a"  // Cluster
+                        "\xe7\x81\x00"          // Timecode
+                        "\xa3\x85\x81\x00\x00\x80\xaa", 15), // SimpleBlock, key frame
+            render(writer, 0));
+  EXPECT_EQ(15u, writer.get_element_size());
+  EXPECT_EQ(0u,  writer.get_position());
+  EXPECT_EQ(5u,  writer.get_data_start_position());
+  EXPECT_TRUE(writer.empty());
+}
+
+TEST(ClusterWriter, LacingAndBlockGroups) {
+  cluster_writer_c writer;
+  writer.reset(1000000);
+
+  // Different frame sizes; EBML lacing is as small as Xiph lacing.
+  auto simple = writer.add_block(true);
+  writer.add_frame(simple, 2, 5000000, frame(std::string("\x01\x02", 2)), LACING_AUTO, -1, -1);
+  writer.add_frame(simple, 2, 6000000, frame("\x03\x04\x05"),             LACING_AUTO, -1, -1);
+  writer.add_frame(simple, 2, 7000000, frame("\x06"),                     LACING_AUTO, -1, -1);
+
+  auto group = writer.add_block(false);
+  writer.add_frame(group, 1, 8000000, frame("\x07"), LACING_NONE, 4000000, -1);
+  writer.set_block_duration(group, 40000000);
+  writer.add_block_additions(group, { frame("\x08"), frame("\x09") });
+  writer.set_discard_padding(group, -5);
+  writer.add_to_cues(group);
+
+  EXPECT_EQ(std::string("\x1f\x43\xb6\x75\xb5"
+                        "\xe7\x81\x03"
+                        "\xa3\x8d\x82\x00\x02\x86\x02\x82\xc0\x01\x02\x03\x04\x05\x06"
+                        "\xa0\xa1"
+                        "\xa1\x85\x81\x00\x05\x00\x07"                       // Block
+                        "\xfb\x81\xfc"                                       // ReferenceBlock
+                        "\x9b\x81\x28"                                       // BlockDuration
+                        "\x75\xa1\x8d\xa6\x83\xa5\x81\x08\xa6\x86\xee\x81\x02\xa5\x81\x09" // BlockAdditions
+                        "\x75\xa2\x81\xfb", 58),                             // DiscardPadding
+            render(writer, 3000000, "xyz"));
+
+  EXPECT_EQ(3u, writer.get_position());
+  EXPECT_EQ(8u, writer.get_data_start_position());
+
+  auto const &blocks = writer.get_rendered_blocks();
+  ASSERT_EQ(2u, blocks.size());
+  EXPECT_EQ(11u, blocks[0].m_position);
+  EXPECT_FALSE(blocks[0].m_add_to_cues);
+  EXPECT_EQ(26u, blocks[1].m_position);
+  EXPECT_EQ(1u,  blocks[1].m_track_num);
+  EXPECT_TRUE(blocks[1].m_add_to_cues);
+}
+
+TEST(ClusterWriter, LacingLimits) {
+  cluster_writer_c writer;
+  writer.reset(1000000);
+
+  auto idx = writer.add_block(true);
+  for (auto num = 0; num < 7; ++num)
+    EXPECT_TRUE(writer.add_frame(idx, 1, num, frame("ab"), LACING_AUTO, -1, -1));
+  EXPECT_FALSE(writer.add_frame(idx, 1, 7, frame("ab"), LACING_AUTO, -1, -1));
+
+  idx = writer.add_block(true);
+  EXPECT_FALSE(writer.add_frame(idx, 1, 8, frame("ab"), LACING_NONE, -1, -1));
+}
+
+}
@@ -0,0 +1,163 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "common/compression.h"
+#include "merge/packet_compression_workers.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Resembles bitmap subtitles: runs of the same byte of varying lengths.
+memory_cptr
+create_data(std::size_t size,
+            std::mt19937 &generator) {
+  auto data   = memory_c::alloc(size);
+  auto buffer = data->get_buffer();
+  auto pos    = 0u;
+
+  while (pos < size) {
+    auto run_length = std::min<std::size_t>(1 + generator() % 64, size - pos);
+    std::memset(&buffer[pos], generator() % 4, run_length);
+    pos += run_length;
+  }
+
+  return data;
+}
+
+std::vector<packet_cptr>
+create_packets(std::size_t num,
+               std::size_t size,
+               std::mt19937 &generator) {
+  auto packets = std::vector<packet_cptr>{};
+
+  for (auto idx = 0u; idx < num; ++idx) {
+    packets.emplace_back(std::make_shared<packet_t>(create_data(size + generator() % size, generator)));
+    if (idx % 3)
+      packets.back()->data_adds.emplace_back(create_data(100, generator));
+  }
+
+  return packets;
+}
+
+TEST(PacketCompressionWorkers, SameResultAsSynchronousCompression) {
+  auto generator = std::mt19937{42};
+  auto packets   = create_packets(200, 1000, generator);
+  auto futures   = std::vector<std::shared_future<void>>{};
+  auto expected  = std::vector<std::vector<std::string>>{};
+
+  zlib_compressor_c compressor{6};
+
+  for (auto const &packet : packets) {
+    expected.emplace_back();
+    expected.back().emplace_back(compressor.compress(packet->data)->to_string());
+    for (auto const &data_add : packet->data_adds)
+      expected.back().emplace_back(compressor.compress(data_add)->to_string());
+  }
+
+  packet_compression_workers_c workers{3};
+
+  for (auto const &packet : packets)
+    futures.emplace_back(workers.add(packet, 6));
+
+  for (auto idx = 0u; idx < packets.size(); ++idx) {
+    futures[idx].get();
+
+    auto &packet = *packets[idx];
+    ASSERT_EQ(expected[idx].size(), packet.data_adds.size() + 1);
+    EXPECT_EQ(expected[idx][0], packet.data->to_string());
+
+    for (auto add_idx = 0u; add_idx < packet.data_adds.size(); ++add_idx)
+      EXPECT_EQ(expected[idx][add_idx + 1], packet.data_adds[add_idx]->to_string());
+
+    EXPECT_EQ(packet.calculate_uncompressed_size(), compressor.decompress(packet.data)->get_size() + (packet.data_adds.empty() ? 0 : 100));
+  }
+}
+
+TEST(PacketCompressionWorkers, DifferentLevels) {
+  auto generator = std::mt19937{42};
+  auto original  = create_data(50000, generator);
+  auto fast      = std::make_shared<packet_t>(original->clone());
+  auto best      = std::make_shared<packet_t>(original->clone());
+
+  packet_compression_workers_c workers{1};
+
+  auto fast_done = workers.add(fast, 1);
+  auto best_done = workers.add(best, 9);
+
+  fast_done.get();
+  best_done.get();
+
+  EXPECT_EQ(zlib_compressor_c{1}.compress(original)->to_string(), fast->data->to_string());
+  EXPECT_EQ(zlib_compressor_c{9}.compress(original)->to_string(), best->data->to_string());
+}
+
+// Not run by default. Run with --gtest_also_run_disabled_tests in order
+// to compare the throughput of the compression stage: packets that
+// aren't compressed at all, compressed synchronously on the muxing
+// thread and compressed by the workers while the muxing thread takes
+// them out of the queue in order.
+TEST(PacketCompressionWorkers, DISABLED_Benchmark) {
+  static auto const s_num_packets = 2000u;
+  static auto const s_queue_size  = 256u;
+
+  auto generator = std::mt19937{42};
+  auto packets   = create_packets(s_num_packets, 16 * 1024, generator);
+  auto num_bytes = 0ull;
+
+  for (auto const &packet : packets)
+    num_bytes += packet->calculate_uncompressed_size();
+
+  auto run = [&packets, num_bytes](std::function<void(packet_cptr const &)> const &add, std::function<void(packet_t &)> const &get) -> double {
+    auto queue = std::deque<packet_cptr>{};
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto const &packet : packets) {
+      auto copy = std::make_shared<packet_t>(packet->data->clone());
+      for (auto const &data_add : packet->data_adds)
+        copy->data_adds.emplace_back(data_add->clone());
+
+      add(copy);
+      queue.push_back(copy);
+
+      if (queue.size() < s_queue_size)
+        continue;
+
+      get(*queue.front());
+      queue.pop_front();
+    }
+
+    for (auto const &packet : queue)
+      get(*packet);
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return num_bytes / seconds / 1024 / 1024;
+  };
+
+  zlib_compressor_c compressor;
+
+  auto uncompressed = run([](packet_cptr const &) {}, [](packet_t &) {});
+
+  auto synchronous  = run([&compressor](packet_cptr const &packet) {
+    packet->data = compressor.compress(packet->data);
+    for (auto &data_add : packet->data_adds)
+      data_add = compressor.compress(data_add);
+  }, [](packet_t &) {});
+
+  auto parallel     = run([](packet_cptr const &packet) {
+    packet->pending_compression = packet_compression_workers_c::get().add(packet, 9);
+  }, [](packet_t &packet) {
+    packet.pending_compression.get();
+  });
+
+  std::cout << boost::format("%|1$-14s| %|2$10s|\n") % "mode" % "MB/s";
+  std::cout << boost::format("%|1$-14s| %|2$10.1f|\n") % "uncompressed" % uncompressed;
+  std::cout << boost::format("%|1$-14s| %|2$10.1f|\n") % "synchronous"  % synchronous;
+  std::cout << boost::format("%|1$-14s| %|2$10.1f|\n") % "workers"      % parallel;
+}
+
+}
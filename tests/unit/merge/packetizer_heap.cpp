@@ -0,0 +1,157 @@
+#include "common/common_pch.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "merge/packetizer_heap.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Emulates the packetizers in mkvmerge's main loop: each one delivers
+// packets with increasing timecodes, but the step sizes vary.
+struct fake_packetizer_t {
+  int64_t m_next_timecode{}, m_step{};
+  boost::optional<timestamp_c> m_packet;
+};
+
+std::vector<fake_packetizer_t>
+create_packetizers(std::size_t num,
+                   std::mt19937 &generator) {
+  auto packetizers = std::vector<fake_packetizer_t>(num);
+
+  for (auto &ptzr : packetizers)
+    ptzr.m_step = 1 + generator() % 100;
+
+  return packetizers;
+}
+
+boost::optional<std::size_t>
+select_by_linear_search(std::vector<fake_packetizer_t> const &packetizers) {
+  auto winner = boost::optional<std::size_t>{};
+
+  for (auto idx = 0u; idx < packetizers.size(); ++idx)
+    if (packetizers[idx].m_packet && (!winner || (*packetizers[idx].m_packet < *packetizers[*winner].m_packet)))
+      winner = idx;
+
+  return winner;
+}
+
+void
+refill(fake_packetizer_t &ptzr) {
+  ptzr.m_packet         = timestamp_c::ns(ptzr.m_next_timecode);
+  ptzr.m_next_timecode += ptzr.m_step;
+}
+
+TEST(PacketizerHeap, Empty) {
+  auto heap = packetizer_heap_c{};
+
+  EXPECT_FALSE(heap.top());
+
+  heap.add(3, timestamp_c::ns(10));
+  heap.remove(3);
+
+  EXPECT_FALSE(heap.top());
+}
+
+TEST(PacketizerHeap, Ordering) {
+  auto heap = packetizer_heap_c{};
+
+  heap.add(0, timestamp_c::ns(30));
+  heap.add(1, timestamp_c::ns(10));
+  heap.add(2, timestamp_c::ns(20));
+  heap.add(3, timestamp_c::ns(10));
+
+  // Equal timecodes: lowest index first
+  ASSERT_TRUE(!!heap.top());
+  EXPECT_EQ(1u, *heap.top());
+  heap.remove(1);
+  EXPECT_EQ(3u, *heap.top());
+  heap.remove(3);
+  EXPECT_EQ(2u, *heap.top());
+
+  // Replacing a packet supersedes the old entry.
+  heap.add(0, timestamp_c::ns(5));
+  EXPECT_EQ(0u, *heap.top());
+  heap.remove(0);
+  EXPECT_EQ(2u, *heap.top());
+  heap.remove(2);
+  EXPECT_FALSE(heap.top());
+}
+
+TEST(PacketizerHeap, SameOrderAsLinearSearch) {
+  auto generator   = std::mt19937{42};
+  auto packetizers = create_packetizers(37, generator);
+  auto heap        = packetizer_heap_c{};
+
+  for (auto idx = 0u; idx < packetizers.size(); ++idx) {
+    refill(packetizers[idx]);
+    heap.add(idx, *packetizers[idx].m_packet);
+  }
+
+  for (auto num_packets = 0; num_packets < 20000; ++num_packets) {
+    auto expected = select_by_linear_search(packetizers);
+    auto actual   = heap.top();
+
+    ASSERT_EQ(!!expected, !!actual);
+    if (!expected)
+      break;
+
+    ASSERT_EQ(*expected, *actual);
+
+    auto &ptzr = packetizers[*actual];
+    ptzr.m_packet.reset();
+    heap.remove(*actual);
+
+    // Some packetizers run out of data.
+    if (!(generator() % 100))
+      continue;
+
+    refill(ptzr);
+    heap.add(*actual, *ptzr.m_packet);
+  }
+}
+
+// Not run by default. Run with --gtest_also_run_disabled_tests in order
+// to compare the packets per second for varying numbers of tracks.
+TEST(PacketizerHeap, DISABLED_Benchmark) {
+  static auto const s_num_packets = 2000000;
+
+  auto run = [](std::size_t num_tracks, bool use_heap) -> double {
+    auto generator   = std::mt19937{42};
+    auto packetizers = create_packetizers(num_tracks, generator);
+    auto heap        = packetizer_heap_c{};
+    auto start       = std::chrono::steady_clock::now();
+
+    for (auto idx = 0u; idx < packetizers.size(); ++idx) {
+      refill(packetizers[idx]);
+      heap.add(idx, *packetizers[idx].m_packet);
+    }
+
+    for (auto num_packets = 0; num_packets < s_num_packets; ++num_packets) {
+      auto winner = use_heap ? heap.top() : select_by_linear_search(packetizers);
+      auto &ptzr  = packetizers[*winner];
+
+      if (use_heap)
+        heap.remove(*winner);
+
+      refill(ptzr);
+
+      if (use_heap)
+        heap.add(*winner, *ptzr.m_packet);
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return s_num_packets / seconds;
+  };
+
+  std::cout << boost::format("%|1$6s| %|2$18s| %|3$18s|\n") % "tracks" % "linear packets/s" % "heap packets/s";
+
+  for (auto num_tracks : std::vector<std::size_t>{ 2, 4, 8, 16, 32, 48, 64, 128 })
+    std::cout << boost::format("%|1$6d| %|2$18.0f| %|3$18.0f|\n") % num_tracks % run(num_tracks, false) % run(num_tracks, true);
+}
+
+}